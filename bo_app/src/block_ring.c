@@ -0,0 +1,216 @@
+//  Copyright (c) 2018 Karl Stenerud. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall remain in place
+// in this source code.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include <stdlib.h>
+#include "block_ring.h"
+
+
+// How many times to check the ring before going to sleep. Blocks are large, so the other side
+// is usually either just about done with one or busy for a good while.
+#define SPIN_COUNT 100
+
+static inline void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#endif
+}
+
+static bool is_block_free(block_ring* ring)
+{
+	return atomic_load(&ring->write_count) + ring->write_taken_count - atomic_load(&ring->read_count) < ring->block_count;
+}
+
+static bool is_block_published(block_ring* ring)
+{
+	return atomic_load(&ring->read_count) + ring->read_taken_count < atomic_load(&ring->write_count);
+}
+
+static bool is_cancelled(block_ring* ring)
+{
+	return atomic_load(&ring->is_cancelled);
+}
+
+/**
+ * Wait for the ring to be ready, spinning for a bit before sleeping.
+ *
+ * @return False if the ring was cancelled.
+ */
+static bool wait_until(block_ring* ring, bool (*is_ready)(block_ring*))
+{
+	for(int i = 0; i < SPIN_COUNT; i++)
+	{
+		if(is_cancelled(ring))
+		{
+			return false;
+		}
+		if(is_ready(ring))
+		{
+			return true;
+		}
+		cpu_relax();
+	}
+
+	// The other side checks sleeper_count after updating its count, and this side checks the
+	// counts after updating sleeper_count, so one of them always sees the other.
+	pthread_mutex_lock(&ring->mutex);
+	atomic_fetch_add(&ring->sleeper_count, 1);
+	while(!is_cancelled(ring) && !is_ready(ring))
+	{
+		pthread_cond_wait(&ring->changed, &ring->mutex);
+	}
+	atomic_fetch_sub(&ring->sleeper_count, 1);
+	pthread_mutex_unlock(&ring->mutex);
+	return !is_cancelled(ring);
+}
+
+static void wake_sleepers(block_ring* ring)
+{
+	if(atomic_load(&ring->sleeper_count) > 0)
+	{
+		pthread_mutex_lock(&ring->mutex);
+		pthread_cond_broadcast(&ring->changed);
+		pthread_mutex_unlock(&ring->mutex);
+	}
+}
+
+bool ring_init(block_ring* ring, unsigned block_count, size_t block_size)
+{
+	ring->blocks = (ring_block*)calloc(block_count, sizeof(*ring->blocks));
+	ring->block_count = block_count;
+	atomic_init(&ring->write_count, 0);
+	atomic_init(&ring->read_count, 0);
+	atomic_init(&ring->is_cancelled, false);
+	atomic_init(&ring->sleeper_count, 0);
+	ring->write_taken_count = 0;
+	ring->read_taken_count = 0;
+	pthread_mutex_init(&ring->mutex, NULL);
+	pthread_cond_init(&ring->changed, NULL);
+	if(ring->blocks == NULL)
+	{
+		return false;
+	}
+	for(unsigned i = 0; i < block_count; i++)
+	{
+		ring->blocks[i].buffer = (char*)malloc(block_size);
+		if(ring->blocks[i].buffer == NULL)
+		{
+			return false;
+		}
+		ring->blocks[i].capacity = block_size;
+	}
+	return true;
+}
+
+void ring_destroy(block_ring* ring)
+{
+	for(unsigned i = 0; ring->blocks != NULL && i < ring->block_count; i++)
+	{
+		free(ring->blocks[i].buffer);
+	}
+	free(ring->blocks);
+	ring->blocks = NULL;
+	pthread_mutex_destroy(&ring->mutex);
+	pthread_cond_destroy(&ring->changed);
+}
+
+static ring_block* take_block(block_ring* ring)
+{
+	ring_block* block = &ring->blocks[(atomic_load(&ring->write_count) + ring->write_taken_count) % ring->block_count];
+	ring->write_taken_count++;
+	block->data = block->buffer;
+	block->length = 0;
+	block->flags = 0;
+	return block;
+}
+
+ring_block* ring_begin_write(block_ring* ring)
+{
+	if(!wait_until(ring, is_block_free))
+	{
+		return NULL;
+	}
+	return take_block(ring);
+}
+
+ring_block* ring_try_begin_write(block_ring* ring)
+{
+	if(is_cancelled(ring) || !is_block_free(ring))
+	{
+		return NULL;
+	}
+	return take_block(ring);
+}
+
+ring_block* ring_get_oldest_taken(block_ring* ring)
+{
+	if(ring->write_taken_count == 0)
+	{
+		return NULL;
+	}
+	return &ring->blocks[atomic_load(&ring->write_count) % ring->block_count];
+}
+
+void ring_end_write(block_ring* ring)
+{
+	ring->write_taken_count--;
+	atomic_fetch_add(&ring->write_count, 1);
+	wake_sleepers(ring);
+}
+
+static ring_block* take_published_block(block_ring* ring)
+{
+	return &ring->blocks[(atomic_load(&ring->read_count) + ring->read_taken_count++) % ring->block_count];
+}
+
+ring_block* ring_begin_read(block_ring* ring)
+{
+	if(!wait_until(ring, is_block_published))
+	{
+		return NULL;
+	}
+	return take_published_block(ring);
+}
+
+ring_block* ring_try_begin_read(block_ring* ring)
+{
+	if(is_cancelled(ring) || !is_block_published(ring))
+	{
+		return NULL;
+	}
+	return take_published_block(ring);
+}
+
+void ring_end_read(block_ring* ring)
+{
+	ring->read_taken_count--;
+	atomic_fetch_add(&ring->read_count, 1);
+	wake_sleepers(ring);
+}
+
+void ring_cancel(block_ring* ring)
+{
+	atomic_store(&ring->is_cancelled, true);
+	pthread_mutex_lock(&ring->mutex);
+	pthread_cond_broadcast(&ring->changed);
+	pthread_mutex_unlock(&ring->mutex);
+}
@@ -0,0 +1,141 @@
+//  Copyright (c) 2018 Karl Stenerud. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall remain in place
+// in this source code.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#ifndef bo_block_ring_H
+#define bo_block_ring_H
+
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+
+// The block is a memory mapped window of a file rather than a view of its own buffer.
+#define BLOCK_FLAG_MAPPED      0x01
+// The block is the last one from its file.
+#define BLOCK_FLAG_END_OF_FILE 0x02
+// There are no more blocks after this one (it holds no data).
+#define BLOCK_FLAG_END         0x04
+// The producer failed (it holds no data).
+#define BLOCK_FLAG_ERROR       0x08
+
+typedef struct
+{
+	// The block's data, which is either in buffer or somewhere else entirely.
+	char* data;
+	size_t length;
+	char* buffer;
+	size_t capacity;
+	int flags;
+} ring_block;
+
+/**
+ * A single producer, single consumer ring of blocks, for passing large blocks of data between two threads.
+ *
+ * The blocks belong to the ring. The producer fills in the next free block and publishes it, and the
+ * consumer reads the next published block and hands it back. Neither side takes a lock unless the
+ * ring is full or empty, in which case it sleeps until the other side catches up.
+ */
+typedef struct
+{
+	ring_block* blocks;
+	unsigned block_count;
+	// The number of blocks ever published and handed back.
+	atomic_ulong write_count;
+	atomic_ulong read_count;
+	// The number of blocks the producer has taken but not yet published. Only the producer uses this.
+	unsigned long write_taken_count;
+	// The number of blocks the consumer has taken but not yet handed back. Only the consumer uses this.
+	unsigned long read_taken_count;
+	atomic_bool is_cancelled;
+	atomic_int sleeper_count;
+	pthread_mutex_t mutex;
+	pthread_cond_t changed;
+} block_ring;
+
+/**
+ * Initialize a ring, allocating block_count blocks of block_size bytes each.
+ *
+ * @return True if successful.
+ */
+bool ring_init(block_ring* ring, unsigned block_count, size_t block_size);
+
+/**
+ * Free a ring's blocks. Both threads must be finished with it.
+ */
+void ring_destroy(block_ring* ring);
+
+/**
+ * Producer: Wait for the next free block.
+ *
+ * @return The block, or NULL if the ring was cancelled.
+ */
+ring_block* ring_begin_write(block_ring* ring);
+
+/**
+ * Producer: Take the next free block without waiting. The producer can take several blocks to
+ * fill in at once, and ring_end_write() publishes them in the order they were taken.
+ *
+ * @return The block, or NULL if there are no free blocks (or the ring was cancelled).
+ */
+ring_block* ring_try_begin_write(block_ring* ring);
+
+/**
+ * Producer: Get the oldest block that has been taken but not yet published.
+ *
+ * @return The block, or NULL if there are no taken blocks.
+ */
+ring_block* ring_get_oldest_taken(block_ring* ring);
+
+/**
+ * Producer: Publish the oldest block taken with ring_begin_write() or ring_try_begin_write().
+ */
+void ring_end_write(block_ring* ring);
+
+/**
+ * Consumer: Wait for the next published block.
+ *
+ * @return The block, or NULL if the ring was cancelled.
+ */
+ring_block* ring_begin_read(block_ring* ring);
+
+/**
+ * Consumer: Take the next published block without waiting. The consumer can take several blocks
+ * at once, and ring_end_read() hands them back in the order they were taken.
+ *
+ * @return The block, or NULL if there are no published blocks (or the ring was cancelled).
+ */
+ring_block* ring_try_begin_read(block_ring* ring);
+
+/**
+ * Consumer: Hand back the oldest block taken with ring_begin_read() or ring_try_begin_read().
+ */
+void ring_end_read(block_ring* ring);
+
+/**
+ * Cancel the ring, waking up the other side. All waits from now on return NULL.
+ */
+void ring_cancel(block_ring* ring);
+
+
+#endif // bo_block_ring_H
@@ -20,6 +20,8 @@
 //
 
 
+#include <errno.h>
+#include <limits.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -28,6 +30,8 @@
 #include <unistd.h>
 #include <bo/bo.h>
 #include "bo_version.h"
+#include "parallel.h"
+#include "pipeline.h"
 
 
 #define STRINGIZE_PARAM_(arg) #arg
@@ -35,6 +39,13 @@
 
 static const char* g_version = STRINGIZE_PARAM(BO_VERSION);
 
+// Larger buffers than the library defaults, so that bulk conversions make fewer write calls.
+static const bo_context_options g_context_options =
+{
+	.work_buffer_size = 32 * 1024,
+	.output_buffer_size = 256 * 1024,
+};
+
 static const char g_usage[] =
 	"Usage: bo [options] command [command] ...\n"
 	"\n"
@@ -43,6 +54,7 @@ static const char g_usage[] =
 	"Options:\n"
 	"    -i [filename]: Read commands/data from a file (use \"-\" to read from stdin).\n"
 	"    -o [filename]: Write output to a file (use \"-\" to write to stdout).\n"
+	"    -j [count]   : Convert binary input files on this many threads.\n"
 	"    -n           : Write a newline after processing is complete.\n"
 	"    -v           : Print version and exit.\n"
 	"    -h           : Print help and exit.\n"
@@ -60,7 +72,8 @@ static const char g_usage[] =
 	"    o: Integer in base 8\n"
 	"    b: Integer in base 2\n"
 	"    f: IEEE 754 binary floating point\n"
-	"    d: IEEE 754 binary decimal\n"
+	"    F: bfloat16 brain floating point. This type only supports width 2.\n"
+	"    d: IEEE 754 decimal (BID encoding). This type supports widths 4, 8, and 16.\n"
 	"    s: C-style string (including escaping). This type does not use widths or endianness.\n"
 	"    B: Data is interpreted or output using its binary representation rather than text.\n"
 	"\n"
@@ -78,6 +91,7 @@ static const char g_usage[] =
 	"Print Width:\n"
 	"    Any integer representing the minimum number of digits to print.\n"
 	"    For floating point, the number of digits after the decimal point.\n"
+	"    If omitted, floats print the shortest representation that reads back the same.\n"
 	"\n"
 	"Presets:\n"
 	"    c: C-style preset: \", \" suffix, 0x prefix for hexadecimal, 0 prefix for octal.\n"
@@ -115,6 +129,11 @@ static void on_error(__attribute__ ((unused)) void* user_data, const char* messa
 	fprintf(stderr, "Error: %s\n", message);
 }
 
+static void on_compile_error(__attribute__ ((unused)) void* user_data, __attribute__ ((unused)) const char* message)
+{
+	// Commands that can't be compiled just get processed the normal way, which reports any errors.
+}
+
 static void perror_exit(const char* fmt, ...)
 {
 	va_list args;
@@ -144,25 +163,6 @@ static FILE* new_output_stream(const char* filename)
 	return stream;
 }
 
-static FILE* new_input_stream(const char* filename)
-{
-	if(filename == NULL)
-	{
-		return NULL;
-	}
-	if(strcmp(filename, "-") == 0)
-	{
-		return stdin;
-	}
-
-	FILE* stream = fopen(filename, "rb");
-	if(stream == NULL)
-	{
-		perror_exit("Could not open %s for reading", filename);
-	}
-	return stream;
-}
-
 static void close_stream(FILE* stream)
 {
 	if(stream == NULL || stream == stdin || stream == stdout)
@@ -173,12 +173,16 @@ static void close_stream(FILE* stream)
 	fclose(stream);
 }
 
-static void teardown(void* context, FILE* out_stream, const char** in_filenames, int in_filenames_count, bool should_print_newline)
+static void teardown(void* context, output_writer* writer, FILE* out_stream, const char** in_filenames, int in_filenames_count, bool should_print_newline)
 {
 	if(context != NULL)
 	{
 		bo_flush_and_destroy_context(context);
 	}
+	if(writer != NULL)
+	{
+		stop_output_writer(writer);
+	}
 	if(out_stream != NULL && should_print_newline)
 	{
 		fprintf(out_stream, "\n");
@@ -190,49 +194,115 @@ static void teardown(void* context, FILE* out_stream, const char** in_filenames,
 	}
 }
 
-static bool on_output(void* void_user_data, char* data, int length)
+/**
+ * Process the input files, which get read on a separate thread while this one does the conversion.
+ */
+static bool process_input_files(void* context, output_writer* writer, const char** filenames, int file_count)
 {
-	FILE* output_stream = (FILE*)void_user_data;
-    int bytes_written = fwrite(data, 1, length, output_stream);
-    if(bytes_written != length)
-    {
-    	perror("Error writing to putput stream");
-        return false;
-    }
-    return true;
-}
+	input_reader* reader = start_input_reader(filenames, file_count);
+	if(reader == NULL)
+	{
+		return false;
+	}
 
-static bool process_stream(void* context, FILE* stream)
-{
-	char buffer[10000];
-	const int bytes_to_read = sizeof(buffer) - 1;
-	int bytes_read;
 	bool is_successful = true;
-
-	while((bytes_read = fread(buffer, 1, bytes_to_read, stream)) > 0)
+	bool is_at_end = false;
+	while(is_successful && !is_at_end)
 	{
-		if(ferror(stream))
+		ring_block* block = next_input_block(reader);
+		if(block == NULL)
 		{
-			perror("Error reading from input stream");
 			is_successful = false;
+			break;
+		}
+		is_successful = !(block->flags & BLOCK_FLAG_ERROR);
+		is_at_end = block->flags & BLOCK_FLAG_END;
+		// The context keeps anything split across blocks, so each block can go straight in.
+		if(is_successful && block->length > 0)
+		{
+			is_successful = bo_process_stream(context, block->data, block->length, DATA_SEGMENT_STREAM);
+		}
+		if(is_successful && (block->flags & BLOCK_FLAG_END_OF_FILE))
+		{
+			is_successful = bo_process_stream(context, "", 0, DATA_SEGMENT_LAST);
 		}
-		buffer[bytes_read] = 0;
-		bo_data_segment_type segment_type = feof(stream) ? DATA_SEGMENT_LAST : DATA_SEGMENT_STREAM;
-		bo_process(context, buffer, bytes_read, segment_type);
+		finish_input_block(reader, block);
+		// Don't hold output back while waiting for more input (from an interactive stream, for example).
+		flush_output(writer);
+	}
+	stop_input_reader(reader);
+	return is_successful;
+}
+
+/**
+ * Compile the commands in the command line arguments.
+ *
+ * @return The program, or NULL if the arguments aren't all commands.
+ */
+static void* compile_arguments(int argc, char* argv[])
+{
+	size_t length = 0;
+	for(int i = 0; i < argc; i++)
+	{
+		length += strlen(argv[i]) + 1;
 	}
-	if(is_successful && ferror(stream))
+	char* commands = (char*)malloc(length + 1);
+	if(commands == NULL)
 	{
-		perror("Error reading from input stream");
-		is_successful = false;
+		return NULL;
 	}
+	char* pos = commands;
+	for(int i = 0; i < argc; i++)
+	{
+		int arg_length = strlen(argv[i]);
+		memcpy(pos, argv[i], arg_length);
+		pos += arg_length;
+		*pos++ = ' ';
+	}
+	void* program = bo_compile(commands, pos - commands, NULL, on_compile_error);
+	free(commands);
+	return program;
+}
 
-	return is_successful;
+/**
+ * Splice the input files straight into the output, if the commands pass binary input through
+ * unchanged and the output is a pipe.
+ *
+ * @return True if the input files were spliced. is_successful is only set in that case.
+ */
+static bool try_spliced_passthrough(int argc, char* argv[], const char** in_filenames, int in_file_count, int out_fd, bool* is_successful)
+{
+	void* program = compile_arguments(argc, argv);
+	bool is_spliced = program != NULL && bo_is_program_passthrough(program) && can_splice_files(out_fd, in_filenames, in_file_count);
+	if(is_spliced)
+	{
+		*is_successful = splice_files(out_fd, in_filenames, in_file_count);
+	}
+	bo_destroy_program(program);
+	return is_spliced;
 }
 
+/**
+ * Convert the input files on a pool of threads, if the commands allow it.
+ *
+ * @return True if the input files were converted in parallel. is_successful is only set in that case.
+ */
+static bool try_parallel_conversion(int argc, char* argv[], const char** in_filenames, int in_file_count, int thread_count, output_writer* writer, bool* is_successful)
+{
+	void* program = compile_arguments(argc, argv);
+	bool is_parallel = program != NULL && can_convert_files_in_parallel(program, in_filenames, in_file_count);
+	if(is_parallel)
+	{
+		*is_successful = convert_files_in_parallel(program, in_filenames, in_file_count, thread_count, writer, write_output, on_error);
+	}
+	bo_destroy_program(program);
+	return is_parallel;
+}
 
 int main(int argc, char* argv[])
 {
 	void* context = NULL;
+	output_writer* writer = NULL;
 	const int max_file_count = 1000;
 	const char* in_filenames[max_file_count];
 	int in_file_count = 0;
@@ -240,9 +310,10 @@ int main(int argc, char* argv[])
 	bool should_print_newline = false;
 	bool has_args = false;
 	bool is_flush_successful = false;
+	int thread_count = 1;
 
 	int opt = 0;
-    while((opt = getopt (argc, argv, "i:o:hnv")) != -1)
+    while((opt = getopt (argc, argv, "i:o:j:hnv")) != -1)
     {
     	switch(opt)
         {
@@ -258,6 +329,19 @@ int main(int argc, char* argv[])
 		    	close_stream(out_stream); // Just in case the user does something stupid
 		    	out_stream = new_output_stream(optarg);
         		break;
+			case 'j':
+			{
+				char* end = NULL;
+				errno = 0;
+				long count = strtol(optarg, &end, 10);
+				if(end == optarg || *end != '\0' || errno != 0 || count < 1 || count > INT_MAX)
+				{
+					fprintf(stderr, "%s: Thread count must be a number from 1 to %d.\n", optarg, INT_MAX);
+					goto failed;
+				}
+				thread_count = (int)count;
+				break;
+			}
 			case 'n':
         		should_print_newline = true;
         		break;
@@ -282,7 +366,28 @@ int main(int argc, char* argv[])
 		goto failed;
 	}
 
-	context = bo_new_context(out_stream, on_output, on_error);
+	if(in_file_count > 0 && try_spliced_passthrough(argc - optind, argv + optind, in_filenames, in_file_count, fileno(out_stream), &is_flush_successful))
+	{
+		goto finished;
+	}
+
+	// Output gets written on a separate thread while this one does the conversion.
+	writer = start_output_writer(fileno(out_stream));
+	if(writer == NULL)
+	{
+		goto failed;
+	}
+
+	if(thread_count > 1 && try_parallel_conversion(argc - optind, argv + optind, in_filenames, in_file_count, thread_count, writer, &is_flush_successful))
+	{
+		goto finished;
+	}
+
+	context = bo_new_context_with_options(writer, write_output, on_error, &g_context_options);
+	if(context == NULL)
+	{
+		goto failed;
+	}
 
 	for(int i = optind; i < argc; i++)
 	{
@@ -292,31 +397,32 @@ int main(int argc, char* argv[])
 		}
 	}
 
-	for(int i = 0; i < in_file_count; i++)
+	if(in_file_count > 0 && !process_input_files(context, writer, in_filenames, in_file_count))
 	{
-		FILE* in_stream = new_input_stream(in_filenames[i]);
-		bool result = process_stream(context, in_stream);
-		close_stream(in_stream);
-		if(!result)
-		{
-			goto failed;
-		}
+		goto failed;
 	}
 
 	is_flush_successful = bo_flush_and_destroy_context(context);
 	context = NULL;
 
+finished:
+	// Wait for the writer to catch up.
+	if(writer != NULL)
+	{
+		is_flush_successful = stop_output_writer(writer) && is_flush_successful;
+		writer = NULL;
+	}
 	if(!is_flush_successful)
 	{
 		goto failed;
 	}
 
 success:
-	teardown(context, out_stream, in_filenames, in_file_count, should_print_newline);
+	teardown(context, writer, out_stream, in_filenames, in_file_count, should_print_newline);
 	return 0;
 
 failed:
 	printf("Use bo -h for help.\n");
-	teardown(context, out_stream, in_filenames, in_file_count, false);
+	teardown(context, writer, out_stream, in_filenames, in_file_count, false);
 	return 1;
 }
@@ -0,0 +1,345 @@
+//  Copyright (c) 2018 Karl Stenerud. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall remain in place
+// in this source code.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "parallel.h"
+
+
+// Files are cut into chunks of this size. It must be a multiple of every split alignment (up to 16).
+#define CHUNK_SIZE (1024 * 1024)
+
+// How many chunks each thread can get ahead of the one being written out.
+#define CHUNKS_IN_FLIGHT_PER_THREAD 2
+
+// More conversion threads than this won't make anything faster.
+#define MAX_THREAD_COUNT 1024
+
+typedef struct
+{
+	const char* data;
+	size_t length;
+} mapped_file;
+
+typedef struct
+{
+	const char* data;
+	int length;
+} input_chunk;
+
+// Holds a chunk's output until it's that chunk's turn to be written out.
+typedef struct
+{
+	char* data;
+	size_t length;
+	size_t capacity;
+	bool is_converted;
+	bool is_successful;
+} chunk_output;
+
+typedef struct
+{
+	const void* program;
+	void* user_data;
+	error_callback on_error;
+	const input_chunk* chunks;
+	long chunk_count;
+	// Chunk n goes in outputs[n % output_count].
+	chunk_output* outputs;
+	size_t output_count;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t output_converted;
+	pthread_cond_t output_written;
+	long next_chunk;
+	long written_count;
+	bool is_cancelled;
+} parallel_conversion;
+
+static bool map_file(const char* filename, mapped_file* file)
+{
+	int fd = open(filename, O_RDONLY);
+	if(fd < 0)
+	{
+		fprintf(stderr, "Could not open %s for reading: %s\n", filename, strerror(errno));
+		return false;
+	}
+
+	struct stat file_stat;
+	bool is_successful = fstat(fd, &file_stat) == 0;
+	file->data = NULL;
+	file->length = is_successful ? (size_t)file_stat.st_size : 0;
+	if(file->length > 0)
+	{
+		void* data = mmap(NULL, file->length, PROT_READ, MAP_PRIVATE, fd, 0);
+		is_successful = data != MAP_FAILED;
+		if(is_successful)
+		{
+			madvise(data, file->length, MADV_SEQUENTIAL);
+			file->data = data;
+		}
+	}
+	if(!is_successful)
+	{
+		fprintf(stderr, "Could not map %s: %s\n", filename, strerror(errno));
+		file->length = 0;
+	}
+	close(fd);
+	return is_successful;
+}
+
+static void unmap_file(mapped_file* file)
+{
+	if(file->data != NULL)
+	{
+		munmap((void*)file->data, file->length);
+	}
+}
+
+static bool append_output(void* user_data, char* data, int length)
+{
+	chunk_output* output = (chunk_output*)user_data;
+	if(output->length + length > output->capacity)
+	{
+		size_t capacity = output->capacity * 2;
+		if(capacity < output->length + length)
+		{
+			capacity = output->length + length;
+		}
+		char* new_data = (char*)realloc(output->data, capacity);
+		if(new_data == NULL)
+		{
+			perror("Could not allocate memory for chunk output");
+			return false;
+		}
+		output->data = new_data;
+		output->capacity = capacity;
+	}
+	memcpy(output->data + output->length, data, length);
+	output->length += length;
+	return true;
+}
+
+static void* convert_chunks(void* void_conversion)
+{
+	parallel_conversion* conversion = (parallel_conversion*)void_conversion;
+	pthread_mutex_lock(&conversion->mutex);
+	while(!conversion->is_cancelled && conversion->next_chunk < conversion->chunk_count)
+	{
+		long index = conversion->next_chunk++;
+		// Wait until this chunk's output slot has been written out.
+		while(!conversion->is_cancelled && (size_t)(index - conversion->written_count) >= conversion->output_count)
+		{
+			pthread_cond_wait(&conversion->output_written, &conversion->mutex);
+		}
+		if(conversion->is_cancelled)
+		{
+			break;
+		}
+		pthread_mutex_unlock(&conversion->mutex);
+
+		const input_chunk* chunk = &conversion->chunks[index];
+		chunk_output* output = &conversion->outputs[(size_t)index % conversion->output_count];
+		output->length = 0;
+		// Every chunk after the first continues on from the one before, so it starts with a suffix.
+		bool is_successful = index == 0
+			? bo_run_program(conversion->program, chunk->data, chunk->length, output, append_output, conversion->on_error)
+			: bo_run_program_continuation(conversion->program, chunk->data, chunk->length, output, append_output, conversion->on_error);
+
+		pthread_mutex_lock(&conversion->mutex);
+		output->is_successful = is_successful;
+		output->is_converted = true;
+		pthread_cond_broadcast(&conversion->output_converted);
+	}
+	pthread_mutex_unlock(&conversion->mutex);
+	return NULL;
+}
+
+/**
+ * Write out the chunks' output in order, as each one gets converted.
+ */
+static bool write_chunks(parallel_conversion* conversion, output_callback on_output)
+{
+	for(long index = 0; index < conversion->chunk_count; index++)
+	{
+		chunk_output* output = &conversion->outputs[(size_t)index % conversion->output_count];
+		pthread_mutex_lock(&conversion->mutex);
+		while(!output->is_converted)
+		{
+			pthread_cond_wait(&conversion->output_converted, &conversion->mutex);
+		}
+		pthread_mutex_unlock(&conversion->mutex);
+
+		if(!output->is_successful)
+		{
+			return false;
+		}
+		if(output->length > 0 && !on_output(conversion->user_data, output->data, output->length))
+		{
+			return false;
+		}
+
+		pthread_mutex_lock(&conversion->mutex);
+		output->is_converted = false;
+		conversion->written_count++;
+		pthread_cond_broadcast(&conversion->output_written);
+		pthread_mutex_unlock(&conversion->mutex);
+	}
+	return true;
+}
+
+bool can_convert_files_in_parallel(const void* program, const char** filenames, int file_count)
+{
+	const int alignment = bo_get_program_split_alignment(program);
+	if(alignment == 0 || file_count == 0)
+	{
+		return false;
+	}
+	for(int i = 0; i < file_count; i++)
+	{
+		struct stat file_stat;
+		if(strcmp(filenames[i], "-") == 0 || stat(filenames[i], &file_stat) != 0 || !S_ISREG(file_stat.st_mode))
+		{
+			return false;
+		}
+		if(i < file_count - 1 && file_stat.st_size % alignment != 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool convert_files_in_parallel(const void* program,
+                               const char** filenames,
+                               int file_count,
+                               int thread_count,
+                               void* user_data,
+                               output_callback on_output,
+                               error_callback on_error)
+{
+	mapped_file* files = (mapped_file*)calloc(file_count, sizeof(*files));
+	bool is_successful = files != NULL;
+	long chunk_count = 0;
+	for(int i = 0; i < file_count && is_successful; i++)
+	{
+		is_successful = map_file(filenames[i], &files[i]);
+		chunk_count += (files[i].length + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	}
+
+	if(thread_count > MAX_THREAD_COUNT)
+	{
+		thread_count = MAX_THREAD_COUNT;
+	}
+	// There's no use for more threads than chunks.
+	if(thread_count > chunk_count)
+	{
+		thread_count = chunk_count > 0 ? (int)chunk_count : 1;
+	}
+	size_t output_count = (size_t)thread_count * CHUNKS_IN_FLIGHT_PER_THREAD;
+
+	input_chunk* chunks = (input_chunk*)malloc(chunk_count * sizeof(*chunks));
+	chunk_output* outputs = (chunk_output*)calloc(output_count, sizeof(*outputs));
+	pthread_t* threads = (pthread_t*)malloc(thread_count * sizeof(*threads));
+	if(is_successful && (chunks == NULL || outputs == NULL || threads == NULL))
+	{
+		perror("Could not allocate memory for parallel conversion");
+		is_successful = false;
+	}
+
+	if(is_successful)
+	{
+		long index = 0;
+		for(int i = 0; i < file_count; i++)
+		{
+			for(size_t offset = 0; offset < files[i].length; offset += CHUNK_SIZE)
+			{
+				size_t length = files[i].length - offset;
+				chunks[index].data = files[i].data + offset;
+				chunks[index].length = length < CHUNK_SIZE ? (int)length : CHUNK_SIZE;
+				index++;
+			}
+		}
+
+		parallel_conversion conversion =
+		{
+			.program = program,
+			.user_data = user_data,
+			.on_error = on_error,
+			.chunks = chunks,
+			.chunk_count = chunk_count,
+			.outputs = outputs,
+			.output_count = output_count,
+			.mutex = PTHREAD_MUTEX_INITIALIZER,
+			.output_converted = PTHREAD_COND_INITIALIZER,
+			.output_written = PTHREAD_COND_INITIALIZER,
+			.next_chunk = 0,
+			.written_count = 0,
+			.is_cancelled = false,
+		};
+
+		int started_count = 0;
+		for(; started_count < thread_count && started_count < chunk_count; started_count++)
+		{
+			int error = pthread_create(&threads[started_count], NULL, convert_chunks, &conversion);
+			if(error != 0)
+			{
+				fprintf(stderr, "Could not start conversion thread: %s\n", strerror(error));
+				break;
+			}
+		}
+		is_successful = chunk_count == 0 || (started_count > 0 && write_chunks(&conversion, on_output));
+
+		pthread_mutex_lock(&conversion.mutex);
+		conversion.is_cancelled = true;
+		pthread_cond_broadcast(&conversion.output_written);
+		pthread_mutex_unlock(&conversion.mutex);
+		for(int i = 0; i < started_count; i++)
+		{
+			pthread_join(threads[i], NULL);
+		}
+		pthread_mutex_destroy(&conversion.mutex);
+		pthread_cond_destroy(&conversion.output_converted);
+		pthread_cond_destroy(&conversion.output_written);
+	}
+
+	for(size_t i = 0; outputs != NULL && i < output_count; i++)
+	{
+		free(outputs[i].data);
+	}
+	for(int i = 0; files != NULL && i < file_count; i++)
+	{
+		unmap_file(&files[i]);
+	}
+	free(threads);
+	free(outputs);
+	free(chunks);
+	free(files);
+	return is_successful;
+}
@@ -0,0 +1,70 @@
+//  Copyright (c) 2018 Karl Stenerud. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall remain in place
+// in this source code.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#ifndef bo_parallel_H
+#define bo_parallel_H
+
+
+#include <stdbool.h>
+#include <bo/bo.h>
+
+
+/**
+ * Check if a set of input files can be converted with convert_files_in_parallel().
+ *
+ * That takes a program whose input can be split (binary input), and regular files that
+ * (other than the last) all end on the program's split alignment, so that no element is
+ * split across files.
+ *
+ * @param program The compiled commands.
+ * @param filenames The input files.
+ * @param file_count The number of input files.
+ * @return True if the files can be converted in parallel.
+ */
+bool can_convert_files_in_parallel(const void* program, const char** filenames, int file_count);
+
+/**
+ * Convert input files on a pool of threads.
+ *
+ * The files are cut into chunks, which are converted in any order, and then passed to the output
+ * callback in order from the calling thread. The output is the same as converting the files one
+ * after the other with a single context.
+ *
+ * @param program The compiled commands.
+ * @param filenames The input files.
+ * @param file_count The number of input files.
+ * @param thread_count The number of conversion threads (at most one per chunk, up to a fixed limit).
+ * @param user_data Passed to the callbacks.
+ * @param on_output Called with the output.
+ * @param on_error Called if an error occurs.
+ * @return True if conversion was successful.
+ */
+bool convert_files_in_parallel(const void* program,
+                               const char** filenames,
+                               int file_count,
+                               int thread_count,
+                               void* user_data,
+                               output_callback on_output,
+                               error_callback on_error);
+
+
+#endif // bo_parallel_H
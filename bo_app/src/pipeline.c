@@ -0,0 +1,816 @@
+//  Copyright (c) 2018 Karl Stenerud. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall remain in place
+// in this source code.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#ifdef HAVE_SPLICE
+// For splice()
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#ifdef __linux__
+#include <sys/vfs.h>
+#endif
+#include "pipeline.h"
+#include "read_queue.h"
+
+
+// Input is read this many bytes at a time.
+#define READ_BLOCK_SIZE (4 * 1024 * 1024)
+
+// Regular files on local storage are memory mapped this many bytes at a time. This must be a
+// multiple of the page size.
+#define MAPPED_WINDOW_SIZE (32 * 1024 * 1024)
+
+// How many blocks of input can be read ahead of the formatter. For files on network storage, this is
+// also how many reads can be in flight at once.
+#define INPUT_BLOCK_COUNT 8
+
+// Output is queued in blocks of up to this size.
+#define OUTPUT_BLOCK_SIZE (1024 * 1024)
+
+// How many blocks of output can be queued up ahead of the writer.
+#define OUTPUT_BLOCK_COUNT 4
+
+// A read into a block, which completes in the background.
+typedef struct
+{
+	read_request request;
+	ring_block* block;
+	size_t bytes_read;
+	bool is_complete;
+	// This is the file's last block, so the file gets closed once it's been read.
+	bool is_end_of_file;
+} block_read;
+
+// The file that reads are currently being submitted for.
+typedef struct
+{
+	int fd;
+	off_t size;
+	off_t offset;
+	bool is_stream;
+	// The file is mapped a window at a time instead of being read into the blocks' buffers.
+	bool is_mapped;
+} input_file;
+
+struct input_reader
+{
+	const char** filenames;
+	int file_count;
+	int next_file_index;
+	input_file file;
+	// NULL until a file on network storage is opened.
+	read_queue* queue;
+	// Blocks are read into in any order, but published in the order they were taken from the ring.
+	block_read reads[INPUT_BLOCK_COUNT];
+	unsigned long taken_count;
+	unsigned long published_count;
+	int in_flight_count;
+	block_ring ring;
+	pthread_t thread;
+};
+
+struct output_writer
+{
+	int fd;
+	// The block that the formatter is filling.
+	ring_block* block;
+	block_ring ring;
+	pthread_t thread;
+	bool is_failed;
+};
+
+
+// ------------
+// Input Reader
+// ------------
+
+static bool read_stream(input_reader* reader, int fd)
+{
+	for(;;)
+	{
+		ring_block* block = ring_begin_write(&reader->ring);
+		if(block == NULL)
+		{
+			return false;
+		}
+		ssize_t bytes_read;
+		do
+		{
+			bytes_read = read(fd, block->buffer, block->capacity);
+		} while(bytes_read < 0 && errno == EINTR);
+		if(bytes_read < 0)
+		{
+			perror("Error reading from input stream");
+			return false;
+		}
+		block->length = bytes_read;
+		if(bytes_read == 0)
+		{
+			block->flags = BLOCK_FLAG_END_OF_FILE;
+		}
+		ring_end_write(&reader->ring);
+		if(bytes_read == 0)
+		{
+			return true;
+		}
+	}
+}
+
+static void close_file(int fd)
+{
+	if(fd != STDIN_FILENO)
+	{
+		close(fd);
+	}
+}
+
+/**
+ * Check if a file is on a network filesystem, where each read takes long enough that it's worth
+ * keeping several in flight rather than mapping the file and faulting it in as it gets used.
+ */
+static bool is_on_network_storage(int fd)
+{
+#ifdef __linux__
+	static const uint32_t network_filesystem_types[] =
+	{
+		0x00006969, // NFS
+		0x0000517b, // SMB
+		0xff534d42, // CIFS
+		0xfe534d42, // SMB2
+		0x0000564c, // NCP
+		0x01021997, // 9P
+		0x00c36400, // Ceph
+		0x0bd00bd0, // Lustre
+		0x47504653, // GPFS
+		0x5346414f, // AFS
+		0x6b414653, // kAFS
+		0x73757245, // Coda
+		0x65735546, // FUSE (sshfs and the like)
+	};
+	struct statfs fs_stat;
+	if(fstatfs(fd, &fs_stat) != 0)
+	{
+		return false;
+	}
+	for(size_t i = 0; i < sizeof(network_filesystem_types) / sizeof(*network_filesystem_types); i++)
+	{
+		if((uint32_t)fs_stat.f_type == network_filesystem_types[i])
+		{
+			return true;
+		}
+	}
+#else
+	(void)fd;
+#endif
+	return false;
+}
+
+static bool open_next_file(input_reader* reader)
+{
+	const char* filename = reader->filenames[reader->next_file_index++];
+	input_file* file = &reader->file;
+	if(strcmp(filename, "-") == 0)
+	{
+		file->fd = STDIN_FILENO;
+		file->is_stream = true;
+		file->is_mapped = false;
+		return true;
+	}
+
+	file->fd = open(filename, O_RDONLY);
+	if(file->fd < 0)
+	{
+		fprintf(stderr, "Could not open %s for reading: %s\n", filename, strerror(errno));
+		return false;
+	}
+	struct stat file_stat;
+	// Pipes and anything else without a fixed size get read as a stream.
+	file->is_stream = fstat(file->fd, &file_stat) != 0 || !S_ISREG(file_stat.st_mode);
+	file->is_mapped = !file->is_stream && !is_on_network_storage(file->fd);
+	file->size = file->is_stream ? 0 : file_stat.st_size;
+	file->offset = 0;
+
+	// Only files on network storage go through the read queue, so it isn't set up until one turns up.
+	if(!file->is_stream && !file->is_mapped && reader->queue == NULL)
+	{
+		reader->queue = read_queue_new(INPUT_BLOCK_COUNT);
+		if(reader->queue == NULL)
+		{
+			perror("Could not start reading input");
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool submit_read(input_reader* reader, read_request* request)
+{
+	if(!read_queue_submit(reader->queue, request))
+	{
+		perror("Could not submit read");
+		return false;
+	}
+	reader->in_flight_count++;
+	return true;
+}
+
+/**
+ * Map the part of the file that a read covers into its block, so that the data never gets copied.
+ * The read is complete as soon as it's mapped.
+ */
+static bool map_block(block_read* read)
+{
+	void* window = mmap(NULL, read->request.length, PROT_READ, MAP_PRIVATE, read->request.fd, read->request.offset);
+	if(window == MAP_FAILED)
+	{
+		perror("Error mapping input file");
+		return false;
+	}
+	madvise(window, read->request.length, MADV_SEQUENTIAL);
+	// Start reading the window in now, so that it's ready by the time the formatter gets to it.
+	madvise(window, read->request.length, MADV_WILLNEED);
+#ifdef MADV_HUGEPAGE
+	// Only takes effect where the kernel supports huge pages for file mappings.
+	madvise(window, read->request.length, MADV_HUGEPAGE);
+#endif
+
+	read->block->data = window;
+	read->block->flags = BLOCK_FLAG_MAPPED;
+	read->bytes_read = read->request.length;
+	read->is_complete = true;
+	return true;
+}
+
+/**
+ * Start reading the next part of the current file into a block.
+ */
+static bool start_block_read(input_reader* reader, ring_block* block)
+{
+	input_file* file = &reader->file;
+	block_read* read = &reader->reads[reader->taken_count++ % INPUT_BLOCK_COUNT];
+	size_t max_length = file->is_mapped ? MAPPED_WINDOW_SIZE : block->capacity;
+	off_t remaining = file->size - file->offset;
+	read->block = block;
+	read->request.fd = file->fd;
+	read->request.length = remaining < (off_t)max_length ? (size_t)remaining : max_length;
+	read->request.offset = file->offset;
+	read->bytes_read = 0;
+	read->is_complete = false;
+	file->offset += read->request.length;
+	read->is_end_of_file = file->offset == file->size;
+	if(read->is_end_of_file)
+	{
+		// The block owns the file from here on.
+		file->fd = -1;
+	}
+	if(read->request.length == 0)
+	{
+		read->is_complete = true;
+		return true;
+	}
+	if(file->is_mapped)
+	{
+		return map_block(read);
+	}
+	read->request.buffer = block->buffer;
+	return submit_read(reader, &read->request);
+}
+
+/**
+ * Publish completed reads in order, stopping at the first one that hasn't completed.
+ */
+static void publish_completed_reads(input_reader* reader)
+{
+	while(reader->published_count < reader->taken_count)
+	{
+		block_read* read = &reader->reads[reader->published_count % INPUT_BLOCK_COUNT];
+		if(!read->is_complete)
+		{
+			return;
+		}
+		read->block->length = read->bytes_read;
+		if(read->is_end_of_file)
+		{
+			read->block->flags |= BLOCK_FLAG_END_OF_FILE;
+			close_file(read->request.fd);
+		}
+		reader->published_count++;
+		ring_end_write(&reader->ring);
+	}
+}
+
+/**
+ * Wait for a read to complete, then publish whatever is ready.
+ *
+ * @param should_continue If true, a short read gets resubmitted to read the rest.
+ * @return False if the read failed.
+ */
+static bool complete_block_read(input_reader* reader, bool should_continue)
+{
+	block_read* read = (block_read*)read_queue_wait(reader->queue);
+	if(read == NULL)
+	{
+		perror("Error waiting for input");
+		// Nothing else can be waited for now.
+		reader->in_flight_count = 0;
+		return false;
+	}
+	reader->in_flight_count--;
+	ssize_t result = read->request.result;
+	if(result < 0)
+	{
+		fprintf(stderr, "Error reading input file: %s\n", strerror((int)-result));
+		return false;
+	}
+
+	read->bytes_read += result;
+	size_t remaining = read->request.length - result;
+	// Reading nothing means the file got shorter since it was opened, so take what's there.
+	if(remaining > 0 && result > 0 && should_continue)
+	{
+		read->request.buffer += result;
+		read->request.length = remaining;
+		read->request.offset += result;
+		return submit_read(reader, &read->request);
+	}
+	read->is_complete = remaining == 0 || result == 0;
+	publish_completed_reads(reader);
+	return read->is_complete;
+}
+
+/**
+ * Read all files, keeping as many reads in flight as there are free blocks. The next file gets
+ * opened as soon as the last read of the current one has been submitted, so that opening it
+ * overlaps with the reads still in flight. Mapped files take a block per window, but nothing is
+ * ever in flight for them.
+ */
+static bool read_files(input_reader* reader)
+{
+	while(reader->file.fd >= 0 || reader->next_file_index < reader->file_count)
+	{
+		if(reader->file.fd < 0)
+		{
+			if(!open_next_file(reader))
+			{
+				return false;
+			}
+			if(reader->file.is_stream)
+			{
+				// Streams can only be read in order, so everything before has to be read first.
+				while(reader->in_flight_count > 0)
+				{
+					if(!complete_block_read(reader, true))
+					{
+						return false;
+					}
+				}
+				bool is_successful = read_stream(reader, reader->file.fd);
+				close_file(reader->file.fd);
+				reader->file.fd = -1;
+				if(!is_successful)
+				{
+					return false;
+				}
+				continue;
+			}
+		}
+
+		// Only wait for a free block when there's nothing in flight to wait for instead.
+		ring_block* block = reader->in_flight_count > 0
+			? ring_try_begin_write(&reader->ring)
+			: ring_begin_write(&reader->ring);
+		if(block != NULL)
+		{
+			if(!start_block_read(reader, block))
+			{
+				return false;
+			}
+			publish_completed_reads(reader);
+		}
+		else if(reader->in_flight_count == 0 || !complete_block_read(reader, true))
+		{
+			return false;
+		}
+	}
+
+	while(reader->in_flight_count > 0)
+	{
+		if(!complete_block_read(reader, true))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static void* read_input(void* void_reader)
+{
+	input_reader* reader = (input_reader*)void_reader;
+	bool is_successful = read_files(reader);
+
+	// After a failure, let the reads in flight finish (their blocks are still being written to), and
+	// publish any that came before the failure.
+	while(reader->in_flight_count > 0)
+	{
+		complete_block_read(reader, false);
+	}
+	if(reader->file.fd >= 0)
+	{
+		close_file(reader->file.fd);
+	}
+	for(unsigned long i = reader->published_count; i < reader->taken_count; i++)
+	{
+		block_read* read = &reader->reads[i % INPUT_BLOCK_COUNT];
+		if(read->is_end_of_file)
+		{
+			close_file(read->request.fd);
+		}
+		if(read->block->flags & BLOCK_FLAG_MAPPED)
+		{
+			munmap(read->block->data, read->request.length);
+			read->block->flags = 0;
+		}
+	}
+
+	// If a read failed, its block is the oldest one still taken, so it becomes the end block.
+	ring_block* block = ring_get_oldest_taken(&reader->ring);
+	if(block == NULL)
+	{
+		block = ring_begin_write(&reader->ring);
+	}
+	if(block != NULL)
+	{
+		block->length = 0;
+		block->flags = is_successful ? BLOCK_FLAG_END : BLOCK_FLAG_ERROR;
+		ring_end_write(&reader->ring);
+	}
+	return NULL;
+}
+
+static void release_input_block(ring_block* block)
+{
+	if(block->flags & BLOCK_FLAG_MAPPED)
+	{
+		munmap(block->data, block->length);
+	}
+}
+
+input_reader* start_input_reader(const char** filenames, int file_count)
+{
+	input_reader* reader = (input_reader*)malloc(sizeof(*reader));
+	if(reader == NULL)
+	{
+		perror("Could not allocate input reader");
+		return NULL;
+	}
+	reader->filenames = filenames;
+	reader->file_count = file_count;
+	reader->next_file_index = 0;
+	reader->file.fd = -1;
+	reader->taken_count = 0;
+	reader->published_count = 0;
+	reader->in_flight_count = 0;
+	reader->queue = NULL;
+	if(!ring_init(&reader->ring, INPUT_BLOCK_COUNT, READ_BLOCK_SIZE))
+	{
+		perror("Could not allocate input blocks");
+		ring_destroy(&reader->ring);
+		free(reader);
+		return NULL;
+	}
+	int error = pthread_create(&reader->thread, NULL, read_input, reader);
+	if(error != 0)
+	{
+		fprintf(stderr, "Could not start reader thread: %s\n", strerror(error));
+		ring_destroy(&reader->ring);
+		free(reader);
+		return NULL;
+	}
+	return reader;
+}
+
+ring_block* next_input_block(input_reader* reader)
+{
+	return ring_begin_read(&reader->ring);
+}
+
+void finish_input_block(input_reader* reader, ring_block* block)
+{
+	release_input_block(block);
+	ring_end_read(&reader->ring);
+}
+
+void stop_input_reader(input_reader* reader)
+{
+	ring_cancel(&reader->ring);
+	pthread_join(reader->thread, NULL);
+
+	// Release anything that was read ahead but never processed.
+	block_ring* ring = &reader->ring;
+	for(unsigned long i = atomic_load(&ring->read_count); i < atomic_load(&ring->write_count); i++)
+	{
+		release_input_block(&ring->blocks[i % ring->block_count]);
+	}
+	if(reader->queue != NULL)
+	{
+		read_queue_free(reader->queue);
+	}
+	ring_destroy(&reader->ring);
+	free(reader);
+}
+
+
+// -------------
+// Output Writer
+// -------------
+
+/**
+ * Write out everything in iovecs, which gets modified along the way.
+ */
+static bool write_all(int fd, struct iovec* iovecs, int count)
+{
+	while(count > 0)
+	{
+		ssize_t written = writev(fd, iovecs, count);
+		if(written < 0)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+			perror("Error writing to output stream");
+			return false;
+		}
+		while(count > 0 && (size_t)written >= iovecs->iov_len)
+		{
+			written -= iovecs->iov_len;
+			iovecs++;
+			count--;
+		}
+		if(count > 0)
+		{
+			iovecs->iov_base = (char*)iovecs->iov_base + written;
+			iovecs->iov_len -= written;
+		}
+	}
+	return true;
+}
+
+static void* write_blocks(void* void_writer)
+{
+	output_writer* writer = (output_writer*)void_writer;
+	bool is_at_end = false;
+	while(!is_at_end)
+	{
+		ring_block* block = ring_begin_read(&writer->ring);
+		if(block == NULL)
+		{
+			break;
+		}
+
+		// Write out every block that's ready in one call.
+		struct iovec iovecs[OUTPUT_BLOCK_COUNT];
+		int count = 0;
+		for(; block != NULL; block = ring_try_begin_read(&writer->ring))
+		{
+			if(block->flags & BLOCK_FLAG_END)
+			{
+				is_at_end = true;
+				break;
+			}
+			iovecs[count].iov_base = block->data;
+			iovecs[count].iov_len = block->length;
+			count++;
+		}
+
+		if(!write_all(writer->fd, iovecs, count))
+		{
+			writer->is_failed = true;
+			// Wake the formatter up if it's waiting for room, so that it sees the failure.
+			ring_cancel(&writer->ring);
+			break;
+		}
+		for(int i = 0; i < count; i++)
+		{
+			ring_end_read(&writer->ring);
+		}
+	}
+	return NULL;
+}
+
+output_writer* start_output_writer(int fd)
+{
+	output_writer* writer = (output_writer*)malloc(sizeof(*writer));
+	if(writer == NULL)
+	{
+		perror("Could not allocate output writer");
+		return NULL;
+	}
+	writer->fd = fd;
+	writer->block = NULL;
+	writer->is_failed = false;
+	if(!ring_init(&writer->ring, OUTPUT_BLOCK_COUNT, OUTPUT_BLOCK_SIZE))
+	{
+		perror("Could not allocate output blocks");
+		ring_destroy(&writer->ring);
+		free(writer);
+		return NULL;
+	}
+	int error = pthread_create(&writer->thread, NULL, write_blocks, writer);
+	if(error != 0)
+	{
+		fprintf(stderr, "Could not start writer thread: %s\n", strerror(error));
+		ring_destroy(&writer->ring);
+		free(writer);
+		return NULL;
+	}
+	return writer;
+}
+
+bool write_output(void* void_writer, char* data, int length)
+{
+	output_writer* writer = (output_writer*)void_writer;
+	while(length > 0)
+	{
+		if(writer->block == NULL)
+		{
+			writer->block = ring_begin_write(&writer->ring);
+			if(writer->block == NULL)
+			{
+				return false;
+			}
+		}
+		ring_block* block = writer->block;
+		size_t space = block->capacity - block->length;
+		size_t copy_length = (size_t)length < space ? (size_t)length : space;
+		memcpy(block->buffer + block->length, data, copy_length);
+		block->length += copy_length;
+		data += copy_length;
+		length -= copy_length;
+		if(block->length == block->capacity)
+		{
+			flush_output(writer);
+		}
+	}
+	return true;
+}
+
+void flush_output(output_writer* writer)
+{
+	if(writer->block != NULL)
+	{
+		ring_end_write(&writer->ring);
+		writer->block = NULL;
+	}
+}
+
+bool stop_output_writer(output_writer* writer)
+{
+	flush_output(writer);
+	ring_block* block = ring_begin_write(&writer->ring);
+	if(block != NULL)
+	{
+		block->flags = BLOCK_FLAG_END;
+		ring_end_write(&writer->ring);
+	}
+	pthread_join(writer->thread, NULL);
+	bool is_successful = !writer->is_failed;
+	ring_destroy(&writer->ring);
+	free(writer);
+	return is_successful;
+}
+
+
+// -------------------
+// Spliced Passthrough
+// -------------------
+
+bool can_splice_files(int out_fd, const char** filenames, int file_count)
+{
+#ifdef HAVE_SPLICE
+	struct stat out_stat;
+	if(file_count == 0 || fstat(out_fd, &out_stat) != 0 || !S_ISFIFO(out_stat.st_mode))
+	{
+		return false;
+	}
+	for(int i = 0; i < file_count; i++)
+	{
+		if(strcmp(filenames[i], "-") == 0)
+		{
+			return false;
+		}
+		int fd = open(filenames[i], O_RDONLY);
+		if(fd < 0)
+		{
+			return false;
+		}
+		struct stat file_stat;
+		bool is_local_file = fstat(fd, &file_stat) == 0 && S_ISREG(file_stat.st_mode) && !is_on_network_storage(fd);
+		close(fd);
+		if(!is_local_file)
+		{
+			return false;
+		}
+	}
+	return true;
+#else
+	(void)out_fd;
+	(void)filenames;
+	(void)file_count;
+	return false;
+#endif
+}
+
+#ifdef HAVE_SPLICE
+static bool splice_file(int out_fd, const char* filename)
+{
+	int fd = open(filename, O_RDONLY);
+	if(fd < 0)
+	{
+		fprintf(stderr, "Could not open %s for reading: %s\n", filename, strerror(errno));
+		return false;
+	}
+	struct stat file_stat;
+	if(fstat(fd, &file_stat) != 0)
+	{
+		fprintf(stderr, "Could not get the size of %s: %s\n", filename, strerror(errno));
+		close(fd);
+		return false;
+	}
+
+	// Only pass on as much as the file held when it was opened, the same as when it's mapped.
+	off_t remaining = file_stat.st_size;
+	while(remaining > 0)
+	{
+		size_t length = remaining < (off_t)SSIZE_MAX ? (size_t)remaining : SSIZE_MAX;
+		ssize_t spliced = splice(fd, NULL, out_fd, NULL, length, SPLICE_F_MORE);
+		if(spliced < 0)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+			perror("Error splicing input to output stream");
+			close(fd);
+			return false;
+		}
+		if(spliced == 0)
+		{
+			// The file got shorter since it was opened.
+			break;
+		}
+		remaining -= spliced;
+	}
+	close(fd);
+	return true;
+}
+#endif
+
+bool splice_files(int out_fd, const char** filenames, int file_count)
+{
+#ifdef HAVE_SPLICE
+	for(int i = 0; i < file_count; i++)
+	{
+		if(!splice_file(out_fd, filenames[i]))
+		{
+			return false;
+		}
+	}
+	return true;
+#else
+	(void)out_fd;
+	(void)filenames;
+	(void)file_count;
+	return false;
+#endif
+}
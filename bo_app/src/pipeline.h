@@ -0,0 +1,141 @@
+//  Copyright (c) 2018 Karl Stenerud. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall remain in place
+// in this source code.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#ifndef bo_pipeline_H
+#define bo_pipeline_H
+
+
+#include <stdbool.h>
+#include <bo/bo.h>
+#include "block_ring.h"
+
+
+// The reader and writer stages each run on their own thread, passing blocks to and from the
+// formatter (the thread that calls the library) through block rings. That way, reading, formatting,
+// and writing all happen at the same time.
+
+typedef struct input_reader input_reader;
+typedef struct output_writer output_writer;
+
+/**
+ * Start reading input files on a new thread.
+ *
+ * Regular files on local storage are memory mapped a large window at a time, so their data goes to
+ * the formatter without being copied. Regular files on network storage are read with several large
+ * reads in flight at once (spanning into the next file near the end of each one), so that slow
+ * storage doesn't hold up the formatter. Everything else (such as stdin, given as "-", or a pipe) is
+ * read as a stream.
+ *
+ * @param filenames The files to read, in order.
+ * @param file_count The number of files.
+ * @return The reader, or NULL if it couldn't be started.
+ */
+input_reader* start_input_reader(const char** filenames, int file_count);
+
+/**
+ * Wait for the next block of input. The last block from each file has BLOCK_FLAG_END_OF_FILE set,
+ * and after the last file comes a block with BLOCK_FLAG_END (or BLOCK_FLAG_ERROR if reading failed).
+ *
+ * @param reader The reader.
+ * @return The block, which must be handed back with finish_input_block().
+ */
+ring_block* next_input_block(input_reader* reader);
+
+/**
+ * Hand back the block from next_input_block() once it's been processed.
+ *
+ * @param reader The reader.
+ * @param block The block.
+ */
+void finish_input_block(input_reader* reader, ring_block* block);
+
+/**
+ * Stop the reader, even if it hasn't finished, and free it.
+ *
+ * @param reader The reader.
+ */
+void stop_input_reader(input_reader* reader);
+
+/**
+ * Start writing output on a new thread.
+ *
+ * Output is written straight to the file descriptor, with everything that's queued up going out in
+ * one call.
+ *
+ * @param fd The file descriptor to write to.
+ * @return The writer, or NULL if it couldn't be started.
+ */
+output_writer* start_output_writer(int fd);
+
+/**
+ * Output callback that queues output for the writer.
+ *
+ * Output is gathered into large blocks, which only get passed to the writer once they're full (or
+ * on flush_output()).
+ *
+ * @param writer The writer.
+ * @param data The output, which gets copied.
+ * @param length The length of the output.
+ * @return False if the writer has failed.
+ */
+bool write_output(void* writer, char* data, int length);
+
+/**
+ * Pass any output gathered so far to the writer.
+ *
+ * @param writer The writer.
+ */
+void flush_output(output_writer* writer);
+
+/**
+ * Wait for the writer to write all queued output, then stop it and free it.
+ *
+ * @param writer The writer.
+ * @return True if all output was written successfully.
+ */
+bool stop_output_writer(output_writer* writer);
+
+/**
+ * Check if input files can be spliced straight into the output instead of being read in and
+ * written out. The output must be a pipe, and the files must all be regular files on local storage.
+ *
+ * @param out_fd The file descriptor that output goes to.
+ * @param filenames The input files.
+ * @param file_count The number of input files.
+ * @return True if splice_files() can be used.
+ */
+bool can_splice_files(int out_fd, const char** filenames, int file_count);
+
+/**
+ * Splice input files into the output pipe, one after the other, for conversions that pass their
+ * input through unchanged. The data goes from the page cache into the pipe without passing through
+ * this process's memory, so the pipe never holds on to buffers that get reused.
+ *
+ * @param out_fd The output pipe.
+ * @param filenames The input files.
+ * @param file_count The number of input files.
+ * @return True if all of the files were spliced successfully.
+ */
+bool splice_files(int out_fd, const char** filenames, int file_count);
+
+
+#endif // bo_pipeline_H
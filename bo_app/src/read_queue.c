@@ -0,0 +1,400 @@
+//  Copyright (c) 2018 Karl Stenerud. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall remain in place
+// in this source code.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "read_queue.h"
+
+#ifdef HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+
+#ifdef HAVE_IO_URING
+typedef struct
+{
+	int fd;
+	unsigned* sq_tail;
+	unsigned* sq_mask;
+	unsigned* sq_array;
+	unsigned* cq_head;
+	unsigned* cq_tail;
+	unsigned* cq_mask;
+	struct io_uring_sqe* sqes;
+	struct io_uring_cqe* cqes;
+	void* sq_ring;
+	size_t sq_ring_size;
+	void* cq_ring;
+	size_t cq_ring_size;
+	size_t sqes_size;
+} uring;
+#endif
+
+typedef struct
+{
+	pthread_t* threads;
+	unsigned thread_count;
+	pthread_mutex_t mutex;
+	pthread_cond_t submitted;
+	pthread_cond_t completed;
+	// Both are first in, first out lists, linked through the requests.
+	read_request* pending_head;
+	read_request* pending_tail;
+	read_request* completed_head;
+	read_request* completed_tail;
+	bool is_stopping;
+} thread_pool;
+
+struct read_queue
+{
+#ifdef HAVE_IO_URING
+	bool is_using_uring;
+	uring uring;
+#endif
+	thread_pool pool;
+};
+
+static void push_request(read_request** head, read_request** tail, read_request* request)
+{
+	request->next = NULL;
+	if(*tail == NULL)
+	{
+		*head = request;
+	}
+	else
+	{
+		(*tail)->next = request;
+	}
+	*tail = request;
+}
+
+static read_request* pop_request(read_request** head, read_request** tail)
+{
+	read_request* request = *head;
+	*head = request->next;
+	if(*head == NULL)
+	{
+		*tail = NULL;
+	}
+	return request;
+}
+
+
+// --------
+// io_uring
+// --------
+
+#ifdef HAVE_IO_URING
+
+static int uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+	int result;
+	do
+	{
+		result = syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+	} while(result < 0 && errno == EINTR);
+	return result;
+}
+
+static void uring_destroy(uring* ring)
+{
+	if(ring->sqes != NULL && ring->sqes != MAP_FAILED)
+	{
+		munmap(ring->sqes, ring->sqes_size);
+	}
+	if(ring->cq_ring != NULL && ring->cq_ring != MAP_FAILED && ring->cq_ring != ring->sq_ring)
+	{
+		munmap(ring->cq_ring, ring->cq_ring_size);
+	}
+	if(ring->sq_ring != NULL && ring->sq_ring != MAP_FAILED)
+	{
+		munmap(ring->sq_ring, ring->sq_ring_size);
+	}
+	close(ring->fd);
+}
+
+/**
+ * Set up an io_uring. This fails where the kernel is too old or io_uring is disabled (as it often
+ * is in containers), in which case the thread pool gets used instead.
+ */
+static bool uring_init(uring* ring, unsigned depth)
+{
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	memset(ring, 0, sizeof(*ring));
+	ring->fd = syscall(__NR_io_uring_setup, depth, &params);
+	if(ring->fd < 0)
+	{
+		return false;
+	}
+
+	ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	if(params.features & IORING_FEAT_SINGLE_MMAP)
+	{
+		if(ring->cq_ring_size > ring->sq_ring_size)
+		{
+			ring->sq_ring_size = ring->cq_ring_size;
+		}
+		ring->cq_ring_size = ring->sq_ring_size;
+	}
+	ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+	ring->cq_ring = (params.features & IORING_FEAT_SINGLE_MMAP)
+		? ring->sq_ring
+		: mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+	ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+	if(ring->sq_ring == MAP_FAILED || ring->cq_ring == MAP_FAILED || ring->sqes == MAP_FAILED)
+	{
+		uring_destroy(ring);
+		return false;
+	}
+
+	char* sq = (char*)ring->sq_ring;
+	char* cq = (char*)ring->cq_ring;
+	ring->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+	ring->sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+	ring->sq_array = (unsigned*)(sq + params.sq_off.array);
+	ring->cq_head = (unsigned*)(cq + params.cq_off.head);
+	ring->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+	ring->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+	return true;
+}
+
+static bool uring_submit(uring* ring, read_request* request)
+{
+	// Only this thread touches the submission tail, but the kernel reads it.
+	unsigned tail = *ring->sq_tail;
+	unsigned index = tail & *ring->sq_mask;
+	struct io_uring_sqe* sqe = &ring->sqes[index];
+	memset(sqe, 0, sizeof(*sqe));
+	// READV rather than READ, since it goes back further in kernel versions.
+	sqe->opcode = IORING_OP_READV;
+	sqe->fd = request->fd;
+	sqe->addr = (uint64_t)(uintptr_t)&request->iovec;
+	sqe->len = 1;
+	sqe->off = request->offset;
+	sqe->user_data = (uint64_t)(uintptr_t)request;
+	ring->sq_array[index] = index;
+	__atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+	return uring_enter(ring->fd, 1, 0, 0) == 1;
+}
+
+static read_request* uring_wait(uring* ring)
+{
+	for(;;)
+	{
+		unsigned head = *ring->cq_head;
+		if(head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE))
+		{
+			struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cq_mask];
+			read_request* request = (read_request*)(uintptr_t)cqe->user_data;
+			request->result = cqe->res;
+			__atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+			return request;
+		}
+		if(uring_enter(ring->fd, 0, 1, IORING_ENTER_GETEVENTS) < 0)
+		{
+			return NULL;
+		}
+	}
+}
+
+#endif // HAVE_IO_URING
+
+
+// -----------
+// Thread Pool
+// -----------
+
+static void* read_requests(void* void_pool)
+{
+	thread_pool* pool = (thread_pool*)void_pool;
+	pthread_mutex_lock(&pool->mutex);
+	for(;;)
+	{
+		while(!pool->is_stopping && pool->pending_head == NULL)
+		{
+			pthread_cond_wait(&pool->submitted, &pool->mutex);
+		}
+		if(pool->is_stopping)
+		{
+			break;
+		}
+		read_request* request = pop_request(&pool->pending_head, &pool->pending_tail);
+		pthread_mutex_unlock(&pool->mutex);
+
+		ssize_t result;
+		do
+		{
+			result = pread(request->fd, request->buffer, request->length, request->offset);
+		} while(result < 0 && errno == EINTR);
+		request->result = result < 0 ? -errno : result;
+
+		pthread_mutex_lock(&pool->mutex);
+		push_request(&pool->completed_head, &pool->completed_tail, request);
+		pthread_cond_signal(&pool->completed);
+	}
+	pthread_mutex_unlock(&pool->mutex);
+	return NULL;
+}
+
+static void pool_destroy(thread_pool* pool)
+{
+	pthread_mutex_lock(&pool->mutex);
+	pool->is_stopping = true;
+	pthread_cond_broadcast(&pool->submitted);
+	pthread_mutex_unlock(&pool->mutex);
+	for(unsigned i = 0; i < pool->thread_count; i++)
+	{
+		pthread_join(pool->threads[i], NULL);
+	}
+	free(pool->threads);
+	pthread_mutex_destroy(&pool->mutex);
+	pthread_cond_destroy(&pool->submitted);
+	pthread_cond_destroy(&pool->completed);
+}
+
+/**
+ * Start a thread for each read that can be in flight.
+ */
+static bool pool_init(thread_pool* pool, unsigned depth)
+{
+	memset(pool, 0, sizeof(*pool));
+	pthread_mutex_init(&pool->mutex, NULL);
+	pthread_cond_init(&pool->submitted, NULL);
+	pthread_cond_init(&pool->completed, NULL);
+	pool->threads = (pthread_t*)malloc(depth * sizeof(*pool->threads));
+	if(pool->threads == NULL)
+	{
+		pool_destroy(pool);
+		return false;
+	}
+	for(; pool->thread_count < depth; pool->thread_count++)
+	{
+		if(pthread_create(&pool->threads[pool->thread_count], NULL, read_requests, pool) != 0)
+		{
+			break;
+		}
+	}
+	if(pool->thread_count == 0)
+	{
+		pool_destroy(pool);
+		return false;
+	}
+	return true;
+}
+
+static void pool_submit(thread_pool* pool, read_request* request)
+{
+	pthread_mutex_lock(&pool->mutex);
+	push_request(&pool->pending_head, &pool->pending_tail, request);
+	pthread_cond_signal(&pool->submitted);
+	pthread_mutex_unlock(&pool->mutex);
+}
+
+static read_request* pool_wait(thread_pool* pool)
+{
+	pthread_mutex_lock(&pool->mutex);
+	while(pool->completed_head == NULL)
+	{
+		pthread_cond_wait(&pool->completed, &pool->mutex);
+	}
+	read_request* request = pop_request(&pool->completed_head, &pool->completed_tail);
+	pthread_mutex_unlock(&pool->mutex);
+	return request;
+}
+
+
+// ----------
+// Read Queue
+// ----------
+
+read_queue* read_queue_new(unsigned depth)
+{
+	read_queue* queue = (read_queue*)malloc(sizeof(*queue));
+	if(queue == NULL)
+	{
+		return NULL;
+	}
+#ifdef HAVE_IO_URING
+	queue->is_using_uring = uring_init(&queue->uring, depth);
+	if(queue->is_using_uring)
+	{
+		return queue;
+	}
+#endif
+	if(!pool_init(&queue->pool, depth))
+	{
+		free(queue);
+		return NULL;
+	}
+	return queue;
+}
+
+void read_queue_free(read_queue* queue)
+{
+#ifdef HAVE_IO_URING
+	if(queue->is_using_uring)
+	{
+		uring_destroy(&queue->uring);
+		free(queue);
+		return;
+	}
+#endif
+	pool_destroy(&queue->pool);
+	free(queue);
+}
+
+bool read_queue_submit(read_queue* queue, read_request* request)
+{
+	request->iovec.iov_base = request->buffer;
+	request->iovec.iov_len = request->length;
+#ifdef HAVE_IO_URING
+	if(queue->is_using_uring)
+	{
+		return uring_submit(&queue->uring, request);
+	}
+#endif
+	pool_submit(&queue->pool, request);
+	return true;
+}
+
+read_request* read_queue_wait(read_queue* queue)
+{
+#ifdef HAVE_IO_URING
+	if(queue->is_using_uring)
+	{
+		return uring_wait(&queue->uring);
+	}
+#endif
+	return pool_wait(&queue->pool);
+}
@@ -0,0 +1,93 @@
+//  Copyright (c) 2018 Karl Stenerud. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall remain in place
+// in this source code.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+
+#ifndef bo_read_queue_H
+#define bo_read_queue_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+
+/**
+ * A read from a file at an offset, which completes some time after it's submitted.
+ */
+typedef struct read_request
+{
+	int fd;
+	char* buffer;
+	size_t length;
+	off_t offset;
+	// The number of bytes read, or -errno if the read failed. Set when the request completes.
+	ssize_t result;
+
+	// Private
+	struct iovec iovec;
+	struct read_request* next;
+} read_request;
+
+/**
+ * Keeps many reads in flight at once, so that the latency of each read (which can be large on
+ * network storage) overlaps with all the others.
+ *
+ * Reads go through io_uring where the kernel supports it, or through a pool of threads calling
+ * pread() otherwise.
+ */
+typedef struct read_queue read_queue;
+
+/**
+ * Create a read queue.
+ *
+ * @param depth The most reads that will be in flight at once.
+ * @return The queue, or NULL if it couldn't be created.
+ */
+read_queue* read_queue_new(unsigned depth);
+
+/**
+ * Free a read queue. There must be no reads in flight.
+ *
+ * @param queue The queue.
+ */
+void read_queue_free(read_queue* queue);
+
+/**
+ * Submit a read. The request must stay valid until it's returned by read_queue_wait().
+ *
+ * @param queue The queue.
+ * @param request The read to make.
+ * @return False if the read couldn't be submitted.
+ */
+bool read_queue_submit(read_queue* queue, read_request* request);
+
+/**
+ * Wait for a read to complete. Reads can complete in any order.
+ *
+ * @param queue The queue.
+ * @return The completed request, or NULL if waiting failed.
+ */
+read_request* read_queue_wait(read_queue* queue);
+
+
+#endif // bo_read_queue_H
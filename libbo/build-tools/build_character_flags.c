@@ -24,7 +24,7 @@
 // basic characters.
 //
 // Just compile this file as a command line program and run. It will output the
-// enum and character table as a header file to stdout.
+// enum, character table, and SIMD nibble lookup tables as a header file to stdout.
 
 
 // -------------
@@ -92,6 +92,7 @@ static const char* const g_character_flag_names[] =
 // -----
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -233,6 +234,74 @@ static void print_enum()
     printf("} %s;\n", ENUM_NAME);
 }
 
+/**
+ * Print a pair of nibble lookup tables for a flag, so that SIMD code can classify
+ * a whole vector of bytes with two byte shuffles:
+ *
+ *     has_flag = low_nibbles[ch & 0x0f] & high_nibbles[ch >> 4]
+ *
+ * Each distinct set of low nibbles that has the flag (one set per high nibble) gets
+ * its own bit, so this works for any flag with at most 8 such sets.
+ */
+static void print_nibble_tables(character_flag flag, const char* table_name)
+{
+    uint16_t row_masks[8] = {0};
+    int row_count = 0;
+    unsigned char low_nibbles[16] = {0};
+    unsigned char high_nibbles[16] = {0};
+
+    for(int high = 0; high < 16; high++)
+    {
+        uint16_t row_mask = 0;
+        for(int low = 0; low < 16; low++)
+        {
+            if(is_character_flag_set(high << 4 | low, flag))
+            {
+                row_mask |= 1 << low;
+            }
+        }
+        if(row_mask == 0)
+        {
+            continue;
+        }
+        int row = 0;
+        while(row < row_count && row_masks[row] != row_mask)
+        {
+            row++;
+        }
+        if(row == row_count)
+        {
+            if(row_count == 8)
+            {
+                fprintf(stderr, "Flag %s has too many nibble patterns for a lookup table\n", get_flag_name(flag));
+                exit(1);
+            }
+            row_masks[row_count++] = row_mask;
+        }
+        high_nibbles[high] = 1 << row;
+        for(int low = 0; low < 16; low++)
+        {
+            if(row_mask & (1 << low))
+            {
+                low_nibbles[low] |= 1 << row;
+            }
+        }
+    }
+
+    printf("static const unsigned char %s_low_nibbles[16] =\n{\n   ", table_name);
+    for(int i = 0; i < 16; i++)
+    {
+        printf(" 0x%02x,", low_nibbles[i]);
+    }
+    printf("\n};\n\n");
+    printf("static const unsigned char %s_high_nibbles[16] =\n{\n   ", table_name);
+    for(int i = 0; i < 16; i++)
+    {
+        printf(" 0x%02x,", high_nibbles[i]);
+    }
+    printf("\n};\n");
+}
+
 static void print_table()
 {
     const int table_length = sizeof(g_character_flags) / sizeof(*g_character_flags);
@@ -401,6 +470,8 @@ int main(void)
     print_enum();
     printf("\n");
     print_table();
+    printf("\n");
+    print_nibble_tables(WHITESPACE, "g_whitespace");
 
     printf(
         "\n"
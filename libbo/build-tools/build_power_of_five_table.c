@@ -0,0 +1,289 @@
+//  Copyright (c) 2018 Karl Stenerud. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall remain in place
+// in this source code.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+// Generates a header file containing the 128-bit powers of five that the
+// Eisel-Lemire decimal to binary float conversion multiplies by.
+//
+// Just compile this file as a command line program and run. It will output the
+// table as a header file to stdout.
+
+
+// -------------
+// Configuration
+// -------------
+
+#define TABLE_NAME           "g_power_of_five_128"
+#define SMALLEST_POWER_NAME  "POWER_OF_FIVE_128_SMALLEST_POWER"
+#define LARGEST_POWER_NAME   "POWER_OF_FIVE_128_LARGEST_POWER"
+
+// Enough to cover every power of ten that can produce a finite, nonzero double
+// from a significand of up to 19 digits.
+#define SMALLEST_POWER -342
+#define LARGEST_POWER  308
+
+// Negative powers that still fit exactly in 128 bits once inverted. Past this,
+// the inverse is computed with extra precision and then truncated.
+#define SMALLEST_EXACT_INVERSE_POWER -27
+
+
+
+// -----
+// Setup
+// -----
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+// Large enough for 2^(2 * bits(5^342) + 128).
+#define BIG_INTEGER_WORD_COUNT 64
+
+// Unsigned arbitrary precision integer, least significant word first.
+typedef struct
+{
+    uint32_t words[BIG_INTEGER_WORD_COUNT];
+} big_integer;
+
+
+
+// -------
+// Utility
+// -------
+
+static void big_set(big_integer* value, uint32_t small_value)
+{
+    memset(value, 0, sizeof(*value));
+    value->words[0] = small_value;
+}
+
+static void big_multiply_small(big_integer* value, uint32_t multiplier)
+{
+    uint64_t carry = 0;
+    for(int i = 0; i < BIG_INTEGER_WORD_COUNT; i++)
+    {
+        uint64_t product = (uint64_t)value->words[i] * multiplier + carry;
+        value->words[i] = (uint32_t)product;
+        carry = product >> 32;
+    }
+}
+
+static void big_add_small(big_integer* value, uint32_t addend)
+{
+    uint64_t carry = addend;
+    for(int i = 0; i < BIG_INTEGER_WORD_COUNT && carry != 0; i++)
+    {
+        uint64_t sum = (uint64_t)value->words[i] + carry;
+        value->words[i] = (uint32_t)sum;
+        carry = sum >> 32;
+    }
+}
+
+static void big_shift_left_1(big_integer* value)
+{
+    for(int i = BIG_INTEGER_WORD_COUNT - 1; i > 0; i--)
+    {
+        value->words[i] = (value->words[i] << 1) | (value->words[i - 1] >> 31);
+    }
+    value->words[0] <<= 1;
+}
+
+static void big_shift_right_1(big_integer* value)
+{
+    for(int i = 0; i < BIG_INTEGER_WORD_COUNT - 1; i++)
+    {
+        value->words[i] = (value->words[i] >> 1) | (value->words[i + 1] << 31);
+    }
+    value->words[BIG_INTEGER_WORD_COUNT - 1] >>= 1;
+}
+
+static int big_compare(const big_integer* a, const big_integer* b)
+{
+    for(int i = BIG_INTEGER_WORD_COUNT - 1; i >= 0; i--)
+    {
+        if(a->words[i] != b->words[i])
+        {
+            return a->words[i] < b->words[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+static void big_subtract(big_integer* value, const big_integer* subtrahend)
+{
+    int64_t borrow = 0;
+    for(int i = 0; i < BIG_INTEGER_WORD_COUNT; i++)
+    {
+        int64_t difference = (int64_t)value->words[i] - subtrahend->words[i] - borrow;
+        borrow = difference < 0;
+        value->words[i] = (uint32_t)(difference + (borrow << 32));
+    }
+}
+
+static int big_get_bit_length(const big_integer* value)
+{
+    for(int i = BIG_INTEGER_WORD_COUNT - 1; i >= 0; i--)
+    {
+        if(value->words[i] != 0)
+        {
+            return i * 32 + 32 - __builtin_clz(value->words[i]);
+        }
+    }
+    return 0;
+}
+
+static void big_set_power_of_five(big_integer* value, int power)
+{
+    big_set(value, 1);
+    for(int i = 0; i < power; i++)
+    {
+        big_multiply_small(value, 5);
+    }
+}
+
+/**
+ * Set quotient to 2^power / divisor, using binary long division.
+ */
+static void big_divide_power_of_two(big_integer* quotient, int power, const big_integer* divisor)
+{
+    big_integer remainder;
+    big_set(&remainder, 0);
+    big_set(quotient, 0);
+    for(int bit = power; bit >= 0; bit--)
+    {
+        big_shift_left_1(&remainder);
+        big_shift_left_1(quotient);
+        if(bit == power)
+        {
+            remainder.words[0] |= 1;
+        }
+        if(big_compare(&remainder, divisor) >= 0)
+        {
+            big_subtract(&remainder, divisor);
+            quotient->words[0] |= 1;
+        }
+    }
+}
+
+
+
+// --------
+// Printing
+// --------
+
+static void print_entry(const big_integer* value, int power)
+{
+    uint64_t high = (uint64_t)value->words[3] << 32 | value->words[2];
+    uint64_t low = (uint64_t)value->words[1] << 32 | value->words[0];
+    printf("    0x%016llxULL, 0x%016llxULL, // 5^%d\n", (unsigned long long)high, (unsigned long long)low, power);
+}
+
+/**
+ * Print 5^power as a 128-bit value with its top bit set, truncating any lower bits.
+ */
+static void print_positive_power(int power)
+{
+    big_integer value;
+    big_set_power_of_five(&value, power);
+    while(big_get_bit_length(&value) < 128)
+    {
+        big_shift_left_1(&value);
+    }
+    while(big_get_bit_length(&value) > 128)
+    {
+        big_shift_right_1(&value);
+    }
+    print_entry(&value, power);
+}
+
+/**
+ * Print 5^power (with power < 0) as a 128-bit value with its top bit set, rounded up.
+ */
+static void print_negative_power(int power)
+{
+    big_integer divisor;
+    big_set_power_of_five(&divisor, -power);
+    const int divisor_bits = big_get_bit_length(&divisor);
+
+    big_integer value;
+    if(power >= SMALLEST_EXACT_INVERSE_POWER)
+    {
+        big_divide_power_of_two(&value, divisor_bits + 127, &divisor);
+        big_add_small(&value, 1);
+    }
+    else
+    {
+        big_divide_power_of_two(&value, divisor_bits * 2 + 128, &divisor);
+        big_add_small(&value, 1);
+        while(big_get_bit_length(&value) > 128)
+        {
+            big_shift_right_1(&value);
+        }
+    }
+    print_entry(&value, power);
+}
+
+
+
+// -------
+// Program
+// -------
+
+int main(void)
+{
+    printf(
+        "/* This file generated by " __FILE__ " */\n"
+        "\n"
+        "#ifndef ks_power_of_five_table_H\n"
+        "#define ks_power_of_five_table_H\n"
+        "#ifdef __cplusplus\n"
+        "extern \"C\" {\n"
+        "#endif\n"
+        "\n"
+        "#include <stdint.h>\n"
+        "\n"
+        "\n"
+        );
+
+    printf("#define %s %d\n", SMALLEST_POWER_NAME, SMALLEST_POWER);
+    printf("#define %s %d\n", LARGEST_POWER_NAME, LARGEST_POWER);
+    printf("\n");
+    printf("// The high and low 64 bits of each power of five, normalized so that the top bit is set.\n");
+    printf("static const uint64_t %s[] =\n{\n", TABLE_NAME);
+    for(int power = SMALLEST_POWER; power < 0; power++)
+    {
+        print_negative_power(power);
+    }
+    for(int power = 0; power <= LARGEST_POWER; power++)
+    {
+        print_positive_power(power);
+    }
+    printf("};\n");
+
+    printf(
+        "\n"
+        "\n"
+        "#ifdef __cplusplus\n"
+        "}\n"
+        "#endif\n"
+        "#endif // ks_power_of_five_table_H\n"
+        );
+}
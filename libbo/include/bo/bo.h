@@ -34,7 +34,7 @@ extern "C" {
  * Callback to notify of new output data.
  *
  * @param user_data The user data object that was passed to the context that generated this call.
- * @param data The data.
+ * @param data The data. This may point into the input being processed, so it must not be modified.
  * @param length The length of the data in bytes.
  * @return true if the receiver of this message successfully processed it.
  */
@@ -48,6 +48,25 @@ typedef bool (*output_callback)(void* user_data, char* data, int length);
  */
 typedef void (*error_callback)(void* user_data, const char* message);
 
+/**
+ * Options for tuning a context's memory use and throughput.
+ *
+ * Any field left as 0 gets its default value, so zero-initialize the struct and set only what you need.
+ */
+typedef struct
+{
+	// Bytes of binary data held before converting it to the output format (default 1600, minimum 16).
+	int work_buffer_size;
+	// Convert once this many bytes of binary data are held (default and maximum: work_buffer_size).
+	int work_buffer_high_water;
+	// Bytes of output held before calling the output callback (default 16000). Grows if an entry is larger.
+	int output_buffer_size;
+	// Call the output callback once this many bytes of output are held (default and maximum: output_buffer_size).
+	int output_buffer_high_water;
+	// Memory alignment of the buffers, a power of 2 (default: whatever malloc gives).
+	int buffer_alignment;
+} bo_context_options;
+
 typedef enum
 {
 	DATA_SEGMENT_STREAM, // This is one data segment of many.
@@ -70,6 +89,23 @@ const char* bo_version();
  */
 void* bo_new_context(void* user_data, output_callback on_output, error_callback on_error);
 
+/**
+ * Create a new bo context with custom options.
+ *
+ * Large buffers reduce the number of output callbacks when converting bulk data.
+ * Small buffers reduce memory use when embedding.
+ *
+ * @param user_data User-specified contextual data.
+ * @param on_output Called whenever there's processed output data.
+ * @param on_error Called if an error occurs while processing, or if the options are invalid.
+ * @param options The context options. NULL means use the defaults.
+ * @return The new context, or NULL if the options are invalid.
+ */
+void* bo_new_context_with_options(void* user_data,
+                                  output_callback on_output,
+                                  error_callback on_error,
+                                  const bo_context_options* options);
+
 /**
  * Flushes a context's output and destroys the context.
  *
@@ -93,14 +129,164 @@ bool bo_flush_and_destroy_context(void* context);
  *
  * Remember to call bo_flush_and_destroy_context() when all processing is finished.
  *
+ * The data is never modified, so it can be read-only memory (such as a memory mapped file).
+ *
+ * @param context A context created by bo_new_context().
+ * @param data The data to process.
+ * @param data_length The length of the data.
+ * @param data_segment_type Whether this is the middle or the end of a stream of data.
+ * @return A pointer to one past the last byte processed, or NULL if an error occurred.
+ */
+const char* bo_process_const(void* context, const char* data, int data_length, bo_data_segment_type data_segment_type);
+
+/**
+ * Same as bo_process_const(), for callers holding a mutable buffer. The data is not modified.
+ *
  * @param context A context created by bo_new_context().
- * @param data The data to process. DATA WILL BE MODIFIED DURING PARSE!
+ * @param data The data to process.
  * @param data_length The length of the data.
  * @param data_segment_type Whether this is the middle or the end of a stream of data.
- * @return A pointer to one past the last byte processed.
+ * @return A pointer to one past the last byte processed, or NULL if an error occurred.
  */
 char* bo_process(void* context, char* data, int data_length, bo_data_segment_type data_segment_type);
 
+/**
+ * Process a chunk of data, keeping any incomplete command or data at the end inside the context
+ * until the next call completes it. Chunks can therefore be split anywhere (e.g. straight from
+ * read() or a socket), and there's no need to move unprocessed data around between calls.
+ *
+ * Use DATA_SEGMENT_STREAM for each chunk, and then DATA_SEGMENT_LAST for the last one (which can
+ * be empty).
+ *
+ * Don't call bo_process() or bo_process_into() on the same context while data is being carried over.
+ *
+ * @param context A context created by bo_new_context().
+ * @param data The data to process. It is not modified.
+ * @param data_length The length of the data.
+ * @param data_segment_type Whether this is the middle or the end of a stream of data.
+ * @return True if processing was successful.
+ */
+bool bo_process_stream(void* context, const char* data, int data_length, bo_data_segment_type data_segment_type);
+
+/**
+ * Process a chunk of data, writing the output directly into a caller-supplied buffer instead of
+ * passing it to the output callback.
+ *
+ * Processing stops soon after the output buffer fills. Output that didn't fit is held in the context,
+ * and is written first on the next call. Keep calling (passing in any unconsumed input again) until
+ * all input is consumed and produced is less than output_capacity.
+ *
+ * With DATA_SEGMENT_LAST, once all input is consumed, everything still buffered in the context is
+ * converted as well, so that all output can be pulled before destroying the context.
+ *
+ * @param context A context created by bo_new_context(). If only this function is used to process
+ *                data, the context's output callback can be NULL.
+ * @param input The data to process. It is not modified.
+ * @param input_length The length of the data.
+ * @param data_segment_type Whether this is the middle or the end of a stream of data.
+ * @param output The buffer to write output to.
+ * @param output_capacity The size of the output buffer.
+ * @param consumed out: The number of input bytes processed.
+ * @param produced out: The number of output bytes written.
+ * @return True if processing was successful.
+ */
+bool bo_process_into(void* context,
+                     const char* input,
+                     int input_length,
+                     bo_data_segment_type data_segment_type,
+                     char* output,
+                     int output_capacity,
+                     int* consumed,
+                     int* produced);
+
+/**
+ * Compile commands into a program, which can then be run against many inputs without parsing the
+ * commands or setting up the output format each time.
+ *
+ * A program is never modified after it's compiled, so it can be run from many threads at once.
+ *
+ * @param commands The commands to compile (such as "iB2l oh2b4 Pc"). They must not contain any data.
+ * @param commands_length The length of the commands.
+ * @param user_data Passed to the error callback.
+ * @param on_error Called if the commands are invalid.
+ * @return The program, or NULL if an error occurred.
+ */
+void* bo_compile(const char* commands, int commands_length, void* user_data, error_callback on_error);
+
+/**
+ * Destroy a program created by bo_compile().
+ *
+ * @param program The program.
+ */
+void bo_destroy_program(void* program);
+
+/**
+ * Run a program against a complete input, converting and passing on all of its output before returning.
+ *
+ * The input is processed as if by a new context set up by the program's commands. It may contain more
+ * commands, which only affect this run. The context and its buffers live on the stack, so there is
+ * no per-run allocation or setup beyond copying the program.
+ *
+ * @param program A program created by bo_compile().
+ * @param data The data to process. It is not modified.
+ * @param data_length The length of the data.
+ * @param user_data Passed to the callbacks.
+ * @param on_output Called with the output.
+ * @param on_error Called if an error occurs.
+ * @return True if processing was successful.
+ */
+bool bo_run_program(const void* program,
+                    const char* data,
+                    int data_length,
+                    void* user_data,
+                    output_callback on_output,
+                    error_callback on_error);
+
+/**
+ * Run a program against one part of a larger binary input, after the parts before it have been run.
+ *
+ * This is the same as bo_run_program(), except that the output continues on from the output of
+ * the earlier parts, so it begins with the suffix. Use bo_run_program() for the first part.
+ *
+ * The parts can be run in any order (or all at once on different threads), as long as the outputs
+ * get joined back together in order.
+ *
+ * @param program A program created by bo_compile().
+ * @param data The data to process. It must start on a bo_get_program_split_alignment() boundary.
+ * @param data_length The length of the data.
+ * @param user_data Passed to the callbacks.
+ * @param on_output Called with the output.
+ * @param on_error Called if an error occurs.
+ * @return True if processing was successful.
+ */
+bool bo_run_program_continuation(const void* program,
+                                 const char* data,
+                                 int data_length,
+                                 void* user_data,
+                                 output_callback on_output,
+                                 error_callback on_error);
+
+/**
+ * Get the boundary that a program's input can be split on, so that the parts can be run separately.
+ *
+ * Only binary input can be split, and only when the output isn't a string.
+ *
+ * @param program A program created by bo_compile().
+ * @return The alignment in bytes that every part except the last must be a multiple of,
+ *         or 0 if the input can't be split.
+ */
+int bo_get_program_split_alignment(const void* program);
+
+/**
+ * Check if a program passes binary input through to its output unchanged (binary input and output,
+ * with no byte swapping on either side). The caller can then copy the input to wherever the output
+ * goes, without running the program at all.
+ *
+ * @param program A program created by bo_compile().
+ * @return True if the output is always the same as the input.
+ */
+bool bo_is_program_passthrough(const void* program);
+
 
 #ifdef __cplusplus
 }
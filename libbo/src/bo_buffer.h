@@ -42,15 +42,51 @@ typedef struct
 } bo_buffer;
 
 
-static inline bo_buffer buffer_alloc(int size, int overhead)
+/**
+ * Allocate a buffer that reaches high water at high_water bytes, with room for size bytes.
+ *
+ * @param alignment Memory alignment (a power of 2), or 0 for the malloc default.
+ */
+static inline bo_buffer buffer_alloc(int size, int high_water, int alignment)
+{
+    uint8_t* memory = NULL;
+    if(alignment > 0)
+    {
+        if(alignment < (int)sizeof(void*))
+        {
+            alignment = sizeof(void*);
+        }
+        void* aligned_memory = NULL;
+        if(posix_memalign(&aligned_memory, alignment, size) == 0)
+        {
+            memory = aligned_memory;
+        }
+    }
+    else
+    {
+        memory = malloc(size);
+    }
+    bo_buffer buffer =
+    {
+        .start = memory,
+        .pos = memory,
+        .end = memory + size,
+        .high_water = memory + high_water,
+    };
+    return buffer;
+}
+
+/**
+ * Make a buffer that uses existing memory. The buffer doesn't own the memory, so don't buffer_free() it.
+ */
+static inline bo_buffer buffer_wrap(uint8_t* memory, int size, int high_water)
 {
-    uint8_t* memory = malloc(size + overhead);
     bo_buffer buffer =
     {
         .start = memory,
         .pos = memory,
-        .end = memory + size + overhead,
-        .high_water = memory + size,
+        .end = memory + size,
+        .high_water = memory + high_water,
     };
     return buffer;
 }
@@ -101,6 +137,11 @@ static inline int buffer_get_remaining(bo_buffer* buffer)
     return buffer->end - buffer->pos;
 }
 
+static inline int buffer_get_remaining_to_high_water(bo_buffer* buffer)
+{
+    return buffer->high_water - buffer->pos;
+}
+
 static inline void buffer_set_position(bo_buffer* buffer, uint8_t* position)
 {
     buffer->pos = position;
@@ -116,6 +157,46 @@ static inline void buffer_use_space(bo_buffer* buffer, int bytes)
     buffer->pos += bytes;
 }
 
+/**
+ * Remove data from the front of the buffer.
+ * Any remaining data (such as a partial entry) is moved to the start.
+ *
+ * @param buffer The buffer.
+ * @param length The number of bytes to remove.
+ */
+static inline void buffer_consume(bo_buffer* buffer, int length)
+{
+    int remaining = buffer_get_used(buffer) - length;
+    if(remaining <= 0)
+    {
+        buffer_clear(buffer);
+        return;
+    }
+    memmove(buffer_get_start(buffer), buffer_get_start(buffer) + length, remaining);
+    buffer_set_position(buffer, buffer_get_start(buffer) + remaining);
+}
+
+/**
+ * Double the size of a buffer, keeping its contents. The high water mark moves to the new end.
+ *
+ * @return false if the memory couldn't be allocated (the buffer is left unchanged).
+ */
+static inline bool buffer_grow(bo_buffer* buffer)
+{
+    int size = buffer->end - buffer->start;
+    int used = buffer_get_used(buffer);
+    uint8_t* memory = realloc(buffer->start, size * 2);
+    if(memory == NULL)
+    {
+        return false;
+    }
+    buffer->start = memory;
+    buffer->pos = memory + used;
+    buffer->end = memory + size * 2;
+    buffer->high_water = buffer->end;
+    return true;
+}
+
 static inline void buffer_append_string(bo_buffer* buffer, const char* string)
 {
     char* position = (char*)buffer_get_position(buffer);
@@ -45,6 +45,9 @@ extern "C" {
 #endif
 
 
+// The print width used when none is specified. Floats print in shortest round-trip form.
+#define PRINT_WIDTH_UNSPECIFIED -1
+
 typedef enum
 {
     TYPE_NONE = 0,
@@ -54,6 +57,7 @@ typedef enum
     TYPE_OCTAL,
     TYPE_BOOLEAN,
     TYPE_FLOAT,
+    TYPE_BFLOAT,
     TYPE_DECIMAL,
     TYPE_STRING,
 } bo_data_type;
@@ -74,16 +78,71 @@ typedef enum
     WIDTH_16 = 16,
 } bo_data_width;
 
+// Short separators are copied in one fixed size chunk, which the compiler turns into a single move.
+#define ENTRY_SEPARATOR_COPY_SIZE 16
+
+/**
+ * Describes how entries are laid out in the output.
+ */
+typedef struct
+{
+    const uint8_t* prefix;
+    const uint8_t* suffix;
+    int prefix_length;
+    int suffix_length;
+    // The suffix followed by the prefix, if they fit.
+    uint8_t separator[ENTRY_SEPARATOR_COPY_SIZE];
+    // Passed to the string printer as the minimum bytes to print.
+    int text_width;
+    // The most bytes that a single entry (with prefix and suffix) can take up.
+    int max_entry_length;
+    // in: An entry was printed in a previous batch. out: An entry has been printed.
+    bool has_printed_entry;
+    // in: There's no more data after this batch.
+    bool is_end_of_data;
+    // The 2-byte float string cache, for the cached 2-byte float printers.
+    uint8_t* float_2_cache;
+    // out: The batch stopped at an entry that needs more data than the source holds.
+    bool is_waiting_for_data;
+} entry_format;
+
+/**
+ * Batch printer.
+ * Prints as many entries from the source as will fit in the destination, writing the prefix
+ * before every entry, and the suffix between entries.
+ *
+ * The last entry may read past the end of the source (it's expected to be zero-filled).
+ *
+ * @param src Pointer to the source data.
+ * @param src_length Number of source bytes to print.
+ * @param dst Pointer to the destination buffer.
+ * @param dst_capacity Number of bytes available in the destination buffer.
+ * @param format The entry format.
+ * @param bytes_written out: Number of bytes written.
+ * @return Number of bytes read.
+ */
+typedef int (*batch_printer)(uint8_t* src, int src_length, uint8_t* dst, int dst_capacity, entry_format* format, int* bytes_written);
+
+struct bo_program;
+
 typedef struct
 {
     bo_buffer src_buffer;
+    // Used by bo_process_stream(): Holds an incomplete token from the end of the last chunk.
+    bo_buffer carry_buffer;
     bo_buffer work_buffer;
     bo_buffer output_buffer;
+    // output_buffer's memory belongs to the caller (bo_run_program() keeps it on the stack), so it can't be freed.
+    bool is_output_buffer_borrowed;
+    // The memory alignment that the context's buffers get allocated with (0 for the malloc default).
+    int buffer_alignment;
     struct
     {
         bo_data_type data_type;
         bo_data_width data_width;
         bo_endianness endianness;
+        uint8_t partial_element[16];
+        int partial_element_length;
     } input;
     struct
     {
@@ -93,7 +152,32 @@ typedef struct
         const char* prefix;
         const char* suffix;
         bo_endianness endianness;
+        bool has_printed_entry;
+        // Strings for every 2-byte float value of float_2_cache_type, filled in as they're printed.
+        uint8_t* float_2_cache;
+        bo_data_type float_2_cache_type;
+        // The batch printer and entry format for the settings above, resolved on the first flush
+        // after they change. print_batch is NULL until then.
+        batch_printer print_batch;
+        entry_format format;
     } output;
+    // Used by bo_process_into(): While active, output_buffer is the caller's memory. Once that fills up,
+    // output_buffer switches back to the context's own buffer to hold the overflow until the next call.
+    struct
+    {
+        bool is_active;
+        bool is_overflowing;
+        bo_buffer own_buffer;
+        bo_buffer caller_buffer;
+    } pull;
+    // The whitespace bitmap of the 64-byte block of src_buffer that's currently being scanned for tokens.
+    struct
+    {
+        const uint8_t* block;
+        uint64_t whitespace;
+    } token_scan;
+    // The compiled program that this context is running, which owns the initial prefix and suffix.
+    const struct bo_program* program;
     error_callback on_error;
     output_callback on_output;
     void* user_data;
@@ -106,11 +190,12 @@ typedef struct
 } bo_context;
 
 
-void bo_on_bytes(bo_context* context, uint8_t* data, int length);
+void bo_on_bytes(bo_context* context, const uint8_t* data, int length);
 void bo_on_string(bo_context* context, const uint8_t* string_start, const uint8_t* string_end);
-void bo_on_number(bo_context* context, const uint8_t* string_value);
+void bo_on_number(bo_context* context, const uint8_t* string_value, int length);
+const uint8_t* bo_on_number_run(bo_context* context, const uint8_t* start, const uint8_t* end);
 
-void bo_on_preset(bo_context* context, const uint8_t* string_value);
+void bo_on_preset(bo_context* context, const uint8_t* string_value, int length);
 void bo_on_prefix(bo_context* context, const uint8_t* prefix);
 void bo_on_suffix(bo_context* context, const uint8_t* suffix);
 void bo_on_input_type(bo_context* context, bo_data_type data_type, int data_width, bo_endianness endianness);
@@ -0,0 +1,68 @@
+//  Copyright (c) 2018 Karl Stenerud. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall remain in place
+// in this source code.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+
+#ifndef bo_simd_H
+#define bo_simd_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include <stdbool.h>
+
+
+// SIMD kernels are compiled per instruction set using target attributes, and
+// selected at runtime based on what the CPU supports. Everything else gets
+// the portable fallback.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define BO_HAS_X86_SIMD 1
+    #include <immintrin.h>
+    #define BO_TARGET(INSTRUCTION_SET) __attribute__((target(INSTRUCTION_SET)))
+#else
+    #define BO_HAS_X86_SIMD 0
+#endif
+
+
+static inline bool cpu_has_ssse3()
+{
+#if BO_HAS_X86_SIMD
+    return __builtin_cpu_supports("ssse3");
+#else
+    return false;
+#endif
+}
+
+static inline bool cpu_has_avx2()
+{
+#if BO_HAS_X86_SIMD
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif // bo_simd_H
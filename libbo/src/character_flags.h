@@ -280,6 +280,16 @@ static const unsigned char g_character_flags[256] =
     /* ff:       */ (unsigned char)(CH_FLAG_NONE),
 };
 
+static const unsigned char g_whitespace_low_nibbles[16] =
+{
+    0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x01, 0x01, 0x01, 0x01, 0x00, 0x00,
+};
+
+static const unsigned char g_whitespace_high_nibbles[16] =
+{
+    0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
 
 #ifdef __cplusplus
 }
@@ -25,9 +25,17 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <errno.h>
+#include <fenv.h>
+#include <float.h>
+#include <math.h>
+#if BO_HAS_QUADMATH
+    #include <quadmath.h>
+#endif
 
 #include "bo_internal.h"
+#include "bo_simd.h"
 #include "library_version.h"
+#include "power_of_five_table.h"
 
 
 // -------------
@@ -38,11 +46,26 @@
 // For best results, keep this a multiple of 16.
 #define WORK_BUFFER_SIZE 1600
 
+// The work buffer must be able to hold the largest object (128 bits).
+#define MIN_WORK_BUFFER_SIZE 16
+
+// The output buffer holds converted data until it's passed to the output callback.
+#define OUTPUT_BUFFER_SIZE (WORK_BUFFER_SIZE * 10)
+
+// bo_process_into() processes input in slices of this size, so that it can stop soon after
+// the caller's output buffer fills.
+#define PULL_INPUT_SLICE_SIZE 4096
+
+// bo_process_stream() keeps incomplete tokens in a buffer that starts at this size and grows as needed.
+// It tops that buffer up from the next chunk in slices that start at this size too.
+#define CARRY_BUFFER_SIZE 64
+
 // An overhead size of 32 ensures that for object sizes up to 128 bits,
 // there's always room for 128 bits of zero filling at the end.
 #define WORK_BUFFER_OVERHEAD_SIZE 32
 
-// Use an overhead value large enough that the string printers won't blast past it in a single write.
+// Room past the high water mark. Batch printers stop when an entry might not fit, so this only
+// lets the output buffer fill a little further before it gets flushed.
 #define OUTPUT_BUFFER_OVERHEAD_SIZE 200
 
 
@@ -78,403 +101,2548 @@ void bo_notify_error(bo_context* context, const char* fmt, ...)
 
 
 
-// ---------------
-// String Printers
-// ---------------
+// -----------------
+// Number Formatting
+// -----------------
 
-static inline void copy_swapped(uint8_t* dst, const uint8_t* src, int length)
-{
-	for(int i = 0; i < length; i++)
-	{
-		dst[i] = src[length - i - 1];
-	}
-}
+// Digits are written two at a time from these tables, working backwards from the end of the number.
+static const char g_decimal_digit_pairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
 
-/**
- * String printer.
- * Reads data from the source and writes to the destination.
- *
- * @param src Pointer to the source data.
- * @param dst Pointer to the destination buffer.
- * @param output_width in: Minimum bytes to print. out: Number of bytes written.
- * @return Number of bytes read.
- */
-typedef int (*string_printer)(uint8_t* src, uint8_t* dst, int* output_width);
+static const char g_hex_digit_pairs[] =
+    "000102030405060708090a0b0c0d0e0f"
+    "101112131415161718191a1b1c1d1e1f"
+    "202122232425262728292a2b2c2d2e2f"
+    "303132333435363738393a3b3c3d3e3f"
+    "404142434445464748494a4b4c4d4e4f"
+    "505152535455565758595a5b5c5d5e5f"
+    "606162636465666768696a6b6c6d6e6f"
+    "707172737475767778797a7b7c7d7e7f"
+    "808182838485868788898a8b8c8d8e8f"
+    "909192939495969798999a9b9c9d9e9f"
+    "a0a1a2a3a4a5a6a7a8a9aaabacadaeaf"
+    "b0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+    "c0c1c2c3c4c5c6c7c8c9cacbcccdcecf"
+    "d0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+    "e0e1e2e3e4e5e6e7e8e9eaebecedeeef"
+    "f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
 
-// Force the compiler to generate handler code for unaligned accesses.
-#define DEFINE_SAFE_STRUCT(NAME, TYPE) typedef struct __attribute__((__packed__)) {TYPE contents;} NAME
-DEFINE_SAFE_STRUCT(safe_uint_1,     uint8_t);
-DEFINE_SAFE_STRUCT(safe_uint_2,     uint16_t);
-DEFINE_SAFE_STRUCT(safe_uint_4,     uint32_t);
-DEFINE_SAFE_STRUCT(safe_uint_8,     uint64_t);
-DEFINE_SAFE_STRUCT(safe_int_1,      int8_t);
-DEFINE_SAFE_STRUCT(safe_int_2,      int16_t);
-DEFINE_SAFE_STRUCT(safe_int_4,      int32_t);
-DEFINE_SAFE_STRUCT(safe_int_8,      int64_t);
-DEFINE_SAFE_STRUCT(safe_int_16,     __int128);
-DEFINE_SAFE_STRUCT(safe_float_4,    float);
-DEFINE_SAFE_STRUCT(safe_float_8,    double);
-DEFINE_SAFE_STRUCT(safe_float_16,   __float128);
-DEFINE_SAFE_STRUCT(safe_decimal_8,  _Decimal64);
-DEFINE_SAFE_STRUCT(safe_decimal_16, _Decimal128);
+static const char g_octal_digit_pairs[] =
+    "0001020304050607"
+    "1011121314151617"
+    "2021222324252627"
+    "3031323334353637"
+    "4041424344454647"
+    "5051525354555657"
+    "6061626364656667"
+    "7071727374757677";
 
-#define DEFINE_INT_STRING_PRINTER(NAMED_TYPE, REAL_TYPE, DATA_WIDTH, FORMAT) \
-static int string_print_ ## NAMED_TYPE ## _ ## DATA_WIDTH (uint8_t* src, uint8_t* dst, int* output_width) \
-{ \
-	*output_width = sprintf((char*)dst, "%0*" #FORMAT, *output_width, ((safe_ ## REAL_TYPE ## _ ## DATA_WIDTH *)src)->contents); \
-    return DATA_WIDTH; \
-} \
+// Smallest value having (index + 1) decimal digits. Index 0 is 0 so that the value 0 counts as 1 digit.
+static const uint64_t g_decimal_digit_thresholds[] =
+{
+    0ULL,
+    10ULL,
+    100ULL,
+    1000ULL,
+    10000ULL,
+    100000ULL,
+    1000000ULL,
+    10000000ULL,
+    100000000ULL,
+    1000000000ULL,
+    10000000000ULL,
+    100000000000ULL,
+    1000000000000ULL,
+    10000000000000ULL,
+    100000000000000ULL,
+    1000000000000000ULL,
+    10000000000000000ULL,
+    100000000000000000ULL,
+    1000000000000000000ULL,
+    10000000000000000000ULL,
+};
 
-#define DEFINE_INT_STRING_PRINTER_SWAPPED(NAMED_TYPE, REAL_TYPE, DATA_WIDTH, FORMAT) \
-DEFINE_INT_STRING_PRINTER(NAMED_TYPE, REAL_TYPE, DATA_WIDTH, FORMAT) \
-static int string_print_ ## NAMED_TYPE ## _ ## DATA_WIDTH ## _swapped (uint8_t* src, uint8_t* dst, int* output_width) \
-{ \
-	uint8_t buffer[DATA_WIDTH]; \
-	copy_swapped(buffer, src, DATA_WIDTH); \
-	return string_print_ ## NAMED_TYPE ## _ ## DATA_WIDTH (buffer, dst, output_width); \
+static inline int get_bit_length(uint64_t value)
+{
+    return 64 - __builtin_clzll(value | 1);
+}
+
+static inline int get_decimal_digit_count(uint64_t value)
+{
+    // bit_length * log10(2) gives the digit count, or one less. The threshold table settles which.
+    int estimate = (get_bit_length(value) * 1233) >> 12;
+    return estimate + (value >= g_decimal_digit_thresholds[estimate]);
 }
-DEFINE_INT_STRING_PRINTER(int, int, 1, d)
-DEFINE_INT_STRING_PRINTER_SWAPPED(int, int, 2, d)
-DEFINE_INT_STRING_PRINTER_SWAPPED(int, int, 4, d)
-DEFINE_INT_STRING_PRINTER_SWAPPED(int, int, 8, ld)
-// TODO: int-16
-DEFINE_INT_STRING_PRINTER(hex, uint, 1, x)
-DEFINE_INT_STRING_PRINTER_SWAPPED(hex, uint, 2, x)
-DEFINE_INT_STRING_PRINTER_SWAPPED(hex, uint, 4, x)
-DEFINE_INT_STRING_PRINTER_SWAPPED(hex, uint, 8, lx)
-// TODO: hex-16
-DEFINE_INT_STRING_PRINTER(octal, uint, 1, o)
-DEFINE_INT_STRING_PRINTER_SWAPPED(octal, uint, 2, o)
-DEFINE_INT_STRING_PRINTER_SWAPPED(octal, uint, 4, o)
-DEFINE_INT_STRING_PRINTER_SWAPPED(octal, uint, 8, lo)
-// TODO: octal-16
 
-static int print_boolean_be(uint8_t* src, uint8_t* dst, int data_width, int text_width)
+static inline int get_hex_digit_count(uint64_t value)
 {
-    int bit_width = data_width * 8;
-    int total_width = (bit_width > text_width ? bit_width : text_width);
-    int diff_width = total_width - bit_width;
-    memset(dst, '0', bit_width);
+    return (get_bit_length(value) + 3) >> 2;
+}
 
-    uint8_t* src_ptr = src;
-    char* dst_ptr = (char*)dst + diff_width;
+static inline int get_octal_digit_count(uint64_t value)
+{
+    return (get_bit_length(value) + 2) / 3;
+}
 
-    for(int bits_remaining = bit_width;bits_remaining > 0;)
+/**
+ * Write zero padding, then digits, such that at least min_width characters get written.
+ *
+ * @param dst Where to start writing.
+ * @param digit_count The number of digits the value will need.
+ * @param min_width The minimum number of characters to write.
+ * @return Pointer to one past the end of where the digits will go.
+ */
+static inline uint8_t* write_zero_padding(uint8_t* dst, int digit_count, int min_width)
+{
+    int padding = min_width - digit_count;
+    if(padding > 0)
     {
-        int value = *src_ptr;
-        for(int i = 0; i < 8 && bits_remaining > 0; i++)
-        {
-            *dst_ptr++ = '0' + ((value >> (7-i)) & 1);
-            bits_remaining--;
-        }
-        src_ptr++;
+        memset(dst, '0', padding);
+        dst += padding;
     }
-    return total_width;
+    return dst + digit_count;
 }
 
-static int print_boolean_le(uint8_t* src, uint8_t* dst, int data_width, int text_width)
+static inline void write_decimal_digits_backwards(uint8_t* end, uint64_t value)
 {
-    int bit_width = data_width * 8;
-    int total_width = (bit_width > text_width ? bit_width : text_width);
-    int diff_width = total_width - bit_width;
-    memset(dst, '0', bit_width);
-
-    uint8_t* src_ptr = src;
-    char* dst_ptr = (char*)dst + diff_width;
-
-    for(int bits_remaining = bit_width;bits_remaining > 0;)
+    while(value >= 100)
     {
-        int value = *src_ptr;
-        for(int i = 0; i < 8 && bits_remaining > 0; i++)
-        {
-            *dst_ptr++ = '0' + ((value >> i) & 1);
-            bits_remaining--;
-        }
-        src_ptr++;
+        uint64_t quotient = value / 100;
+        int pair = (int)(value - quotient * 100);
+        end -= 2;
+        memcpy(end, g_decimal_digit_pairs + pair * 2, 2);
+        value = quotient;
     }
-    return total_width;
-}
-#define DEFINE_BOOLEAN_STRING_PRINTER(DATA_WIDTH) \
-static int string_print_boolean_ ## DATA_WIDTH ## _be (uint8_t* src, uint8_t* dst, int* output_width) \
-{ \
-    *output_width = print_boolean_be(src, dst, DATA_WIDTH, *output_width); \
-    return DATA_WIDTH; \
-} \
-static int string_print_boolean_ ## DATA_WIDTH ## _le (uint8_t* src, uint8_t* dst, int* output_width) \
-{ \
-    *output_width = print_boolean_le(src, dst, DATA_WIDTH, *output_width); \
-    return DATA_WIDTH; \
+    if(value >= 10)
+    {
+        memcpy(end - 2, g_decimal_digit_pairs + value * 2, 2);
+        return;
+    }
+    end[-1] = (uint8_t)('0' + value);
 }
-DEFINE_BOOLEAN_STRING_PRINTER(1)
-DEFINE_BOOLEAN_STRING_PRINTER(2)
-DEFINE_BOOLEAN_STRING_PRINTER(4)
-DEFINE_BOOLEAN_STRING_PRINTER(8)
-DEFINE_BOOLEAN_STRING_PRINTER(16)
 
-#define DEFINE_FLOAT_STRING_PRINTER(NAMED_TYPE, REAL_TYPE, DATA_WIDTH, FORMAT) \
-static int string_print_ ## NAMED_TYPE ## _ ## DATA_WIDTH (uint8_t* src, uint8_t* dst, int* output_width) \
-{ \
-	*output_width = sprintf((char*)dst, "%.*" #FORMAT, *output_width, (double)((safe_ ## REAL_TYPE ## _ ## DATA_WIDTH *)src)->contents); \
-    return DATA_WIDTH; \
-} \
-static int string_print_ ## NAMED_TYPE ## _ ## DATA_WIDTH ## _swapped (uint8_t* src, uint8_t* dst, int* output_width) \
-{ \
-	uint8_t buffer[DATA_WIDTH]; \
-	copy_swapped(buffer, src, DATA_WIDTH); \
-	return string_print_ ## NAMED_TYPE ## _ ## DATA_WIDTH (buffer, dst, output_width); \
+static inline void write_hex_digits_backwards(uint8_t* end, uint64_t value, int digit_count)
+{
+    for(; digit_count >= 2; digit_count -= 2)
+    {
+        end -= 2;
+        memcpy(end, g_hex_digit_pairs + (value & 0xff) * 2, 2);
+        value >>= 8;
+    }
+    if(digit_count > 0)
+    {
+        end[-1] = (uint8_t)g_hex_digit_pairs[value * 2 + 1];
+    }
 }
-// TODO: float-2
-DEFINE_FLOAT_STRING_PRINTER(float, float, 4, f)
-DEFINE_FLOAT_STRING_PRINTER(float, float, 8, f)
-// TODO: float-16
-// TODO: decimal-8
-// TODO: decimal-16
 
-#define DEFINE_BINARY_PRINTER(DATA_WIDTH) \
-static int binary_print_ ## DATA_WIDTH (uint8_t* src, uint8_t* dst, int* output_width) \
-{ \
-    memcpy(dst, src, DATA_WIDTH); \
-    *output_width = DATA_WIDTH; \
-    return DATA_WIDTH; \
-} \
-static int binary_print_ ## DATA_WIDTH ## _swapped(uint8_t* src, uint8_t* dst, int* output_width) \
-{ \
-    copy_swapped(dst, src, DATA_WIDTH); \
-    *output_width = DATA_WIDTH; \
-    return DATA_WIDTH; \
-}
-DEFINE_BINARY_PRINTER(2)
-DEFINE_BINARY_PRINTER(4)
-DEFINE_BINARY_PRINTER(8)
-DEFINE_BINARY_PRINTER(16)
-static int binary_print_1(uint8_t* src, uint8_t* dst, int* output_width)
+static inline void write_octal_digits_backwards(uint8_t* end, uint64_t value, int digit_count)
 {
-    *dst = *src;
-    *output_width = 1;
-    return 1;
+    for(; digit_count >= 2; digit_count -= 2)
+    {
+        end -= 2;
+        memcpy(end, g_octal_digit_pairs + (value & 077) * 2, 2);
+        value >>= 6;
+    }
+    if(digit_count > 0)
+    {
+        end[-1] = (uint8_t)('0' + value);
+    }
 }
 
+// The format_xyz() functions produce the same output as sprintf("%0*d"), "%0*x", and "%0*o" respectively.
+// They do not null terminate, and return the number of characters written.
 
-static const char g_hex_values[16] = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'};
-
-static int get_utf8_length(uint8_t ch)
+static int format_decimal(int64_t value, uint8_t* dst, int min_width)
 {
-    if((ch >> 5) == 0x06) return 2;
-    if((ch >> 4) == 0x0e) return 3;
-    if((ch >> 3) == 0x1e) return 4;
-    return 0;
+    uint8_t* start = dst;
+    uint64_t magnitude = (uint64_t)value;
+    if(value < 0)
+    {
+        *dst++ = '-';
+        magnitude = 0 - magnitude;
+        min_width--;
+    }
+    int digit_count = get_decimal_digit_count(magnitude);
+    uint8_t* end = write_zero_padding(dst, digit_count, min_width);
+    write_decimal_digits_backwards(end, magnitude);
+    return end - start;
 }
 
-static int string_print_string(uint8_t* src, uint8_t* dst, int* output_width)
+static int format_hex(uint64_t value, uint8_t* dst, int min_width)
 {
-#define CASE_ESCAPE(VALUE, ESCAPED) \
-    case VALUE: \
-        dst[0] = '\\'; \
-        dst[1] = ESCAPED; \
-        *output_width = 2; \
-        return 1
-
-    uint8_t ch = *src;
-    switch(ch)
-    {
-        CASE_ESCAPE(0x07, 'a');
-        CASE_ESCAPE(0x08, 'b');
-        CASE_ESCAPE(0x09, 't');
-        CASE_ESCAPE(0x0a, 'n');
-        CASE_ESCAPE(0x0b, 'v');
-        CASE_ESCAPE(0x0c, 'f');
-        CASE_ESCAPE(0x0d, 'r');
-        CASE_ESCAPE('\\', '\\');
-        CASE_ESCAPE('\"', '\"');
-        CASE_ESCAPE('?', '?');
-        default:
-        {
-            if(ch >= 0x20 && ch < 0x7f)
-            {
-                *dst = *src;
-                *output_width = 1;
-                return 1;
-            }
-            int utf8_length = get_utf8_length(ch);
-            if(utf8_length > 0)
-            {
-                for(int i = 0; i < utf8_length; i++)
-                {
-                    *dst++ = *src++;
-                }
-                *output_width = utf8_length;
-                return utf8_length;
-            }
-            *dst++ = '\\';
-            *dst++ = 'x';
-            if(ch > 15)
-            {
-                *dst++ = g_hex_values[ch>>4];
-                *output_width = 4;
-            }
-            else
-            {
-                *output_width = 3;
-            }
-            *dst++ = g_hex_values[ch&15];
-            return 1;
-        }
-    }
+    int digit_count = get_hex_digit_count(value);
+    uint8_t* end = write_zero_padding(dst, digit_count, min_width);
+    write_hex_digits_backwards(end, value, digit_count);
+    return end - dst;
 }
 
-bool matches_endianness(bo_context* context)
+static int format_octal(uint64_t value, uint8_t* dst, int min_width)
 {
-    return context->output.endianness == BO_NATIVE_INT_ENDIANNESS;
+    int digit_count = get_octal_digit_count(value);
+    uint8_t* end = write_zero_padding(dst, digit_count, min_width);
+    write_octal_digits_backwards(end, value, digit_count);
+    return end - dst;
 }
 
-bool matches_float_endianness(bo_context* context)
+// 128-bit values are split into 64-bit chunks of a fixed number of digits, so that all of the
+// digit work stays in 64-bit arithmetic.
+
+// The largest power of 10 that fits in 64 bits.
+#define DECIMAL_CHUNK_DIVISOR 10000000000000000000ULL
+#define DECIMAL_CHUNK_DIGITS 19
+
+// 63 bits is the most that divides evenly into octal digits.
+#define OCTAL_CHUNK_BITS 63
+#define OCTAL_CHUNK_DIGITS 21
+
+static inline int get_bit_length_128(unsigned __int128 value)
 {
-    return context->output.endianness == BO_NATIVE_FLOAT_ENDIANNESS;
+    uint64_t high = (uint64_t)(value >> 64);
+    return high == 0 ? get_bit_length((uint64_t)value) : 128 - __builtin_clzll(high);
 }
 
-bool is_output_bigendian(bo_context* context)
+static inline void write_decimal_chunk_backwards(uint8_t* end, uint64_t value)
 {
-    return context->output.endianness == BO_ENDIAN_BIG;
+    memset(end - DECIMAL_CHUNK_DIGITS, '0', DECIMAL_CHUNK_DIGITS);
+    write_decimal_digits_backwards(end, value);
 }
 
-static string_printer get_string_printer(bo_context* context)
+static int format_decimal_128(__int128 value, uint8_t* dst, int min_width)
 {
-    switch(context->output.data_type)
+    if((__int128)(int64_t)value == value)
     {
-        case TYPE_INT:
-        {
-            switch(context->output.data_width)
-            {
-                case 1: return string_print_int_1;
-                case 2: return matches_endianness(context) ? string_print_int_2 : string_print_int_2_swapped;
-                case 4: return matches_endianness(context) ? string_print_int_4 : string_print_int_4_swapped;
-                case 8: return matches_endianness(context) ? string_print_int_8 : string_print_int_8_swapped;
-                case 16:
-                    bo_notify_error(context, "TODO: INT 16 not implemented");
-                    return NULL;
-                default:
-                    bo_notify_error(context, "%d: invalid data width", context->output.data_width);
-                    return NULL;
-            }
-        }
-        case TYPE_HEX:
-        {
-            switch(context->output.data_width)
-            {
-                case 1: return string_print_hex_1;
-                case 2: return matches_endianness(context) ? string_print_hex_2 : string_print_hex_2_swapped;
-                case 4: return matches_endianness(context) ? string_print_hex_4 : string_print_hex_4_swapped;
-                case 8: return matches_endianness(context) ? string_print_hex_8 : string_print_hex_8_swapped;
-                case 16:
-                    bo_notify_error(context, "TODO: HEX 16 not implemented");
-                    return NULL;
-                default:
-                    bo_notify_error(context, "%d: invalid data width", context->output.data_width);
-                    return NULL;
-            }
-        }
-        case TYPE_OCTAL:
-        {
-            switch(context->output.data_width)
-            {
-                case 1: return string_print_octal_1;
-                case 2: return matches_endianness(context) ? string_print_octal_2 : string_print_octal_2_swapped;
-                case 4: return matches_endianness(context) ? string_print_octal_4 : string_print_octal_4_swapped;
-                case 8: return matches_endianness(context) ? string_print_octal_8 : string_print_octal_8_swapped;
-                case 16:
-                    bo_notify_error(context, "TODO: OCTAL 16 not implemented");
-                    return NULL;
-                default:
-                    bo_notify_error(context, "%d: invalid data width", context->output.data_width);
-                    return NULL;
-            }
-        }
-        case TYPE_BOOLEAN:
-        {
-            switch(context->output.data_width)
-            {
-                case 1: return is_output_bigendian(context) ? string_print_boolean_1_be : string_print_boolean_1_le;
-                case 2: return is_output_bigendian(context) ? string_print_boolean_2_be : string_print_boolean_2_le;
-                case 4: return is_output_bigendian(context) ? string_print_boolean_4_be : string_print_boolean_4_le;
-                case 8: return is_output_bigendian(context) ? string_print_boolean_8_be : string_print_boolean_8_le;
-                case 16: return is_output_bigendian(context) ? string_print_boolean_16_be : string_print_boolean_16_le;
-                default:
-                    bo_notify_error(context, "%d: invalid data width", context->output.data_width);
-                    return NULL;
-            }
-        }
-        case TYPE_FLOAT:
-        {
-            switch(context->output.data_width)
-            {
-                case 2:
-                    bo_notify_error(context, "TODO: FLOAT 2 not implemented");
-                    return NULL;
-                case 4: return matches_float_endianness(context) ? string_print_float_4 : string_print_float_4_swapped;
-                case 8: return matches_float_endianness(context) ? string_print_float_8 : string_print_float_8_swapped;
-                case 16:
-                    bo_notify_error(context, "TODO: FLOAT 16 not implemented");
-                    return NULL;
-                default:
-                    bo_notify_error(context, "%d: invalid data width", context->output.data_width);
-                    return NULL;
-            }
-        }
-        case TYPE_DECIMAL:
-            bo_notify_error(context, "TODO: DECIMAL not implemented");
-            return NULL;
-        case TYPE_BINARY:
-            switch(context->output.data_width)
-            {
-                case 1: return binary_print_1;
-                case 2: return matches_endianness(context) ? binary_print_2 : binary_print_2_swapped;
-                case 4: return matches_endianness(context) ? binary_print_4 : binary_print_4_swapped;
-                case 8: return matches_endianness(context) ? binary_print_8 : binary_print_8_swapped;
-                case 16: return matches_endianness(context) ? binary_print_16 : binary_print_16_swapped;
-                default:
-                    bo_notify_error(context, "%d: invalid data width", context->output.data_width);
-                    return NULL;
-            }
-        case TYPE_STRING:
-            return string_print_string;
-        case TYPE_NONE:
-            bo_notify_error(context, "Must set output data type before passing data");
-            return NULL;
-        default:
-            bo_notify_error(context, "%d: Unknown data type", context->output.data_type);
-            return NULL;
+        return format_decimal((int64_t)value, dst, min_width);
     }
-}
 
+    unsigned __int128 magnitude = (unsigned __int128)value;
 
+    uint8_t* start = dst;
+    if(value < 0)
+    {
+        *dst++ = '-';
+        magnitude = 0 - magnitude;
+        min_width--;
+    }
 
-// --------
-// Internal
-// --------
-
-static inline bool is_nonempty_string(const char* const string)
-{
-    return string != NULL && *string != 0;
-}
+    // At most 3 chunks: 2^128 is about 3.4 * 10^38.
+    uint64_t chunks[3];
+    int chunk_count = 0;
+    while(magnitude >> 64 != 0)
+    {
+        chunks[chunk_count++] = (uint64_t)(magnitude % DECIMAL_CHUNK_DIVISOR);
+        magnitude /= DECIMAL_CHUNK_DIVISOR;
+    }
+    uint64_t top = (uint64_t)magnitude;
+    if(top >= DECIMAL_CHUNK_DIVISOR)
+    {
+        chunks[chunk_count++] = top % DECIMAL_CHUNK_DIVISOR;
+        top /= DECIMAL_CHUNK_DIVISOR;
+    }
 
-static inline bool check_can_input_numbers(bo_context* context, const uint8_t* string_value)
-{
-    if(context->input.data_type == TYPE_NONE || context->input.data_type == TYPE_STRING)
+    int top_digit_count = get_decimal_digit_count(top);
+    uint8_t* end = write_zero_padding(dst, top_digit_count + chunk_count * DECIMAL_CHUNK_DIGITS, min_width);
+    uint8_t* pos = end;
+    for(int i = 0; i < chunk_count; i++)
     {
-        bo_notify_error(context, "%s: Must set input type to numeric before adding numbers", (const char*)string_value);
-        return false;
+        write_decimal_chunk_backwards(pos, chunks[i]);
+        pos -= DECIMAL_CHUNK_DIGITS;
     }
-    return true;
+    write_decimal_digits_backwards(pos, top);
+    return end - start;
 }
 
-static int trim_length_to_object_boundary(int length, int object_size_in_bytes)
+static int format_hex_128(unsigned __int128 value, uint8_t* dst, int min_width)
 {
-    return length - (length % object_size_in_bytes);
+    uint64_t high = (uint64_t)(value >> 64);
+    if(high == 0)
+    {
+        return format_hex((uint64_t)value, dst, min_width);
+    }
+    int high_digit_count = get_hex_digit_count(high);
+    uint8_t* end = write_zero_padding(dst, high_digit_count + 16, min_width);
+    write_hex_digits_backwards(end, (uint64_t)value, 16);
+    write_hex_digits_backwards(end - 16, high, high_digit_count);
+    return end - dst;
 }
 
-static void clear_error_condition(bo_context* context)
+static int format_octal_128(unsigned __int128 value, uint8_t* dst, int min_width)
 {
-    context->is_error_condition = false;
+    if(value >> 64 == 0)
+    {
+        return format_octal((uint64_t)value, dst, min_width);
+    }
+    int digit_count = (get_bit_length_128(value) + 2) / 3;
+    uint8_t* end = write_zero_padding(dst, digit_count, min_width);
+    const uint64_t chunk_mask = (1ULL << OCTAL_CHUNK_BITS) - 1;
+    for(uint8_t* pos = end; digit_count > 0; pos -= OCTAL_CHUNK_DIGITS, digit_count -= OCTAL_CHUNK_DIGITS)
+    {
+        int chunk_digit_count = digit_count < OCTAL_CHUNK_DIGITS ? digit_count : OCTAL_CHUNK_DIGITS;
+        write_octal_digits_backwards(pos, (uint64_t)value & chunk_mask, chunk_digit_count);
+        value >>= OCTAL_CHUNK_BITS;
+    }
+    return end - dst;
+}
+
+
+// Expand each source byte into its two lowercase hex characters.
+
+static void expand_hex_pairs_scalar(const uint8_t* src, int count, uint8_t* dst)
+{
+    for(int i = 0; i < count; i++)
+    {
+        memcpy(dst + i * 2, g_hex_digit_pairs + src[i] * 2, 2);
+    }
+}
+
+#if BO_HAS_X86_SIMD
+BO_TARGET("ssse3")
+static void expand_hex_pairs_ssse3(const uint8_t* src, int count, uint8_t* dst)
+{
+    const __m128i digits = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7',
+                                         '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+    const __m128i nybble_mask = _mm_set1_epi8(0x0f);
+    int i = 0;
+    for(; i + 16 <= count; i += 16)
+    {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i high = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(bytes, 4), nybble_mask));
+        __m128i low = _mm_shuffle_epi8(digits, _mm_and_si128(bytes, nybble_mask));
+        _mm_storeu_si128((__m128i*)(dst + i * 2), _mm_unpacklo_epi8(high, low));
+        _mm_storeu_si128((__m128i*)(dst + i * 2 + 16), _mm_unpackhi_epi8(high, low));
+    }
+    expand_hex_pairs_scalar(src + i, count - i, dst + i * 2);
+}
+
+BO_TARGET("avx2")
+static void expand_hex_pairs_avx2(const uint8_t* src, int count, uint8_t* dst)
+{
+    const __m256i digits = _mm256_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7',
+                                            '8', '9', 'a', 'b', 'c', 'd', 'e', 'f',
+                                            '0', '1', '2', '3', '4', '5', '6', '7',
+                                            '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+    const __m256i nybble_mask = _mm256_set1_epi8(0x0f);
+    int i = 0;
+    for(; i + 32 <= count; i += 32)
+    {
+        __m256i bytes = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i high = _mm256_shuffle_epi8(digits, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nybble_mask));
+        __m256i low = _mm256_shuffle_epi8(digits, _mm256_and_si256(bytes, nybble_mask));
+        // Unpacking works within 128-bit lanes, so the halves need to be put back in order.
+        __m256i first = _mm256_unpacklo_epi8(high, low);
+        __m256i second = _mm256_unpackhi_epi8(high, low);
+        _mm256_storeu_si256((__m256i*)(dst + i * 2), _mm256_permute2x128_si256(first, second, 0x20));
+        _mm256_storeu_si256((__m256i*)(dst + i * 2 + 32), _mm256_permute2x128_si256(first, second, 0x31));
+    }
+    expand_hex_pairs_ssse3(src + i, count - i, dst + i * 2);
+}
+#endif
+
+static void expand_hex_pairs(const uint8_t* src, int count, uint8_t* dst)
+{
+#if BO_HAS_X86_SIMD
+    if(cpu_has_avx2())
+    {
+        expand_hex_pairs_avx2(src, count, dst);
+        return;
+    }
+    if(cpu_has_ssse3())
+    {
+        expand_hex_pairs_ssse3(src, count, dst);
+        return;
+    }
+#endif
+    expand_hex_pairs_scalar(src, count, dst);
+}
+
+
+
+// ----------------
+// Float Formatting
+// ----------------
+
+// Floats are described by their IEEE 754 layout so that every binary float width can share the same code.
+// Shortest round-trip output uses Grisu3 (Florian Loitsch, "Printing Floating-Point Numbers Quickly and
+// Accurately with Integers"), which finds the shortest digits that read back to the same value for all
+// but about 0.5% of doubles, and knows when it hasn't. Those few get found by trying each length in turn.
+
+typedef struct
+{
+    uint64_t f;
+    int e;
+} diy_fp;
+
+// Normalized powers of 10 from 1e-348 to 1e340, in steps of 8.
+static const diy_fp g_cached_powers_of_10[] =
+{
+    {0xfa8fd5a0081c0288ULL, -1220}, // 1e-348
+    {0xbaaee17fa23ebf76ULL, -1193}, // 1e-340
+    {0x8b16fb203055ac76ULL, -1166}, // 1e-332
+    {0xcf42894a5dce35eaULL, -1140}, // 1e-324
+    {0x9a6bb0aa55653b2dULL, -1113}, // 1e-316
+    {0xe61acf033d1a45dfULL, -1087}, // 1e-308
+    {0xab70fe17c79ac6caULL, -1060}, // 1e-300
+    {0xff77b1fcbebcdc4fULL, -1034}, // 1e-292
+    {0xbe5691ef416bd60cULL, -1007}, // 1e-284
+    {0x8dd01fad907ffc3cULL,  -980}, // 1e-276
+    {0xd3515c2831559a83ULL,  -954}, // 1e-268
+    {0x9d71ac8fada6c9b5ULL,  -927}, // 1e-260
+    {0xea9c227723ee8bcbULL,  -901}, // 1e-252
+    {0xaecc49914078536dULL,  -874}, // 1e-244
+    {0x823c12795db6ce57ULL,  -847}, // 1e-236
+    {0xc21094364dfb5637ULL,  -821}, // 1e-228
+    {0x9096ea6f3848984fULL,  -794}, // 1e-220
+    {0xd77485cb25823ac7ULL,  -768}, // 1e-212
+    {0xa086cfcd97bf97f4ULL,  -741}, // 1e-204
+    {0xef340a98172aace5ULL,  -715}, // 1e-196
+    {0xb23867fb2a35b28eULL,  -688}, // 1e-188
+    {0x84c8d4dfd2c63f3bULL,  -661}, // 1e-180
+    {0xc5dd44271ad3cdbaULL,  -635}, // 1e-172
+    {0x936b9fcebb25c996ULL,  -608}, // 1e-164
+    {0xdbac6c247d62a584ULL,  -582}, // 1e-156
+    {0xa3ab66580d5fdaf6ULL,  -555}, // 1e-148
+    {0xf3e2f893dec3f126ULL,  -529}, // 1e-140
+    {0xb5b5ada8aaff80b8ULL,  -502}, // 1e-132
+    {0x87625f056c7c4a8bULL,  -475}, // 1e-124
+    {0xc9bcff6034c13053ULL,  -449}, // 1e-116
+    {0x964e858c91ba2655ULL,  -422}, // 1e-108
+    {0xdff9772470297ebdULL,  -396}, // 1e-100
+    {0xa6dfbd9fb8e5b88fULL,  -369}, // 1e-92
+    {0xf8a95fcf88747d94ULL,  -343}, // 1e-84
+    {0xb94470938fa89bcfULL,  -316}, // 1e-76
+    {0x8a08f0f8bf0f156bULL,  -289}, // 1e-68
+    {0xcdb02555653131b6ULL,  -263}, // 1e-60
+    {0x993fe2c6d07b7facULL,  -236}, // 1e-52
+    {0xe45c10c42a2b3b06ULL,  -210}, // 1e-44
+    {0xaa242499697392d3ULL,  -183}, // 1e-36
+    {0xfd87b5f28300ca0eULL,  -157}, // 1e-28
+    {0xbce5086492111aebULL,  -130}, // 1e-20
+    {0x8cbccc096f5088ccULL,  -103}, // 1e-12
+    {0xd1b71758e219652cULL,   -77}, // 1e-4
+    {0x9c40000000000000ULL,   -50}, // 1e4
+    {0xe8d4a51000000000ULL,   -24}, // 1e12
+    {0xad78ebc5ac620000ULL,     3}, // 1e20
+    {0x813f3978f8940984ULL,    30}, // 1e28
+    {0xc097ce7bc90715b3ULL,    56}, // 1e36
+    {0x8f7e32ce7bea5c70ULL,    83}, // 1e44
+    {0xd5d238a4abe98068ULL,   109}, // 1e52
+    {0x9f4f2726179a2245ULL,   136}, // 1e60
+    {0xed63a231d4c4fb27ULL,   162}, // 1e68
+    {0xb0de65388cc8ada8ULL,   189}, // 1e76
+    {0x83c7088e1aab65dbULL,   216}, // 1e84
+    {0xc45d1df942711d9aULL,   242}, // 1e92
+    {0x924d692ca61be758ULL,   269}, // 1e100
+    {0xda01ee641a708deaULL,   295}, // 1e108
+    {0xa26da3999aef774aULL,   322}, // 1e116
+    {0xf209787bb47d6b85ULL,   348}, // 1e124
+    {0xb454e4a179dd1877ULL,   375}, // 1e132
+    {0x865b86925b9bc5c2ULL,   402}, // 1e140
+    {0xc83553c5c8965d3dULL,   428}, // 1e148
+    {0x952ab45cfa97a0b3ULL,   455}, // 1e156
+    {0xde469fbd99a05fe3ULL,   481}, // 1e164
+    {0xa59bc234db398c25ULL,   508}, // 1e172
+    {0xf6c69a72a3989f5cULL,   534}, // 1e180
+    {0xb7dcbf5354e9beceULL,   561}, // 1e188
+    {0x88fcf317f22241e2ULL,   588}, // 1e196
+    {0xcc20ce9bd35c78a5ULL,   614}, // 1e204
+    {0x98165af37b2153dfULL,   641}, // 1e212
+    {0xe2a0b5dc971f303aULL,   667}, // 1e220
+    {0xa8d9d1535ce3b396ULL,   694}, // 1e228
+    {0xfb9b7cd9a4a7443cULL,   720}, // 1e236
+    {0xbb764c4ca7a44410ULL,   747}, // 1e244
+    {0x8bab8eefb6409c1aULL,   774}, // 1e252
+    {0xd01fef10a657842cULL,   800}, // 1e260
+    {0x9b10a4e5e9913129ULL,   827}, // 1e268
+    {0xe7109bfba19c0c9dULL,   853}, // 1e276
+    {0xac2820d9623bf429ULL,   880}, // 1e284
+    {0x80444b5e7aa7cf85ULL,   907}, // 1e292
+    {0xbf21e44003acdd2dULL,   933}, // 1e300
+    {0x8e679c2f5e44ff8fULL,   960}, // 1e308
+    {0xd433179d9c8cb841ULL,   986}, // 1e316
+    {0x9e19db92b4e31ba9ULL,  1013}, // 1e324
+    {0xeb96bf6ebadf77d9ULL,  1039}, // 1e332
+    {0xaf87023b9bf0ee6bULL,  1066}, // 1e340
+};
+
+static const uint64_t g_powers_of_10[] =
+{
+    1ULL,
+    10ULL,
+    100ULL,
+    1000ULL,
+    10000ULL,
+    100000ULL,
+    1000000ULL,
+    10000000ULL,
+    100000000ULL,
+    1000000000ULL,
+    10000000000ULL,
+    100000000000ULL,
+    1000000000000ULL,
+    10000000000000ULL,
+    100000000000000ULL,
+    1000000000000000ULL,
+    10000000000000000ULL,
+    100000000000000000ULL,
+    1000000000000000000ULL,
+    10000000000000000000ULL,
+};
+
+static inline diy_fp diy_fp_normalize(diy_fp value)
+{
+    int shift = __builtin_clzll(value.f);
+    value.f <<= shift;
+    value.e -= shift;
+    return value;
+}
+
+static inline diy_fp diy_fp_multiply(diy_fp a, diy_fp b)
+{
+    unsigned __int128 product = (unsigned __int128)a.f * b.f;
+    uint64_t high = (uint64_t)(product >> 64);
+    uint64_t low = (uint64_t)product;
+    diy_fp result = {high + (low >> 63), a.e + b.e + 64};
+    return result;
+}
+
+/**
+ * Get a cached power of 10 that brings a value with binary exponent e into Grisu's working range.
+ *
+ * @param e The binary exponent of the normalized upper boundary.
+ * @param decimal_exponent out: The negated decimal exponent of the returned power.
+ * @return The cached power.
+ */
+static diy_fp get_cached_power_of_10(int e, int* decimal_exponent)
+{
+    double estimate = (-61 - e) * 0.30102999566398114 + 347;
+    int k = (int)estimate;
+    if(estimate - k > 0.0)
+    {
+        k++;
+    }
+    int index = (k >> 3) + 1;
+    *decimal_exponent = -(-348 + index * 8);
+    return g_cached_powers_of_10[index];
+}
+
+/**
+ * Round the last digit down towards the value for as long as that gets closer and stays within the
+ * boundaries. The boundaries are only known to within unit, so also check that the result is certain
+ * to be both the closest and the shortest (Grisu3's round_weed()).
+ *
+ * @return False if the result might not be the closest or shortest.
+ */
+static bool grisu_round_weed(uint8_t* digits,
+                             int length,
+                             uint64_t distance_too_high_w,
+                             uint64_t unsafe_interval,
+                             uint64_t rest,
+                             uint64_t ten_kappa,
+                             uint64_t unit)
+{
+    const uint64_t small_distance = distance_too_high_w - unit;
+    const uint64_t big_distance = distance_too_high_w + unit;
+    while(rest < small_distance && unsafe_interval - rest >= ten_kappa &&
+          (rest + ten_kappa < small_distance || small_distance - rest >= rest + ten_kappa - small_distance))
+    {
+        digits[length - 1]--;
+        rest += ten_kappa;
+    }
+    if(rest < big_distance && unsafe_interval - rest >= ten_kappa &&
+       (rest + ten_kappa < big_distance || big_distance - rest > rest + ten_kappa - big_distance))
+    {
+        return false;
+    }
+    return 2 * unit <= rest && rest <= unsafe_interval - 4 * unit;
+}
+
+static bool grisu_generate_digits(diy_fp low, diy_fp w, diy_fp high, uint8_t* digits, int* length, int* decimal_exponent)
+{
+    // Generate digits from slightly outside of the boundaries, then weed out any that might not be inside.
+    uint64_t unit = 1;
+    const uint64_t too_high = high.f + unit;
+    uint64_t unsafe_interval = too_high - (low.f - unit);
+    const diy_fp one = {1ULL << -w.e, w.e};
+    uint32_t integral = (uint32_t)(too_high >> -one.e);
+    uint64_t fractional = too_high & (one.f - 1);
+    int kappa = get_decimal_digit_count(integral);
+    *length = 0;
+
+    while(kappa > 0)
+    {
+        uint32_t divisor = (uint32_t)g_powers_of_10[kappa - 1];
+        uint32_t digit = integral / divisor;
+        integral %= divisor;
+        if(digit != 0 || *length != 0)
+        {
+            digits[(*length)++] = (uint8_t)('0' + digit);
+        }
+        kappa--;
+        uint64_t rest = ((uint64_t)integral << -one.e) + fractional;
+        if(rest < unsafe_interval)
+        {
+            *decimal_exponent += kappa;
+            return grisu_round_weed(digits, *length, too_high - w.f, unsafe_interval, rest, (uint64_t)divisor << -one.e, unit);
+        }
+    }
+
+    for(;;)
+    {
+        fractional *= 10;
+        unit *= 10;
+        unsafe_interval *= 10;
+        uint8_t digit = (uint8_t)(fractional >> -one.e);
+        if(digit != 0 || *length != 0)
+        {
+            digits[(*length)++] = (uint8_t)('0' + digit);
+        }
+        fractional &= one.f - 1;
+        kappa--;
+        if(fractional < unsafe_interval)
+        {
+            *decimal_exponent += kappa;
+            return grisu_round_weed(digits, *length, (too_high - w.f) * unit, unsafe_interval, fractional, one.f, unit);
+        }
+    }
+}
+
+/**
+ * Generate the shortest digits that uniquely identify a nonzero finite float.
+ *
+ * @param significand The significand, including the hidden bit if any.
+ * @param exponent The binary exponent such that the value is significand * 2^exponent.
+ * @param is_lower_boundary_closer True if the value is a power of 2 above the smallest normal.
+ * @param digits out: The digits (up to 20).
+ * @param length out: The number of digits generated.
+ * @param decimal_exponent out: The decimal exponent such that the value is digits * 10^decimal_exponent.
+ * @return False if the digits might not be the shortest, in which case they can't be used.
+ */
+static bool grisu3(uint64_t significand, int exponent, bool is_lower_boundary_closer, uint8_t* digits, int* length, int* decimal_exponent)
+{
+    diy_fp value = {significand, exponent};
+    diy_fp upper = diy_fp_normalize((diy_fp){(significand << 1) + 1, exponent - 1});
+    diy_fp lower = is_lower_boundary_closer ? (diy_fp){(significand << 2) - 1, exponent - 2}
+                                            : (diy_fp){(significand << 1) - 1, exponent - 1};
+    lower.f <<= lower.e - upper.e;
+    lower.e = upper.e;
+
+    int k = 0;
+    diy_fp cached_power = get_cached_power_of_10(upper.e, &k);
+    diy_fp w = diy_fp_multiply(diy_fp_normalize(value), cached_power);
+    diy_fp high = diy_fp_multiply(upper, cached_power);
+    diy_fp low = diy_fp_multiply(lower, cached_power);
+    *decimal_exponent = k;
+    return grisu_generate_digits(low, w, high, digits, length, decimal_exponent);
+}
+
+/**
+ * Lay out digits * 10^decimal_exponent the way ECMAScript's Number.toString() does:
+ * Plain notation for decimal points from 1e-7 up to 1e21, and exponential notation otherwise.
+ */
+static int write_shortest_notation(const uint8_t* digits, int length, int decimal_exponent, uint8_t* dst)
+{
+    uint8_t* start = dst;
+    int point_position = length + decimal_exponent;
+
+    if(length <= point_position && point_position <= 21)
+    {
+        memcpy(dst, digits, length);
+        memset(dst + length, '0', point_position - length);
+        return dst + point_position - start;
+    }
+    if(0 < point_position && point_position <= 21)
+    {
+        memcpy(dst, digits, point_position);
+        dst += point_position;
+        *dst++ = '.';
+        memcpy(dst, digits + point_position, length - point_position);
+        return dst + length - point_position - start;
+    }
+    if(-6 < point_position && point_position <= 0)
+    {
+        *dst++ = '0';
+        *dst++ = '.';
+        memset(dst, '0', -point_position);
+        dst += -point_position;
+        memcpy(dst, digits, length);
+        return dst + length - start;
+    }
+
+    *dst++ = digits[0];
+    if(length > 1)
+    {
+        *dst++ = '.';
+        memcpy(dst, digits + 1, length - 1);
+        dst += length - 1;
+    }
+    *dst++ = 'e';
+    int exponent = point_position - 1;
+    *dst++ = exponent < 0 ? '-' : '+';
+    dst += format_decimal(exponent < 0 ? -exponent : exponent, dst, 1);
+    return dst - start;
+}
+
+typedef struct
+{
+    bool is_negative;
+    bool is_nan;
+    bool is_infinity;
+    bool is_lower_boundary_closer;
+    uint64_t significand;
+    int exponent;
+} decoded_float;
+
+/**
+ * Decode the bits of an IEEE 754 binary float of up to 64 bits.
+ *
+ * @param bits The float's bits, right aligned.
+ * @param mantissa_bits The number of explicitly stored mantissa bits (23 for binary32).
+ * @param exponent_bits The number of exponent bits (8 for binary32).
+ */
+static decoded_float decode_float(uint64_t bits, int mantissa_bits, int exponent_bits)
+{
+    const uint64_t hidden_bit = 1ULL << mantissa_bits;
+    const int max_biased_exponent = (1 << exponent_bits) - 1;
+    const int bias = (1 << (exponent_bits - 1)) - 1;
+    int biased_exponent = (int)((bits >> mantissa_bits) & max_biased_exponent);
+    uint64_t fraction = bits & (hidden_bit - 1);
+
+    decoded_float decoded =
+    {
+        .is_negative = (bits >> (mantissa_bits + exponent_bits)) & 1,
+        .is_nan = biased_exponent == max_biased_exponent && fraction != 0,
+        .is_infinity = biased_exponent == max_biased_exponent && fraction == 0,
+        .is_lower_boundary_closer = fraction == 0 && biased_exponent > 1,
+        .significand = biased_exponent == 0 ? fraction : fraction | hidden_bit,
+        .exponent = (biased_exponent == 0 ? 1 : biased_exponent) - bias - mantissa_bits,
+    };
+    return decoded;
+}
+
+static int write_special_float(decoded_float* decoded, uint8_t* dst)
+{
+    uint8_t* start = dst;
+    if(decoded->is_negative)
+    {
+        *dst++ = '-';
+    }
+    memcpy(dst, decoded->is_nan ? "nan" : "inf", 3);
+    return dst + 3 - start;
+}
+
+// Defined with the float parsers.
+static bool is_float_string(const uint8_t* str, int length, int mantissa_bits, uint64_t bits);
+
+// The most significant digits needed for any binary64 value to read back exactly.
+#define FLOAT_64_MAX_DIGITS 17
+
+/**
+ * Get the digits of a particular length nearest to a float that read back as the same float.
+ *
+ * @param value The float's value (all of the formats up to 8 bytes fit exactly in a double).
+ * @param magnitude_bits The float's bits, without the sign.
+ * @param decimal_exponent out: The decimal exponent such that the value is digits * 10^decimal_exponent.
+ * @return The digits as an integer, or 0 if no digits of this length read back as the same float.
+ */
+static uint64_t get_round_trip_digits(double value,
+                                      bool is_lower_boundary_closer,
+                                      uint64_t magnitude_bits,
+                                      int mantissa_bits,
+                                      int length,
+                                      int* decimal_exponent)
+{
+    char text[40];
+    // libc gives the nearest digits of this length. When the float below is closer than the
+    // float above, the next digits up can still read back when the nearest ones don't.
+    snprintf(text, sizeof(text), "%.*e", length - 1, value);
+    uint64_t candidate = (uint64_t)(text[0] - '0');
+    for(int i = 2; i <= length; i++)
+    {
+        candidate = candidate * 10 + (uint64_t)(text[i] - '0');
+    }
+    *decimal_exponent = atoi(text + (length > 1 ? length + 2 : 2)) - (length - 1);
+    const uint64_t last_candidate = candidate + is_lower_boundary_closer;
+    for(; candidate <= last_candidate; candidate++)
+    {
+        int text_length = snprintf(text, sizeof(text), "%llue%d", (unsigned long long)candidate, *decimal_exponent);
+        if(is_float_string((uint8_t*)text, text_length, mantissa_bits, magnitude_bits))
+        {
+            return candidate;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Find the shortest digits that read back as the same float by trying lengths around an estimate.
+ * This is slow but exact, and only gets used for the few values that Grisu3 isn't sure about.
+ *
+ * @param magnitude_bits The float's bits, without the sign.
+ * @param estimated_length Where to start looking.
+ */
+static int find_shortest_digits(const decoded_float* decoded,
+                                uint64_t magnitude_bits,
+                                int mantissa_bits,
+                                int estimated_length,
+                                uint8_t* digits,
+                                int* decimal_exponent)
+{
+    const double value = ldexp((double)decoded->significand, decoded->exponent);
+    const bool is_lower_boundary_closer = decoded->is_lower_boundary_closer;
+
+    // Adding zeros to digits that read back gives longer digits that also read back, so the
+    // shortest length is the one right after the longest that doesn't work.
+    int length = estimated_length < FLOAT_64_MAX_DIGITS ? estimated_length : FLOAT_64_MAX_DIGITS;
+    uint64_t result;
+    while((result = get_round_trip_digits(value, is_lower_boundary_closer, magnitude_bits, mantissa_bits, length, decimal_exponent)) == 0)
+    {
+        length++;
+    }
+    for(; length > 1; length--)
+    {
+        int shorter_exponent = 0;
+        uint64_t shorter = get_round_trip_digits(value, is_lower_boundary_closer, magnitude_bits, mantissa_bits, length - 1, &shorter_exponent);
+        if(shorter == 0)
+        {
+            break;
+        }
+        result = shorter;
+        *decimal_exponent = shorter_exponent;
+    }
+
+    for(; result % 10 == 0; result /= 10)
+    {
+        (*decimal_exponent)++;
+    }
+    const int digit_count = get_decimal_digit_count(result);
+    write_decimal_digits_backwards(digits + digit_count, result);
+    return digit_count;
+}
+
+/**
+ * Write the shortest decimal representation of a float that reads back as the same value.
+ *
+ * @return The number of characters written.
+ */
+static int format_float_shortest(uint64_t bits, int mantissa_bits, int exponent_bits, uint8_t* dst)
+{
+    decoded_float decoded = decode_float(bits, mantissa_bits, exponent_bits);
+    if(decoded.is_nan || decoded.is_infinity)
+    {
+        return write_special_float(&decoded, dst);
+    }
+
+    uint8_t* start = dst;
+    if(decoded.is_negative)
+    {
+        *dst++ = '-';
+    }
+    if(decoded.significand == 0)
+    {
+        *dst++ = '0';
+        return dst - start;
+    }
+
+    uint8_t digits[24];
+    int length = 0;
+    int decimal_exponent = 0;
+    if(!grisu3(decoded.significand, decoded.exponent, decoded.is_lower_boundary_closer, digits, &length, &decimal_exponent))
+    {
+        const uint64_t magnitude_bits = bits & ((1ULL << (mantissa_bits + exponent_bits)) - 1);
+        length = find_shortest_digits(&decoded, magnitude_bits, mantissa_bits, length, digits, &decimal_exponent);
+    }
+    return dst + write_shortest_notation(digits, length, decimal_exponent, dst) - start;
+}
+
+static int format_float_fixed_using_libc(decoded_float* decoded, int precision, uint8_t* dst)
+{
+    double value = ldexp((double)decoded->significand, decoded->exponent);
+    return sprintf((char*)dst, "%.*f", precision, decoded->is_negative ? -value : value);
+}
+
+/**
+ * Write a float with a fixed number of digits after the decimal point.
+ * Produces the same output as sprintf("%.*f"), with exact round-half-even rounding.
+ *
+ * @return The number of characters written.
+ */
+static int format_float_fixed(uint64_t bits, int mantissa_bits, int exponent_bits, int precision, uint8_t* dst)
+{
+    decoded_float decoded = decode_float(bits, mantissa_bits, exponent_bits);
+    if(decoded.is_nan || decoded.is_infinity)
+    {
+        return write_special_float(&decoded, dst);
+    }
+
+    uint64_t integral = 0;
+    uint64_t fractional = 0;
+    const int significand_length = get_bit_length(decoded.significand);
+
+    if(decoded.exponent >= 0)
+    {
+        if(significand_length + decoded.exponent > 64)
+        {
+            return format_float_fixed_using_libc(&decoded, precision, dst);
+        }
+        integral = decoded.significand << decoded.exponent;
+    }
+    else
+    {
+        // value * 10^precision = significand * 10^precision / 2^shift, which is exact in 128 bits.
+        if(precision >= 20 || significand_length + get_bit_length(g_powers_of_10[precision]) > 127)
+        {
+            return format_float_fixed_using_libc(&decoded, precision, dst);
+        }
+        const int shift = -decoded.exponent;
+        unsigned __int128 scaled = (unsigned __int128)decoded.significand * g_powers_of_10[precision];
+        unsigned __int128 rounded = 0;
+        if(shift < 128)
+        {
+            rounded = scaled >> shift;
+            unsigned __int128 remainder = scaled & ((((unsigned __int128)1) << shift) - 1);
+            unsigned __int128 half = ((unsigned __int128)1) << (shift - 1);
+            if(remainder > half || (remainder == half && (rounded & 1)))
+            {
+                rounded++;
+            }
+        }
+        unsigned __int128 integral_wide = rounded / g_powers_of_10[precision];
+        if(integral_wide >> 64)
+        {
+            return format_float_fixed_using_libc(&decoded, precision, dst);
+        }
+        integral = (uint64_t)integral_wide;
+        fractional = (uint64_t)(rounded % g_powers_of_10[precision]);
+    }
+
+    uint8_t* start = dst;
+    if(decoded.is_negative)
+    {
+        *dst++ = '-';
+    }
+    int digit_count = get_decimal_digit_count(integral);
+    write_decimal_digits_backwards(dst + digit_count, integral);
+    dst += digit_count;
+    if(precision > 0)
+    {
+        *dst++ = '.';
+        // Past 19 digits, only exact integers get here, so the extra digits are all zero.
+        int fractional_width = precision < 20 ? precision : 19;
+        int fractional_digit_count = get_decimal_digit_count(fractional);
+        dst = write_zero_padding(dst, fractional_digit_count, fractional_width);
+        write_decimal_digits_backwards(dst, fractional);
+        memset(dst, '0', precision - fractional_width);
+        dst += precision - fractional_width;
+    }
+    return dst - start;
+}
+
+/**
+ * Print a float in either shortest round-trip form (if precision is PRINT_WIDTH_UNSPECIFIED),
+ * or with a fixed number of digits after the decimal point.
+ */
+static inline int format_float(uint64_t bits, int mantissa_bits, int exponent_bits, int precision, uint8_t* dst)
+{
+    if(precision < 0)
+    {
+        return format_float_shortest(bits, mantissa_bits, exponent_bits, dst);
+    }
+    return format_float_fixed(bits, mantissa_bits, exponent_bits, precision, dst);
+}
+
+#if BO_HAS_QUADMATH
+// binary128 has too many significand bits for Grisu, so it goes through libquadmath instead.
+
+// The most significant digits needed for any binary128 value to read back exactly.
+#define FLOAT_128_MAX_DIGITS 36
+
+// Digits to get from libquadmath before rounding down to the shortest length. The extra
+// digits past FLOAT_128_MAX_DIGITS keep the decimal rounding from going wrong.
+#define FLOAT_128_SOURCE_DIGITS 40
+
+/**
+ * Round a string of decimal digits to fewer digits (round half up), carrying into the exponent if needed.
+ *
+ * @return The number of digits, with trailing zeros removed.
+ */
+static int round_decimal_digits(const uint8_t* src, int length, uint8_t* dst, int* decimal_exponent)
+{
+    memcpy(dst, src, length);
+    if(src[length] >= '5')
+    {
+        int i = length - 1;
+        for(; i >= 0 && dst[i] == '9'; i--)
+        {
+            dst[i] = '0';
+        }
+        if(i < 0)
+        {
+            dst[0] = '1';
+            (*decimal_exponent)++;
+        }
+        else
+        {
+            dst[i]++;
+        }
+    }
+    while(length > 1 && dst[length - 1] == '0')
+    {
+        length--;
+    }
+    return length;
+}
+
+/**
+ * Print a binary128 float the same way that format_float() prints the narrower widths.
+ * The shortest digits are found by rounding a long decimal expansion to fewer and fewer
+ * digits, until it no longer reads back as the same value.
+ */
+static int format_float_128(__float128 value, int precision, uint8_t* dst)
+{
+    if(precision >= 0)
+    {
+        // Callers leave room for the terminator.
+        return quadmath_snprintf((char*)dst, 1 + 4933 + 1 + precision + 1, "%.*Qf", precision, value);
+    }
+
+    uint8_t* start = dst;
+    if(signbitq(value))
+    {
+        *dst++ = '-';
+        value = -value;
+    }
+    if(isnanq(value) || isinfq(value))
+    {
+        memcpy(dst, isnanq(value) ? "nan" : "inf", 3);
+        return dst + 3 - start;
+    }
+    if(value == 0)
+    {
+        *dst++ = '0';
+        return dst - start;
+    }
+
+    // buffer is d.ddd...e[+-]xx
+    char buffer[FLOAT_128_SOURCE_DIGITS + 16];
+    quadmath_snprintf(buffer, sizeof(buffer), "%.*Qe", FLOAT_128_SOURCE_DIGITS - 1, value);
+    uint8_t source_digits[FLOAT_128_SOURCE_DIGITS];
+    source_digits[0] = (uint8_t)buffer[0];
+    memcpy(source_digits + 1, buffer + 2, FLOAT_128_SOURCE_DIGITS - 1);
+    const int source_exponent = atoi(buffer + FLOAT_128_SOURCE_DIGITS + 2) - (FLOAT_128_SOURCE_DIGITS - 1);
+
+    // FLOAT_128_MAX_DIGITS always reads back, so the search starts below that.
+    uint8_t digits[FLOAT_128_MAX_DIGITS];
+    int decimal_exponent = source_exponent + FLOAT_128_SOURCE_DIGITS - FLOAT_128_MAX_DIGITS;
+    int length = round_decimal_digits(source_digits, FLOAT_128_MAX_DIGITS, digits, &decimal_exponent);
+    decimal_exponent += FLOAT_128_MAX_DIGITS - length;
+    int low = 1;
+    int high = FLOAT_128_MAX_DIGITS - 1;
+    while(low <= high)
+    {
+        int middle = (low + high) / 2;
+        uint8_t candidate[FLOAT_128_MAX_DIGITS];
+        int candidate_exponent = source_exponent + FLOAT_128_SOURCE_DIGITS - middle;
+        int candidate_length = round_decimal_digits(source_digits, middle, candidate, &candidate_exponent);
+        candidate_exponent += middle - candidate_length;
+
+        char text[FLOAT_128_MAX_DIGITS + 16];
+        memcpy(text, candidate, candidate_length);
+        sprintf(text + candidate_length, "e%d", candidate_exponent);
+        if(strtoflt128(text, NULL) == value)
+        {
+            memcpy(digits, candidate, candidate_length);
+            length = candidate_length;
+            decimal_exponent = candidate_exponent;
+            high = middle - 1;
+        }
+        else
+        {
+            low = middle + 1;
+        }
+    }
+    return dst + write_shortest_notation(digits, length, decimal_exponent, dst) - start;
+}
+#endif
+
+/**
+ * Encode a double as an IEEE 754 binary float of up to 64 bits, rounding to nearest even.
+ * Values too large for the format become infinity, and values too small become zero.
+ *
+ * @param value The value to encode.
+ * @param mantissa_bits The number of explicitly stored mantissa bits (10 for binary16).
+ * @param exponent_bits The number of exponent bits (5 for binary16).
+ * @return The float's bits, right aligned.
+ */
+static uint64_t encode_float(double value, int mantissa_bits, int exponent_bits)
+{
+    uint64_t double_bits;
+    memcpy(&double_bits, &value, sizeof(double_bits));
+    const uint64_t sign = (double_bits >> 63) << (mantissa_bits + exponent_bits);
+    const uint64_t max_biased_exponent = (1 << exponent_bits) - 1;
+    const int double_exponent = (int)((double_bits >> 52) & 0x7ff);
+    const uint64_t double_fraction = double_bits & ((1ULL << 52) - 1);
+
+    if(double_exponent == 0x7ff)
+    {
+        // Keep the top of the NaN payload, and make sure it stays a NaN.
+        uint64_t fraction = double_fraction == 0 ? 0 : (double_fraction >> (52 - mantissa_bits)) | (1ULL << (mantissa_bits - 1));
+        return sign | (max_biased_exponent << mantissa_bits) | fraction;
+    }
+    if(double_exponent == 0)
+    {
+        // Double subnormals are far below the smallest value of any narrower format.
+        return sign;
+    }
+
+    const int biased_exponent = double_exponent - 1023 + (1 << (exponent_bits - 1)) - 1;
+    const uint64_t significand = double_fraction | (1ULL << 52);
+    int shift = 52 - mantissa_bits;
+    if(biased_exponent < 1)
+    {
+        shift += 1 - biased_exponent;
+        if(shift > 53)
+        {
+            return sign;
+        }
+    }
+
+    uint64_t rounded = significand >> shift;
+    const uint64_t remainder = significand & ((1ULL << shift) - 1);
+    const uint64_t half = 1ULL << (shift - 1);
+    if(remainder > half || (remainder == half && (rounded & 1)))
+    {
+        rounded++;
+    }
+
+    // The hidden bit carries into the exponent field, as does any rounding overflow.
+    uint64_t bits = biased_exponent < 1 ? rounded : ((uint64_t)(biased_exponent - 1) << mantissa_bits) + rounded;
+    if(bits >= max_biased_exponent << mantissa_bits)
+    {
+        bits = max_biased_exponent << mantissa_bits;
+    }
+    return sign | bits;
+}
+
+
+
+// ------------------
+// Decimal Formatting
+// ------------------
+
+// IEEE 754 decimals are described by their BID (binary integer decimal) layout, so that decimal32,
+// decimal64 and decimal128 share the same code. The coefficient is a plain binary integer, so its
+// digits come from the same digit pair tables as the integer types.
+
+typedef struct
+{
+    int width;
+    int exponent_bits;
+    int bias;
+    int precision;
+} decimal_layout;
+
+static const decimal_layout g_decimal_32_layout  = {4,  8,  101,  7};
+static const decimal_layout g_decimal_64_layout  = {8,  10, 398,  16};
+static const decimal_layout g_decimal_128_layout = {16, 14, 6176, 34};
+
+typedef struct
+{
+    bool is_negative;
+    bool is_nan;
+    bool is_infinity;
+    unsigned __int128 coefficient;
+    int exponent;
+} decoded_decimal;
+
+static inline unsigned __int128 get_power_of_10_128(int power)
+{
+    unsigned __int128 value = g_powers_of_10[power < 19 ? power : 19];
+    for(; power > 19; power--)
+    {
+        value *= 10;
+    }
+    return value;
+}
+
+static inline int get_decimal_max_exponent(const decimal_layout* layout)
+{
+    return 3 * (1 << (layout->exponent_bits - 2)) - 1 - layout->bias;
+}
+
+/**
+ * Decode the bits of a BID encoded decimal.
+ * Non-canonical coefficients (too many digits for the format) decode as 0, as the standard requires.
+ */
+static inline decoded_decimal decode_decimal(unsigned __int128 bits, const decimal_layout* layout)
+{
+    const int total_bits = layout->width * 8;
+    const int coefficient_bits = total_bits - 1 - layout->exponent_bits;
+    const int combination = (int)(bits >> (total_bits - 6)) & 0x1f;
+    const unsigned __int128 one = 1;
+    const int exponent_mask = (1 << layout->exponent_bits) - 1;
+
+    decoded_decimal decoded =
+    {
+        .is_negative = (bits >> (total_bits - 1)) & 1,
+        .is_nan = combination == 0x1f,
+        .is_infinity = combination == 0x1e,
+    };
+    if((combination >> 3) == 3)
+    {
+        // Large form: The top 3 coefficient bits are an implied 100, and the exponent moves down 2 bits.
+        decoded.exponent = (int)(bits >> (coefficient_bits - 2)) & exponent_mask;
+        decoded.coefficient = (one << coefficient_bits) | (bits & ((one << (coefficient_bits - 2)) - 1));
+    }
+    else
+    {
+        decoded.exponent = (int)(bits >> coefficient_bits) & exponent_mask;
+        decoded.coefficient = bits & ((one << coefficient_bits) - 1);
+    }
+    decoded.exponent -= layout->bias;
+    if(decoded.coefficient >= get_power_of_10_128(layout->precision))
+    {
+        decoded.coefficient = 0;
+    }
+    return decoded;
+}
+
+/**
+ * Encode a decimal that is already within the format's precision and exponent range as BID.
+ */
+static unsigned __int128 encode_decimal(const decoded_decimal* decoded, const decimal_layout* layout)
+{
+    const int total_bits = layout->width * 8;
+    const int coefficient_bits = total_bits - 1 - layout->exponent_bits;
+    const unsigned __int128 one = 1;
+    const unsigned __int128 sign = (unsigned __int128)decoded->is_negative << (total_bits - 1);
+    if(decoded->is_nan || decoded->is_infinity)
+    {
+        return sign | ((unsigned __int128)(decoded->is_nan ? 0x1f : 0x1e) << (total_bits - 6));
+    }
+
+    const unsigned __int128 biased_exponent = decoded->exponent + layout->bias;
+    if(decoded->coefficient >> coefficient_bits == 0)
+    {
+        return sign | (biased_exponent << coefficient_bits) | decoded->coefficient;
+    }
+    return sign | ((unsigned __int128)3 << (total_bits - 3)) | (biased_exponent << (coefficient_bits - 2)) |
+           (decoded->coefficient & ((one << (coefficient_bits - 2)) - 1));
+}
+
+/**
+ * Lay out coefficient digits * 10^exponent the way the General Decimal Arithmetic to-scientific-string
+ * does (keeping trailing zeros, so 1.50 stays 1.50), but with a lowercase exponent as the floats use.
+ */
+static int write_decimal_notation(const uint8_t* digits, int length, int exponent, uint8_t* dst)
+{
+    uint8_t* start = dst;
+    const int adjusted_exponent = exponent + length - 1;
+    if(exponent <= 0 && adjusted_exponent >= -6)
+    {
+        int point_position = length + exponent;
+        if(exponent == 0)
+        {
+            memcpy(dst, digits, length);
+            return length;
+        }
+        if(point_position > 0)
+        {
+            memcpy(dst, digits, point_position);
+            dst += point_position;
+            *dst++ = '.';
+            memcpy(dst, digits + point_position, length - point_position);
+            return dst + length - point_position - start;
+        }
+        *dst++ = '0';
+        *dst++ = '.';
+        memset(dst, '0', -point_position);
+        dst += -point_position;
+        memcpy(dst, digits, length);
+        return dst + length - start;
+    }
+
+    *dst++ = digits[0];
+    if(length > 1)
+    {
+        *dst++ = '.';
+        memcpy(dst, digits + 1, length - 1);
+        dst += length - 1;
+    }
+    *dst++ = 'e';
+    *dst++ = adjusted_exponent < 0 ? '-' : '+';
+    dst += format_decimal(adjusted_exponent < 0 ? -adjusted_exponent : adjusted_exponent, dst, 1);
+    return dst - start;
+}
+
+/**
+ * Write coefficient digits * 10^exponent with a fixed number of digits after the decimal point,
+ * rounding half to even.
+ */
+static int write_decimal_fixed(uint8_t* digits, int length, int exponent, int precision, uint8_t* dst)
+{
+    uint8_t* start = dst;
+    // The number of digits that stay after rounding off everything past the precision.
+    int kept_length = length + exponent + precision;
+    if(kept_length < length)
+    {
+        bool is_round_up = false;
+        if(kept_length >= 0)
+        {
+            uint8_t first_dropped = digits[kept_length];
+            bool is_rest_zero = true;
+            for(int i = kept_length + 1; i < length; i++)
+            {
+                if(digits[i] != '0')
+                {
+                    is_rest_zero = false;
+                    break;
+                }
+            }
+            bool is_odd = kept_length > 0 && (digits[kept_length - 1] & 1);
+            is_round_up = first_dropped > '5' || (first_dropped == '5' && (!is_rest_zero || is_odd));
+        }
+        if(kept_length < 0)
+        {
+            kept_length = 0;
+        }
+        exponent = -precision;
+        length = kept_length;
+        if(is_round_up)
+        {
+            int i = length - 1;
+            for(; i >= 0 && digits[i] == '9'; i--)
+            {
+                digits[i] = '0';
+            }
+            if(i >= 0)
+            {
+                digits[i]++;
+            }
+            else
+            {
+                // All nines (or nothing) rounded up to a 1 followed by zeros.
+                memmove(digits + 1, digits, length);
+                digits[0] = '1';
+                length++;
+            }
+        }
+    }
+
+    // Now the value is digits * 10^exponent, with exponent >= -precision.
+    int integral_length = length + exponent;
+    if(integral_length <= 0)
+    {
+        *dst++ = '0';
+    }
+    else if(integral_length <= length)
+    {
+        memcpy(dst, digits, integral_length);
+        dst += integral_length;
+    }
+    else
+    {
+        memcpy(dst, digits, length);
+        memset(dst + length, '0', exponent);
+        dst += integral_length;
+    }
+    if(precision > 0)
+    {
+        *dst++ = '.';
+        // Fraction digits: leading zeros, then whatever digits are past the point, then trailing zeros.
+        int leading_zeros = integral_length < 0 ? -integral_length : 0;
+        if(leading_zeros > precision)
+        {
+            leading_zeros = precision;
+        }
+        memset(dst, '0', leading_zeros);
+        dst += leading_zeros;
+        int fraction_start = integral_length > 0 ? integral_length : 0;
+        int fraction_length = length - fraction_start;
+        if(fraction_length > 0)
+        {
+            memcpy(dst, digits + fraction_start, fraction_length);
+            dst += fraction_length;
+        }
+        else
+        {
+            fraction_length = 0;
+        }
+        int trailing_zeros = precision - leading_zeros - fraction_length;
+        memset(dst, '0', trailing_zeros);
+        dst += trailing_zeros;
+    }
+    return dst - start;
+}
+
+/**
+ * Print a BID decimal in to-scientific-string form (if precision is PRINT_WIDTH_UNSPECIFIED),
+ * or with a fixed number of digits after the decimal point.
+ */
+static inline int format_decimal_float(unsigned __int128 bits, const decimal_layout* layout, int precision, uint8_t* dst)
+{
+    decoded_decimal decoded = decode_decimal(bits, layout);
+    uint8_t* start = dst;
+    if(decoded.is_negative && !decoded.is_nan)
+    {
+        *dst++ = '-';
+    }
+    if(decoded.is_nan || decoded.is_infinity)
+    {
+        memcpy(dst, decoded.is_nan ? "nan" : "inf", 3);
+        return dst + 3 - start;
+    }
+
+    // Room for rounding to carry into a new digit.
+    uint8_t digits[40];
+    int length = format_decimal_128((__int128)decoded.coefficient, digits, 1);
+    if(precision < 0)
+    {
+        return dst + write_decimal_notation(digits, length, decoded.exponent, dst) - start;
+    }
+    if(decoded.coefficient == 0 && decoded.exponent > 0)
+    {
+        decoded.exponent = 0;
+    }
+    return dst + write_decimal_fixed(digits, length, decoded.exponent, precision, dst) - start;
+}
+
+
+
+// -------------
+// Byte Swapping
+// -------------
+
+static inline void copy_swapped(uint8_t* dst, const uint8_t* src, int length)
+{
+	for(int i = 0; i < length; i++)
+	{
+		dst[i] = src[length - i - 1];
+	}
+}
+
+// Fixed width swaps. Source and destination may be the same memory.
+
+static inline void copy_swapped_2(uint8_t* dst, const uint8_t* src)
+{
+    uint16_t value;
+    memcpy(&value, src, sizeof(value));
+    value = __builtin_bswap16(value);
+    memcpy(dst, &value, sizeof(value));
+}
+
+static inline void copy_swapped_4(uint8_t* dst, const uint8_t* src)
+{
+    uint32_t value;
+    memcpy(&value, src, sizeof(value));
+    value = __builtin_bswap32(value);
+    memcpy(dst, &value, sizeof(value));
+}
+
+static inline void copy_swapped_8(uint8_t* dst, const uint8_t* src)
+{
+    uint64_t value;
+    memcpy(&value, src, sizeof(value));
+    value = __builtin_bswap64(value);
+    memcpy(dst, &value, sizeof(value));
+}
+
+static inline void copy_swapped_16(uint8_t* dst, const uint8_t* src)
+{
+    uint64_t values[2];
+    memcpy(values, src, sizeof(values));
+    values[0] = __builtin_bswap64(values[0]);
+    values[1] = __builtin_bswap64(values[1]);
+    memcpy(dst, values + 1, sizeof(values[1]));
+    memcpy(dst + sizeof(values[1]), values, sizeof(values[0]));
+}
+
+// Block swaps: Reverse the byte order of every width-sized element in a block.
+// The length must be a multiple of the width. Source and destination may be the same memory.
+
+static void swap_block_scalar(uint8_t* dst, const uint8_t* src, int length, int width)
+{
+    switch(width)
+    {
+        case 2:
+            for(int i = 0; i < length; i += 2)
+            {
+                copy_swapped_2(dst + i, src + i);
+            }
+            return;
+        case 4:
+            for(int i = 0; i < length; i += 4)
+            {
+                copy_swapped_4(dst + i, src + i);
+            }
+            return;
+        case 8:
+            for(int i = 0; i < length; i += 8)
+            {
+                copy_swapped_8(dst + i, src + i);
+            }
+            return;
+        case 16:
+            for(int i = 0; i < length; i += 16)
+            {
+                copy_swapped_16(dst + i, src + i);
+            }
+            return;
+        default:
+            for(int i = 0; i < length; i += width)
+            {
+                copy_swapped(dst + i, src + i, width);
+            }
+            return;
+    }
+}
+
+#if BO_HAS_X86_SIMD
+// Shuffle masks that reverse each 2, 4, 8, or 16 byte group within a 16 byte lane.
+static const uint8_t g_swap_shuffle_masks[][16] =
+{
+    {1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14},
+    {3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12},
+    {7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8},
+    {15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0},
+};
+
+static inline const uint8_t* get_swap_shuffle_mask(int width)
+{
+    return g_swap_shuffle_masks[__builtin_ctz(width) - 1];
+}
+
+BO_TARGET("ssse3")
+static void swap_block_ssse3(uint8_t* dst, const uint8_t* src, int length, int width)
+{
+    const __m128i mask = _mm_loadu_si128((const __m128i*)get_swap_shuffle_mask(width));
+    int i = 0;
+    for(; i + 16 <= length; i += 16)
+    {
+        __m128i data = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_shuffle_epi8(data, mask));
+    }
+    swap_block_scalar(dst + i, src + i, length - i, width);
+}
+
+BO_TARGET("avx2")
+static void swap_block_avx2(uint8_t* dst, const uint8_t* src, int length, int width)
+{
+    const __m256i mask = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)get_swap_shuffle_mask(width)));
+    int i = 0;
+    for(; i + 32 <= length; i += 32)
+    {
+        __m256i data = _mm256_loadu_si256((const __m256i*)(src + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_shuffle_epi8(data, mask));
+    }
+    swap_block_ssse3(dst + i, src + i, length - i, width);
+}
+#endif
+
+static void swap_block(uint8_t* dst, const uint8_t* src, int length, int width)
+{
+#if BO_HAS_X86_SIMD
+    if(width == 2 || width == 4 || width == 8 || width == 16)
+    {
+        if(cpu_has_avx2())
+        {
+            swap_block_avx2(dst, src, length, width);
+            return;
+        }
+        if(cpu_has_ssse3())
+        {
+            swap_block_ssse3(dst, src, length, width);
+            return;
+        }
+    }
+#endif
+    swap_block_scalar(dst, src, length, width);
+}
+
+
+
+// ---------------
+// String Printers
+// ---------------
+
+/**
+ * String printer.
+ * Reads data from the source and writes to the destination.
+ *
+ * @param src Pointer to the source data.
+ * @param dst Pointer to the destination buffer.
+ * @param output_width in: Minimum bytes to print. out: Number of bytes written.
+ * @return Number of bytes read.
+ */
+typedef int (*string_printer)(uint8_t* src, uint8_t* dst, int* output_width);
+
+// Common batch loop. This always gets inlined with a constant string printer, so that every
+// batch printer ends up with its own loop containing the string printer code.
+static inline __attribute__((always_inline)) int print_entries(string_printer print_entry,
+                                                              uint8_t* src,
+                                                              int src_length,
+                                                              uint8_t* dst,
+                                                              int dst_capacity,
+                                                              entry_format* format,
+                                                              int* bytes_written)
+{
+    uint8_t* src_pos = src;
+    uint8_t* const src_end = src + src_length;
+    uint8_t* dst_pos = dst;
+    uint8_t* const dst_end = dst + dst_capacity;
+    const int max_entry_length = format->max_entry_length;
+    const int prefix_length = format->prefix_length;
+    const int suffix_length = format->suffix_length;
+
+    if(!format->has_printed_entry && src_pos < src_end && dst_end - dst_pos >= max_entry_length)
+    {
+        memcpy(dst_pos, format->prefix, prefix_length);
+        dst_pos += prefix_length;
+        int output_width = format->text_width;
+        src_pos += print_entry(src_pos, dst_pos, &output_width);
+        dst_pos += output_width;
+        format->has_printed_entry = true;
+    }
+
+    if(prefix_length == 0 && suffix_length == 0)
+    {
+        while(src_pos < src_end && dst_end - dst_pos >= max_entry_length)
+        {
+            int output_width = format->text_width;
+            src_pos += print_entry(src_pos, dst_pos, &output_width);
+            dst_pos += output_width;
+        }
+    }
+    else
+    {
+        const int separator_length = suffix_length + prefix_length;
+        if(separator_length <= ENTRY_SEPARATOR_COPY_SIZE)
+        {
+            while(src_pos < src_end && dst_end - dst_pos >= max_entry_length + ENTRY_SEPARATOR_COPY_SIZE)
+            {
+                memcpy(dst_pos, format->separator, ENTRY_SEPARATOR_COPY_SIZE);
+                dst_pos += separator_length;
+                int output_width = format->text_width;
+                src_pos += print_entry(src_pos, dst_pos, &output_width);
+                dst_pos += output_width;
+            }
+        }
+
+        // Whatever doesn't fit the fast loop above.
+        while(src_pos < src_end && dst_end - dst_pos >= max_entry_length)
+        {
+            memcpy(dst_pos, format->suffix, suffix_length);
+            dst_pos += suffix_length;
+            memcpy(dst_pos, format->prefix, prefix_length);
+            dst_pos += prefix_length;
+            int output_width = format->text_width;
+            src_pos += print_entry(src_pos, dst_pos, &output_width);
+            dst_pos += output_width;
+        }
+    }
+
+    *bytes_written = dst_pos - dst;
+    return src_pos - src;
+}
+
+#define DEFINE_BATCH_PRINTER(STRING_PRINTER) \
+static int batch_ ## STRING_PRINTER (uint8_t* src, int src_length, uint8_t* dst, int dst_capacity, entry_format* format, int* bytes_written) \
+{ \
+    return print_entries(STRING_PRINTER, src, src_length, dst, dst_capacity, format, bytes_written); \
+}
+
+// Force the compiler to generate handler code for unaligned accesses.
+#define DEFINE_SAFE_STRUCT(NAME, TYPE) typedef struct __attribute__((__packed__)) {TYPE contents;} NAME
+DEFINE_SAFE_STRUCT(safe_uint_1,     uint8_t);
+DEFINE_SAFE_STRUCT(safe_uint_2,     uint16_t);
+DEFINE_SAFE_STRUCT(safe_uint_4,     uint32_t);
+DEFINE_SAFE_STRUCT(safe_uint_8,     uint64_t);
+DEFINE_SAFE_STRUCT(safe_uint_16,    unsigned __int128);
+DEFINE_SAFE_STRUCT(safe_int_1,      int8_t);
+DEFINE_SAFE_STRUCT(safe_int_2,      int16_t);
+DEFINE_SAFE_STRUCT(safe_int_4,      int32_t);
+DEFINE_SAFE_STRUCT(safe_int_8,      int64_t);
+DEFINE_SAFE_STRUCT(safe_int_16,     __int128);
+DEFINE_SAFE_STRUCT(safe_float_4,    float);
+DEFINE_SAFE_STRUCT(safe_float_8,    double);
+DEFINE_SAFE_STRUCT(safe_float_16,   __float128);
+DEFINE_SAFE_STRUCT(safe_decimal_8,  _Decimal64);
+DEFINE_SAFE_STRUCT(safe_decimal_16, _Decimal128);
+
+#define DEFINE_INT_STRING_PRINTER(NAMED_TYPE, REAL_TYPE, DATA_WIDTH, FORMATTER) \
+static int string_print_ ## NAMED_TYPE ## _ ## DATA_WIDTH (uint8_t* src, uint8_t* dst, int* output_width) \
+{ \
+	*output_width = FORMATTER(((safe_ ## REAL_TYPE ## _ ## DATA_WIDTH *)src)->contents, dst, *output_width); \
+    return DATA_WIDTH; \
+} \
+DEFINE_BATCH_PRINTER(string_print_ ## NAMED_TYPE ## _ ## DATA_WIDTH)
+
+#define DEFINE_INT_STRING_PRINTER_SWAPPED(NAMED_TYPE, REAL_TYPE, DATA_WIDTH, FORMATTER) \
+DEFINE_INT_STRING_PRINTER(NAMED_TYPE, REAL_TYPE, DATA_WIDTH, FORMATTER) \
+static int string_print_ ## NAMED_TYPE ## _ ## DATA_WIDTH ## _swapped (uint8_t* src, uint8_t* dst, int* output_width) \
+{ \
+	uint8_t buffer[DATA_WIDTH]; \
+	copy_swapped_ ## DATA_WIDTH(buffer, src); \
+	return string_print_ ## NAMED_TYPE ## _ ## DATA_WIDTH (buffer, dst, output_width); \
+} \
+DEFINE_BATCH_PRINTER(string_print_ ## NAMED_TYPE ## _ ## DATA_WIDTH ## _swapped)
+DEFINE_INT_STRING_PRINTER(int, int, 1, format_decimal)
+DEFINE_INT_STRING_PRINTER_SWAPPED(int, int, 2, format_decimal)
+DEFINE_INT_STRING_PRINTER_SWAPPED(int, int, 4, format_decimal)
+DEFINE_INT_STRING_PRINTER_SWAPPED(int, int, 8, format_decimal)
+DEFINE_INT_STRING_PRINTER_SWAPPED(int, int, 16, format_decimal_128)
+DEFINE_INT_STRING_PRINTER(hex, uint, 1, format_hex)
+DEFINE_INT_STRING_PRINTER_SWAPPED(hex, uint, 2, format_hex)
+DEFINE_INT_STRING_PRINTER_SWAPPED(hex, uint, 4, format_hex)
+DEFINE_INT_STRING_PRINTER_SWAPPED(hex, uint, 8, format_hex)
+DEFINE_INT_STRING_PRINTER_SWAPPED(hex, uint, 16, format_hex_128)
+DEFINE_INT_STRING_PRINTER(octal, uint, 1, format_octal)
+DEFINE_INT_STRING_PRINTER_SWAPPED(octal, uint, 2, format_octal)
+DEFINE_INT_STRING_PRINTER_SWAPPED(octal, uint, 4, format_octal)
+DEFINE_INT_STRING_PRINTER_SWAPPED(octal, uint, 8, format_octal)
+DEFINE_INT_STRING_PRINTER_SWAPPED(octal, uint, 16, format_octal_128)
+
+// Expands F(VALUE) for every byte value, for building lookup tables.
+#define BYTE_TABLE_4(F, VALUE)   F(VALUE) F((VALUE) + 1) F((VALUE) + 2) F((VALUE) + 3)
+#define BYTE_TABLE_16(F, VALUE)  BYTE_TABLE_4(F, VALUE) BYTE_TABLE_4(F, (VALUE) + 4) \
+                                 BYTE_TABLE_4(F, (VALUE) + 8) BYTE_TABLE_4(F, (VALUE) + 12)
+#define BYTE_TABLE_64(F, VALUE)  BYTE_TABLE_16(F, VALUE) BYTE_TABLE_16(F, (VALUE) + 16) \
+                                 BYTE_TABLE_16(F, (VALUE) + 32) BYTE_TABLE_16(F, (VALUE) + 48)
+#define BYTE_TABLE_256(F)        BYTE_TABLE_64(F, 0) BYTE_TABLE_64(F, 64) \
+                                 BYTE_TABLE_64(F, 128) BYTE_TABLE_64(F, 192)
+
+// Every byte value as 8 characters of '0' and '1', with the most or least significant bit first.
+#define BOOLEAN_BIT_CHAR(VALUE, BIT) ('0' + (((VALUE) >> (BIT)) & 1))
+#define BOOLEAN_CHARS_MSB_FIRST(VALUE) {BOOLEAN_BIT_CHAR(VALUE, 7), BOOLEAN_BIT_CHAR(VALUE, 6), \
+                                        BOOLEAN_BIT_CHAR(VALUE, 5), BOOLEAN_BIT_CHAR(VALUE, 4), \
+                                        BOOLEAN_BIT_CHAR(VALUE, 3), BOOLEAN_BIT_CHAR(VALUE, 2), \
+                                        BOOLEAN_BIT_CHAR(VALUE, 1), BOOLEAN_BIT_CHAR(VALUE, 0)},
+#define BOOLEAN_CHARS_LSB_FIRST(VALUE) {BOOLEAN_BIT_CHAR(VALUE, 0), BOOLEAN_BIT_CHAR(VALUE, 1), \
+                                        BOOLEAN_BIT_CHAR(VALUE, 2), BOOLEAN_BIT_CHAR(VALUE, 3), \
+                                        BOOLEAN_BIT_CHAR(VALUE, 4), BOOLEAN_BIT_CHAR(VALUE, 5), \
+                                        BOOLEAN_BIT_CHAR(VALUE, 6), BOOLEAN_BIT_CHAR(VALUE, 7)},
+
+static const uint8_t g_boolean_chars_msb_first[256][8] = { BYTE_TABLE_256(BOOLEAN_CHARS_MSB_FIRST) };
+static const uint8_t g_boolean_chars_lsb_first[256][8] = { BYTE_TABLE_256(BOOLEAN_CHARS_LSB_FIRST) };
+
+/**
+ * Print each byte of the source (in memory order) as 8 bits, left padded with zeroes to text_width.
+ *
+ * @param table g_boolean_chars_msb_first for big endian, g_boolean_chars_lsb_first for little endian.
+ */
+static inline int print_boolean(uint8_t* src, uint8_t* dst, int data_width, int text_width, const uint8_t table[256][8])
+{
+    const int bit_width = data_width * 8;
+    const int padding_length = text_width > bit_width ? text_width - bit_width : 0;
+    memset(dst, '0', padding_length);
+    dst += padding_length;
+    for(int i = 0; i < data_width; i++)
+    {
+        memcpy(dst + i * 8, table[src[i]], 8);
+    }
+    return padding_length + bit_width;
+}
+
+#define DEFINE_BOOLEAN_STRING_PRINTER(DATA_WIDTH) \
+static int string_print_boolean_ ## DATA_WIDTH ## _be (uint8_t* src, uint8_t* dst, int* output_width) \
+{ \
+    *output_width = print_boolean(src, dst, DATA_WIDTH, *output_width, g_boolean_chars_msb_first); \
+    return DATA_WIDTH; \
+} \
+static int string_print_boolean_ ## DATA_WIDTH ## _le (uint8_t* src, uint8_t* dst, int* output_width) \
+{ \
+    *output_width = print_boolean(src, dst, DATA_WIDTH, *output_width, g_boolean_chars_lsb_first); \
+    return DATA_WIDTH; \
+} \
+DEFINE_BATCH_PRINTER(string_print_boolean_ ## DATA_WIDTH ## _be) \
+DEFINE_BATCH_PRINTER(string_print_boolean_ ## DATA_WIDTH ## _le)
+DEFINE_BOOLEAN_STRING_PRINTER(1)
+DEFINE_BOOLEAN_STRING_PRINTER(2)
+DEFINE_BOOLEAN_STRING_PRINTER(4)
+DEFINE_BOOLEAN_STRING_PRINTER(8)
+DEFINE_BOOLEAN_STRING_PRINTER(16)
+
+#define DEFINE_FLOAT_STRING_PRINTER(NAMED_TYPE, DATA_WIDTH, MANTISSA_BITS, EXPONENT_BITS) \
+static int string_print_ ## NAMED_TYPE ## _ ## DATA_WIDTH (uint8_t* src, uint8_t* dst, int* output_width) \
+{ \
+    *output_width = format_float(((safe_uint_ ## DATA_WIDTH *)src)->contents, MANTISSA_BITS, EXPONENT_BITS, *output_width, dst); \
+    return DATA_WIDTH; \
+} \
+static int string_print_ ## NAMED_TYPE ## _ ## DATA_WIDTH ## _swapped (uint8_t* src, uint8_t* dst, int* output_width) \
+{ \
+	uint8_t buffer[DATA_WIDTH]; \
+	copy_swapped_ ## DATA_WIDTH(buffer, src); \
+	return string_print_ ## NAMED_TYPE ## _ ## DATA_WIDTH (buffer, dst, output_width); \
+} \
+DEFINE_BATCH_PRINTER(string_print_ ## NAMED_TYPE ## _ ## DATA_WIDTH) \
+DEFINE_BATCH_PRINTER(string_print_ ## NAMED_TYPE ## _ ## DATA_WIDTH ## _swapped)
+DEFINE_FLOAT_STRING_PRINTER(float, 2, 10, 5)
+DEFINE_FLOAT_STRING_PRINTER(float, 4, 23, 8)
+DEFINE_FLOAT_STRING_PRINTER(float, 8, 52, 11)
+DEFINE_FLOAT_STRING_PRINTER(bfloat, 2, 7, 8)
+#if BO_HAS_QUADMATH
+static int string_print_float_16(uint8_t* src, uint8_t* dst, int* output_width)
+{
+    *output_width = format_float_128(((safe_float_16*)src)->contents, *output_width, dst);
+    return 16;
+}
+static int string_print_float_16_swapped(uint8_t* src, uint8_t* dst, int* output_width)
+{
+	uint8_t buffer[16];
+	copy_swapped_16(buffer, src);
+	return string_print_float_16(buffer, dst, output_width);
+}
+DEFINE_BATCH_PRINTER(string_print_float_16)
+DEFINE_BATCH_PRINTER(string_print_float_16_swapped)
+#endif
+
+#define DEFINE_DECIMAL_STRING_PRINTER(DATA_WIDTH, BITS) \
+static int string_print_decimal_ ## DATA_WIDTH (uint8_t* src, uint8_t* dst, int* output_width) \
+{ \
+    *output_width = format_decimal_float(((safe_uint_ ## DATA_WIDTH *)src)->contents, &g_decimal_ ## BITS ## _layout, *output_width, dst); \
+    return DATA_WIDTH; \
+} \
+static int string_print_decimal_ ## DATA_WIDTH ## _swapped (uint8_t* src, uint8_t* dst, int* output_width) \
+{ \
+	uint8_t buffer[DATA_WIDTH]; \
+	copy_swapped_ ## DATA_WIDTH(buffer, src); \
+	return string_print_decimal_ ## DATA_WIDTH (buffer, dst, output_width); \
+} \
+DEFINE_BATCH_PRINTER(string_print_decimal_ ## DATA_WIDTH) \
+DEFINE_BATCH_PRINTER(string_print_decimal_ ## DATA_WIDTH ## _swapped)
+DEFINE_DECIMAL_STRING_PRINTER(4, 32)
+DEFINE_DECIMAL_STRING_PRINTER(8, 64)
+DEFINE_DECIMAL_STRING_PRINTER(16, 128)
+
+#define DEFINE_BINARY_PRINTER(DATA_WIDTH) \
+static int binary_print_ ## DATA_WIDTH (uint8_t* src, uint8_t* dst, int* output_width) \
+{ \
+    memcpy(dst, src, DATA_WIDTH); \
+    *output_width = DATA_WIDTH; \
+    return DATA_WIDTH; \
+} \
+static int binary_print_ ## DATA_WIDTH ## _swapped(uint8_t* src, uint8_t* dst, int* output_width) \
+{ \
+    copy_swapped_ ## DATA_WIDTH(dst, src); \
+    *output_width = DATA_WIDTH; \
+    return DATA_WIDTH; \
+} \
+DEFINE_BATCH_PRINTER(binary_print_ ## DATA_WIDTH) \
+DEFINE_BATCH_PRINTER(binary_print_ ## DATA_WIDTH ## _swapped)
+DEFINE_BINARY_PRINTER(2)
+DEFINE_BINARY_PRINTER(4)
+DEFINE_BINARY_PRINTER(8)
+DEFINE_BINARY_PRINTER(16)
+static int binary_print_1(uint8_t* src, uint8_t* dst, int* output_width)
+{
+    *dst = *src;
+    *output_width = 1;
+    return 1;
+}
+DEFINE_BATCH_PRINTER(binary_print_1)
+
+static int get_utf8_length(uint8_t ch)
+{
+    if((ch >> 5) == 0x06) return 2;
+    if((ch >> 4) == 0x0e) return 3;
+    if((ch >> 3) == 0x1e) return 4;
+    return 0;
+}
+
+// Every byte value as it appears in a C string: unchanged, as a named escape, or as a \\x escape.
+// UTF-8 lead bytes get a \\x escape here, for when their sequence is cut off.
+#define HEX_DIGIT_CHAR(VALUE) ((VALUE) < 10 ? '0' + (VALUE) : 'a' + (VALUE) - 10)
+#define NAMED_ESCAPE_CHAR(VALUE) ((VALUE) == 0x07 ? 'a' : (VALUE) == 0x08 ? 'b' : (VALUE) == 0x09 ? 't' : \
+                                  (VALUE) == 0x0a ? 'n' : (VALUE) == 0x0b ? 'v' : (VALUE) == 0x0c ? 'f' : \
+                                  (VALUE) == 0x0d ? 'r' : \
+                                  ((VALUE) == '\\' || (VALUE) == '\"' || (VALUE) == '?') ? (VALUE) : 0)
+#define IS_PLAIN_STRING_CHAR(VALUE) ((VALUE) >= 0x20 && (VALUE) < 0x7f && NAMED_ESCAPE_CHAR(VALUE) == 0)
+#define IS_SHORT_STRING_ESCAPE(VALUE) (IS_PLAIN_STRING_CHAR(VALUE) || NAMED_ESCAPE_CHAR(VALUE) != 0)
+#define STRING_ESCAPE(VALUE) \
+    {{IS_PLAIN_STRING_CHAR(VALUE) ? (VALUE) : '\\', \
+      IS_PLAIN_STRING_CHAR(VALUE) ? 0 : NAMED_ESCAPE_CHAR(VALUE) != 0 ? NAMED_ESCAPE_CHAR(VALUE) : 'x', \
+      IS_SHORT_STRING_ESCAPE(VALUE) ? 0 : (VALUE) < 16 ? HEX_DIGIT_CHAR(VALUE) : HEX_DIGIT_CHAR((VALUE) >> 4), \
+      IS_SHORT_STRING_ESCAPE(VALUE) || (VALUE) < 16 ? 0 : HEX_DIGIT_CHAR((VALUE) & 15)}, \
+     IS_PLAIN_STRING_CHAR(VALUE) ? 1 : NAMED_ESCAPE_CHAR(VALUE) != 0 ? 2 : (VALUE) < 16 ? 3 : 4},
+
+typedef struct
+{
+    // Always copied in full; only the first length characters count.
+    uint8_t chars[4];
+    int length;
+} string_escape;
+
+static const string_escape g_string_escapes[256] = { BYTE_TABLE_256(STRING_ESCAPE) };
+
+static int string_print_string(uint8_t* src, uint8_t* dst, int* output_width)
+{
+    uint8_t ch = *src;
+    int utf8_length = get_utf8_length(ch);
+    if(utf8_length > 0)
+    {
+        for(int i = 0; i < utf8_length; i++)
+        {
+            *dst++ = *src++;
+        }
+        *output_width = utf8_length;
+        return utf8_length;
+    }
+
+    memcpy(dst, g_string_escapes[ch].chars, sizeof(g_string_escapes[ch].chars));
+    *output_width = g_string_escapes[ch].length;
+    return 1;
+}
+
+// The most bytes that string_print_string() can write for one character.
+#define MAX_STRING_CHARACTER_LENGTH 4
+
+static inline bool is_plain_string_char(uint8_t ch)
+{
+    return IS_PLAIN_STRING_CHAR(ch);
+}
+
+static int copy_plain_string_run_scalar(const uint8_t* src, uint8_t* dst, int max_length)
+{
+    int i = 0;
+    while(i < max_length && is_plain_string_char(src[i]))
+    {
+        dst[i] = src[i];
+        i++;
+    }
+    return i;
+}
+
+#if BO_HAS_X86_SIMD
+BO_TARGET("sse2")
+static int copy_plain_string_run_sse2(const uint8_t* src, uint8_t* dst, int max_length)
+{
+    // Signed compare: bytes >= 0x80 are negative, so they fail the > 0x1f test along with control chars.
+    const __m128i below_printable = _mm_set1_epi8(0x1f);
+    const __m128i delete_char = _mm_set1_epi8(0x7f);
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i quote = _mm_set1_epi8('\"');
+    const __m128i question_mark = _mm_set1_epi8('?');
+    int i = 0;
+    for(; i + 16 <= max_length; i += 16)
+    {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(src + i));
+        // Store the whole block; anything past the run gets overwritten by whatever comes next.
+        _mm_storeu_si128((__m128i*)(dst + i), bytes);
+        __m128i special = _mm_or_si128(_mm_cmpeq_epi8(bytes, delete_char),
+                          _mm_or_si128(_mm_cmpeq_epi8(bytes, backslash),
+                          _mm_or_si128(_mm_cmpeq_epi8(bytes, quote),
+                                       _mm_cmpeq_epi8(bytes, question_mark))));
+        int mask = _mm_movemask_epi8(_mm_andnot_si128(special, _mm_cmpgt_epi8(bytes, below_printable))) ^ 0xffff;
+        if(mask != 0)
+        {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return i + copy_plain_string_run_scalar(src + i, dst + i, max_length - i);
+}
+#endif
+
+/**
+ * Copy the run of bytes that string_print_string() would pass through unchanged.
+ * Bytes past the end of the run (up to max_length) may also get written to dst.
+ *
+ * @param src The bytes to scan.
+ * @param dst Where to copy the run to.
+ * @param max_length The most bytes to scan and copy.
+ * @return The run length.
+ */
+static int copy_plain_string_run(const uint8_t* src, uint8_t* dst, int max_length)
+{
+#if BO_HAS_X86_SIMD
+    return copy_plain_string_run_sse2(src, dst, max_length);
+#else
+    return copy_plain_string_run_scalar(src, dst, max_length);
+#endif
+}
+
+/**
+ * Batch printer for strings.
+ * Runs of plain characters are copied over in one go, and everything else goes through
+ * string_print_string(). Every character is an entry, so the run copy only happens when
+ * there's no prefix or suffix.
+ *
+ * Unlike the other batch printers, this never reads past the end of the source. A UTF-8
+ * sequence that gets cut off is left for the next batch (flagging is_waiting_for_data), or
+ * escaped byte by byte at the end of the data.
+ *
+ * Produces the same output as running string_print_string() over each character.
+ */
+static int batch_print_string(uint8_t* src, int src_length, uint8_t* dst, int dst_capacity, entry_format* format, int* bytes_written)
+{
+    uint8_t* src_pos = src;
+    uint8_t* const src_end = src + src_length;
+    uint8_t* dst_pos = dst;
+    uint8_t* const dst_end = dst + dst_capacity;
+    const int max_entry_length = format->max_entry_length;
+    const bool has_separators = format->prefix_length + format->suffix_length > 0;
+
+    while(src_pos < src_end && dst_end - dst_pos >= max_entry_length)
+    {
+        if(!has_separators && is_plain_string_char(*src_pos))
+        {
+            int max_run_length = src_end - src_pos;
+            if(max_run_length > dst_end - dst_pos)
+            {
+                max_run_length = dst_end - dst_pos;
+            }
+            int run_length = copy_plain_string_run(src_pos, dst_pos, max_run_length);
+            src_pos += run_length;
+            dst_pos += run_length;
+            format->has_printed_entry = true;
+            continue;
+        }
+
+        int utf8_length = get_utf8_length(*src_pos);
+        bool is_truncated = utf8_length > src_end - src_pos;
+        if(is_truncated && !format->is_end_of_data)
+        {
+            format->is_waiting_for_data = true;
+            break;
+        }
+
+        if(has_separators)
+        {
+            if(format->has_printed_entry)
+            {
+                memcpy(dst_pos, format->suffix, format->suffix_length);
+                dst_pos += format->suffix_length;
+            }
+            memcpy(dst_pos, format->prefix, format->prefix_length);
+            dst_pos += format->prefix_length;
+        }
+
+        if(is_truncated)
+        {
+            const string_escape* escape = &g_string_escapes[*src_pos];
+            memcpy(dst_pos, escape->chars, sizeof(escape->chars));
+            dst_pos += escape->length;
+            src_pos++;
+        }
+        else
+        {
+            int output_width = 0;
+            src_pos += string_print_string(src_pos, dst_pos, &output_width);
+            dst_pos += output_width;
+        }
+        format->has_printed_entry = true;
+    }
+
+    *bytes_written = dst_pos - dst;
+    return src_pos - src;
+}
+
+// Hex dump entries are built from a template of [suffix][prefix][zero padding], followed by the digits.
+// The template is copied in fixed size chunks, so it must be at least this big.
+#define HEX_DUMP_TEMPLATE_COPY_SIZE 32
+
+// The number of bytes to expand into hex digits per pass.
+#define HEX_DUMP_BLOCK_SIZE 256
+
+static bool can_use_hex_dump(entry_format* format)
+{
+    int padding_length = format->text_width > 2 ? format->text_width - 2 : 0;
+    return format->suffix_length + format->prefix_length + padding_length <= HEX_DUMP_TEMPLATE_COPY_SIZE;
+}
+
+/**
+ * Batch printer for 1-byte hex values.
+ * Expands a block of bytes to hex digits at a time, then interleaves them with the prefix and suffix.
+ *
+ * Produces the same output as batch_string_print_hex_1().
+ */
+static int batch_print_hex_dump(uint8_t* src, int src_length, uint8_t* dst, int dst_capacity, entry_format* format, int* bytes_written)
+{
+    uint8_t* src_pos = src;
+    uint8_t* const src_end = src + src_length;
+    uint8_t* dst_pos = dst;
+    uint8_t* const dst_end = dst + dst_capacity;
+    const int text_width = format->text_width;
+    const int padding_length = text_width > 2 ? text_width - 2 : 0;
+    const bool is_fixed_width = text_width >= 2;
+    const int max_entry_length = format->max_entry_length;
+
+    uint8_t entry_template[HEX_DUMP_TEMPLATE_COPY_SIZE];
+    memcpy(entry_template, format->suffix, format->suffix_length);
+    memcpy(entry_template + format->suffix_length, format->prefix, format->prefix_length);
+    memset(entry_template + format->suffix_length + format->prefix_length, '0', padding_length);
+    const int head_length = format->suffix_length + format->prefix_length + padding_length;
+
+    if(!format->has_printed_entry && src_pos < src_end && dst_end - dst_pos >= max_entry_length)
+    {
+        memcpy(dst_pos, format->prefix, format->prefix_length);
+        dst_pos += format->prefix_length;
+        dst_pos += format_hex(*src_pos, dst_pos, text_width);
+        format->has_printed_entry = true;
+        src_pos++;
+    }
+
+    uint8_t digits[HEX_DUMP_BLOCK_SIZE * 2];
+    while(src_pos < src_end)
+    {
+        int count = src_end - src_pos;
+        if(count > HEX_DUMP_BLOCK_SIZE)
+        {
+            count = HEX_DUMP_BLOCK_SIZE;
+        }
+        // Leave room for the last template copy to overshoot.
+        int count_until_full = (dst_end - dst_pos - HEX_DUMP_TEMPLATE_COPY_SIZE) / max_entry_length;
+        if(count > count_until_full)
+        {
+            count = count_until_full;
+        }
+        if(count <= 0)
+        {
+            break;
+        }
+
+        if(head_length == 0 && is_fixed_width)
+        {
+            expand_hex_pairs(src_pos, count, dst_pos);
+            dst_pos += count * 2;
+        }
+        else
+        {
+            expand_hex_pairs(src_pos, count, digits);
+            for(int i = 0; i < count; i++)
+            {
+                memcpy(dst_pos, entry_template, HEX_DUMP_TEMPLATE_COPY_SIZE);
+                dst_pos += head_length;
+                // Without padding, values below 0x10 only take one digit.
+                bool is_short = !is_fixed_width && src_pos[i] < 0x10;
+                dst_pos[0] = digits[i * 2 + is_short];
+                dst_pos[1] = digits[i * 2 + 1];
+                dst_pos += 2 - is_short;
+            }
+        }
+        src_pos += count;
+    }
+
+    *bytes_written = dst_pos - dst;
+    return src_pos - src;
+}
+
+// There are only 65536 possible 2-byte floats, so their shortest strings get cached rather than
+// running Grisu on every entry. Each cache entry is a length followed by up to 15 characters.
+#define FLOAT_2_CACHE_ENTRY_SIZE 16
+#define FLOAT_2_CACHE_SIZE (65536 * FLOAT_2_CACHE_ENTRY_SIZE)
+// Entry lengths that aren't string lengths.
+#define FLOAT_2_CACHE_NOT_FILLED 0
+#define FLOAT_2_CACHE_TOO_LONG 0xff
+
+static inline int print_cached_float_2(uint16_t bits, uint8_t* dst, uint8_t* cache, int mantissa_bits, int exponent_bits)
+{
+    uint8_t* entry = cache + bits * FLOAT_2_CACHE_ENTRY_SIZE;
+    if(entry[0] == FLOAT_2_CACHE_NOT_FILLED)
+    {
+        uint8_t text[32];
+        int length = format_float_shortest(bits, mantissa_bits, exponent_bits, text);
+        if(length < FLOAT_2_CACHE_ENTRY_SIZE)
+        {
+            memcpy(entry + 1, text, length);
+            entry[0] = (uint8_t)length;
+        }
+        else
+        {
+            entry[0] = FLOAT_2_CACHE_TOO_LONG;
+        }
+    }
+    if(entry[0] == FLOAT_2_CACHE_TOO_LONG)
+    {
+        return format_float_shortest(bits, mantissa_bits, exponent_bits, dst);
+    }
+    memcpy(dst, entry + 1, FLOAT_2_CACHE_ENTRY_SIZE - 1);
+    return entry[0];
+}
+
+// Batch loop for the cached 2-byte float printers, laid out the same as print_entries().
+static inline __attribute__((always_inline)) int print_cached_float_2_entries(int mantissa_bits,
+                                                                            int exponent_bits,
+                                                                            bool is_swapped,
+                                                                            uint8_t* src,
+                                                                            int src_length,
+                                                                            uint8_t* dst,
+                                                                            int dst_capacity,
+                                                                            entry_format* format,
+                                                                            int* bytes_written)
+{
+    uint8_t* src_pos = src;
+    uint8_t* const src_end = src + src_length;
+    uint8_t* dst_pos = dst;
+    uint8_t* const dst_end = dst + dst_capacity;
+    uint8_t* const cache = format->float_2_cache;
+    const int max_entry_length = format->max_entry_length;
+    const int separator_length = format->suffix_length + format->prefix_length;
+    const bool can_copy_separator = separator_length <= ENTRY_SEPARATOR_COPY_SIZE;
+
+    while(src_pos < src_end && dst_end - dst_pos >= max_entry_length)
+    {
+        if(!format->has_printed_entry)
+        {
+            memcpy(dst_pos, format->prefix, format->prefix_length);
+            dst_pos += format->prefix_length;
+            format->has_printed_entry = true;
+        }
+        else if(can_copy_separator && dst_end - dst_pos >= max_entry_length + ENTRY_SEPARATOR_COPY_SIZE)
+        {
+            memcpy(dst_pos, format->separator, ENTRY_SEPARATOR_COPY_SIZE);
+            dst_pos += separator_length;
+        }
+        else
+        {
+            memcpy(dst_pos, format->suffix, format->suffix_length);
+            dst_pos += format->suffix_length;
+            memcpy(dst_pos, format->prefix, format->prefix_length);
+            dst_pos += format->prefix_length;
+        }
+
+        uint16_t bits;
+        memcpy(&bits, src_pos, sizeof(bits));
+        if(is_swapped)
+        {
+            bits = __builtin_bswap16(bits);
+        }
+        dst_pos += print_cached_float_2(bits, dst_pos, cache, mantissa_bits, exponent_bits);
+        src_pos += sizeof(bits);
+    }
+
+    *bytes_written = dst_pos - dst;
+    return src_pos - src;
+}
+
+#define DEFINE_CACHED_FLOAT_2_PRINTER(NAMED_TYPE, MANTISSA_BITS, EXPONENT_BITS) \
+static int batch_print_cached_ ## NAMED_TYPE ## _2 (uint8_t* src, int src_length, uint8_t* dst, int dst_capacity, entry_format* format, int* bytes_written) \
+{ \
+    return print_cached_float_2_entries(MANTISSA_BITS, EXPONENT_BITS, false, src, src_length, dst, dst_capacity, format, bytes_written); \
+} \
+static int batch_print_cached_ ## NAMED_TYPE ## _2_swapped (uint8_t* src, int src_length, uint8_t* dst, int dst_capacity, entry_format* format, int* bytes_written) \
+{ \
+    return print_cached_float_2_entries(MANTISSA_BITS, EXPONENT_BITS, true, src, src_length, dst, dst_capacity, format, bytes_written); \
+}
+DEFINE_CACHED_FLOAT_2_PRINTER(float, 10, 5)
+DEFINE_CACHED_FLOAT_2_PRINTER(bfloat, 7, 8)
+
+/**
+ * Get the 2-byte float string cache for the current output type, allocating it on first use.
+ *
+ * @return The cache, or NULL if it couldn't be allocated.
+ */
+static uint8_t* get_float_2_cache(bo_context* context)
+{
+    if(context->output.float_2_cache == NULL)
+    {
+        context->output.float_2_cache = calloc(1, FLOAT_2_CACHE_SIZE);
+    }
+    else if(context->output.float_2_cache_type != context->output.data_type)
+    {
+        memset(context->output.float_2_cache, 0, FLOAT_2_CACHE_SIZE);
+    }
+    context->output.float_2_cache_type = context->output.data_type;
+    return context->output.float_2_cache;
+}
+
+/**
+ * Fill in every entry of a 2-byte float string cache, so that printing from it never writes to it.
+ */
+static void fill_float_2_cache(uint8_t* cache, bo_data_type data_type)
+{
+    const int mantissa_bits = data_type == TYPE_BFLOAT ? 7 : 10;
+    const int exponent_bits = data_type == TYPE_BFLOAT ? 8 : 5;
+    uint8_t text[64];
+    for(int bits = 0; bits <= 0xffff; bits++)
+    {
+        print_cached_float_2(bits, text, cache, mantissa_bits, exponent_bits);
+    }
+}
+
+bool matches_endianness(bo_context* context)
+{
+    return context->output.endianness == BO_NATIVE_INT_ENDIANNESS;
+}
+
+bool matches_float_endianness(bo_context* context)
+{
+    return context->output.endianness == BO_NATIVE_FLOAT_ENDIANNESS;
+}
+
+bool is_output_bigendian(bo_context* context)
+{
+    return context->output.endianness == BO_ENDIAN_BIG;
+}
+
+/**
+ * Get the most bytes that the string printer for the current output type can write for a single entry.
+ */
+static int get_max_text_length(bo_context* context)
+{
+    const int data_width = context->output.data_width;
+    const int text_width = context->output.text_width;
+    int length = 0;
+    switch(context->output.data_type)
+    {
+        case TYPE_INT:
+            // Sign, plus log10(2^bits) digits.
+            length = 1 + (data_width * 2408 + 999) / 1000;
+            break;
+        case TYPE_HEX:
+            length = data_width * 2;
+            break;
+        case TYPE_OCTAL:
+            length = (data_width * 8 + 2) / 3;
+            break;
+        case TYPE_BOOLEAN:
+            length = data_width * 8;
+            break;
+        case TYPE_FLOAT:
+        case TYPE_BFLOAT:
+            if(text_width < 0)
+            {
+                length = data_width <= 8 ? 32 : 48;
+                break;
+            }
+            // Sign, integral digits of the largest value, decimal point, precision digits,
+            // and the terminator that the libc fallback writes.
+            length = 1 + (data_width <= 4 ? 39 : data_width <= 8 ? 309 : 4933) + 1 + text_width + 1;
+            break;
+        case TYPE_DECIMAL:
+            if(text_width < 0)
+            {
+                // Sign, 34 digits, and either a decimal point and exponent or up to 6 leading zeros.
+                length = 48;
+                break;
+            }
+            // Sign, coefficient digits plus the largest exponent, a digit of rounding carry,
+            // decimal point, precision digits.
+            length = 1 + (data_width <= 4 ? 97 : data_width <= 8 ? 385 : 6145) + 1 + 1 + text_width;
+            break;
+        case TYPE_BINARY:
+            length = data_width;
+            break;
+        case TYPE_STRING:
+            // An escape sequence such as \xff, or a 4 byte UTF-8 character.
+            length = 4;
+            break;
+        default:
+            break;
+    }
+    return length > text_width ? length : text_width;
+}
+
+static entry_format get_entry_format(bo_context* context)
+{
+    const char* prefix = context->output.prefix == NULL ? "" : context->output.prefix;
+    const char* suffix = context->output.suffix == NULL ? "" : context->output.suffix;
+    entry_format format =
+    {
+        .prefix = (const uint8_t*)prefix,
+        .suffix = (const uint8_t*)suffix,
+        .prefix_length = strlen(prefix),
+        .suffix_length = strlen(suffix),
+        .text_width = context->output.text_width,
+        .has_printed_entry = context->output.has_printed_entry,
+    };
+    if(format.suffix_length + format.prefix_length <= ENTRY_SEPARATOR_COPY_SIZE)
+    {
+        memcpy(format.separator, suffix, format.suffix_length);
+        memcpy(format.separator + format.suffix_length, prefix, format.prefix_length);
+    }
+    format.max_entry_length = format.prefix_length + format.suffix_length + get_max_text_length(context);
+    return format;
+}
+
+static batch_printer get_batch_printer(bo_context* context, entry_format* format)
+{
+    switch(context->output.data_type)
+    {
+        case TYPE_INT:
+        {
+            switch(context->output.data_width)
+            {
+                case 1: return batch_string_print_int_1;
+                case 2: return matches_endianness(context) ? batch_string_print_int_2 : batch_string_print_int_2_swapped;
+                case 4: return matches_endianness(context) ? batch_string_print_int_4 : batch_string_print_int_4_swapped;
+                case 8: return matches_endianness(context) ? batch_string_print_int_8 : batch_string_print_int_8_swapped;
+                case 16: return matches_endianness(context) ? batch_string_print_int_16 : batch_string_print_int_16_swapped;
+                default:
+                    bo_notify_error(context, "%d: invalid data width", context->output.data_width);
+                    return NULL;
+            }
+        }
+        case TYPE_HEX:
+        {
+            switch(context->output.data_width)
+            {
+                case 1: return can_use_hex_dump(format) ? batch_print_hex_dump : batch_string_print_hex_1;
+                case 2: return matches_endianness(context) ? batch_string_print_hex_2 : batch_string_print_hex_2_swapped;
+                case 4: return matches_endianness(context) ? batch_string_print_hex_4 : batch_string_print_hex_4_swapped;
+                case 8: return matches_endianness(context) ? batch_string_print_hex_8 : batch_string_print_hex_8_swapped;
+                case 16: return matches_endianness(context) ? batch_string_print_hex_16 : batch_string_print_hex_16_swapped;
+                default:
+                    bo_notify_error(context, "%d: invalid data width", context->output.data_width);
+                    return NULL;
+            }
+        }
+        case TYPE_OCTAL:
+        {
+            switch(context->output.data_width)
+            {
+                case 1: return batch_string_print_octal_1;
+                case 2: return matches_endianness(context) ? batch_string_print_octal_2 : batch_string_print_octal_2_swapped;
+                case 4: return matches_endianness(context) ? batch_string_print_octal_4 : batch_string_print_octal_4_swapped;
+                case 8: return matches_endianness(context) ? batch_string_print_octal_8 : batch_string_print_octal_8_swapped;
+                case 16: return matches_endianness(context) ? batch_string_print_octal_16 : batch_string_print_octal_16_swapped;
+                default:
+                    bo_notify_error(context, "%d: invalid data width", context->output.data_width);
+                    return NULL;
+            }
+        }
+        case TYPE_BOOLEAN:
+        {
+            switch(context->output.data_width)
+            {
+                case 1: return is_output_bigendian(context) ? batch_string_print_boolean_1_be : batch_string_print_boolean_1_le;
+                case 2: return is_output_bigendian(context) ? batch_string_print_boolean_2_be : batch_string_print_boolean_2_le;
+                case 4: return is_output_bigendian(context) ? batch_string_print_boolean_4_be : batch_string_print_boolean_4_le;
+                case 8: return is_output_bigendian(context) ? batch_string_print_boolean_8_be : batch_string_print_boolean_8_le;
+                case 16: return is_output_bigendian(context) ? batch_string_print_boolean_16_be : batch_string_print_boolean_16_le;
+                default:
+                    bo_notify_error(context, "%d: invalid data width", context->output.data_width);
+                    return NULL;
+            }
+        }
+        case TYPE_FLOAT:
+        {
+            switch(context->output.data_width)
+            {
+                case 2:
+                    if(format->text_width < 0 && (format->float_2_cache = get_float_2_cache(context)) != NULL)
+                    {
+                        return matches_float_endianness(context) ? batch_print_cached_float_2 : batch_print_cached_float_2_swapped;
+                    }
+                    return matches_float_endianness(context) ? batch_string_print_float_2 : batch_string_print_float_2_swapped;
+                case 4: return matches_float_endianness(context) ? batch_string_print_float_4 : batch_string_print_float_4_swapped;
+                case 8: return matches_float_endianness(context) ? batch_string_print_float_8 : batch_string_print_float_8_swapped;
+#if BO_HAS_QUADMATH
+                case 16: return matches_float_endianness(context) ? batch_string_print_float_16 : batch_string_print_float_16_swapped;
+#else
+                case 16:
+                    bo_notify_error(context, "Float width 16 is not supported on this platform");
+                    return NULL;
+#endif
+                default:
+                    bo_notify_error(context, "%d: invalid data width", context->output.data_width);
+                    return NULL;
+            }
+        }
+        case TYPE_BFLOAT:
+            if(format->text_width < 0 && (format->float_2_cache = get_float_2_cache(context)) != NULL)
+            {
+                return matches_float_endianness(context) ? batch_print_cached_bfloat_2 : batch_print_cached_bfloat_2_swapped;
+            }
+            return matches_float_endianness(context) ? batch_string_print_bfloat_2 : batch_string_print_bfloat_2_swapped;
+        case TYPE_DECIMAL:
+        {
+            switch(context->output.data_width)
+            {
+                case 4: return matches_endianness(context) ? batch_string_print_decimal_4 : batch_string_print_decimal_4_swapped;
+                case 8: return matches_endianness(context) ? batch_string_print_decimal_8 : batch_string_print_decimal_8_swapped;
+                case 16: return matches_endianness(context) ? batch_string_print_decimal_16 : batch_string_print_decimal_16_swapped;
+                default:
+                    bo_notify_error(context, "%d: invalid data width", context->output.data_width);
+                    return NULL;
+            }
+        }
+        case TYPE_BINARY:
+            switch(context->output.data_width)
+            {
+                case 1: return batch_binary_print_1;
+                case 2: return matches_endianness(context) ? batch_binary_print_2 : batch_binary_print_2_swapped;
+                case 4: return matches_endianness(context) ? batch_binary_print_4 : batch_binary_print_4_swapped;
+                case 8: return matches_endianness(context) ? batch_binary_print_8 : batch_binary_print_8_swapped;
+                case 16: return matches_endianness(context) ? batch_binary_print_16 : batch_binary_print_16_swapped;
+                default:
+                    bo_notify_error(context, "%d: invalid data width", context->output.data_width);
+                    return NULL;
+            }
+        case TYPE_STRING:
+            return batch_print_string;
+        case TYPE_NONE:
+            bo_notify_error(context, "Must set output data type before passing data");
+            return NULL;
+        default:
+            bo_notify_error(context, "%d: Unknown data type", context->output.data_type);
+            return NULL;
+    }
+}
+
+
+
+// --------
+// Internal
+// --------
+
+static inline bool is_nonempty_string(const char* const string)
+{
+    return string != NULL && *string != 0;
+}
+
+static inline bool check_can_input_numbers(bo_context* context, const uint8_t* string_value, int length)
+{
+    if(context->input.data_type == TYPE_NONE || context->input.data_type == TYPE_STRING)
+    {
+        bo_notify_error(context, "%.*s: Must set input type to numeric before adding numbers", length, (const char*)string_value);
+        return false;
+    }
+    return true;
+}
+
+static int trim_length_to_object_boundary(int length, int object_size_in_bytes)
+{
+    return length - (length % object_size_in_bytes);
+}
+
+static void clear_error_condition(bo_context* context)
+{
+    context->is_error_condition = false;
+}
+
+static inline bool is_last_data_segment(bo_context* context)
+{
+    return context->data_segment_type == DATA_SEGMENT_LAST;
+}
+
+/**
+ * A compiled program: a context's configuration after running the commands, with the output format
+ * already resolved. Contexts that run the program start out as a copy of this one, so the program
+ * is never modified once compiled.
+ */
+typedef struct bo_program
+{
+    bo_context context;
+} bo_program;
+
+/**
+ * Free a prefix or suffix string, unless it belongs to the program that the context is running.
+ */
+static void free_output_string(bo_context* context, const char* string)
+{
+    const bo_program* program = context->program;
+    if(program != NULL && (string == program->context.output.prefix || string == program->context.output.suffix))
+    {
+        return;
+    }
+    free((void*)string);
 }
 
 
@@ -483,300 +2651,1836 @@ static void clear_error_condition(bo_context* context)
 // Buffer Flushing
 // ---------------
 
-static void flush_buffer_to_output(bo_context* context, bo_buffer* buffer)
+static inline bool is_pulling_output(bo_context* context)
+{
+    return context->pull.is_active;
+}
+
+/**
+ * Make room in the output buffer while output is being pulled by bo_process_into().
+ * When the caller's buffer fills, output moves to the context's own buffer, which grows as needed.
+ */
+static void make_room_for_pulled_output(bo_context* context)
+{
+    if(!context->pull.is_overflowing)
+    {
+        context->pull.caller_buffer = context->output_buffer;
+        context->output_buffer = context->pull.own_buffer;
+        context->pull.is_overflowing = true;
+        return;
+    }
+    if(!buffer_grow(&context->output_buffer))
+    {
+        bo_notify_error(context, "Could not allocate memory for output");
+    }
+}
+
+static void flush_bytes_to_output(bo_context* context, const uint8_t* data, int length)
+{
+    if(is_pulling_output(context))
+    {
+        bo_buffer* output_buffer = &context->output_buffer;
+        while(length > buffer_get_remaining(output_buffer))
+        {
+            int fit_length = buffer_get_remaining(output_buffer);
+            buffer_append_bytes(output_buffer, data, fit_length);
+            data += fit_length;
+            length -= fit_length;
+            make_room_for_pulled_output(context);
+            if(is_error_condition(context))
+            {
+                return;
+            }
+        }
+        buffer_append_bytes(output_buffer, data, length);
+        return;
+    }
+
+    if(context->on_output == NULL)
+    {
+        if(length > 0)
+        {
+            bo_notify_error(context, "No output callback to receive output");
+        }
+        return;
+    }
+    if(!context->on_output(context->user_data, (char*)data, length))
+    {
+        mark_error_condition(context);
+    }
+}
+
+static void flush_buffer_to_output(bo_context* context, bo_buffer* buffer)
+{
+    flush_bytes_to_output(context, buffer_get_start(buffer), buffer_get_used(buffer));
+    buffer_clear(buffer);
+}
+
+static void flush_output_buffer(bo_context* context)
+{
+    LOG("Flush output buffer");
+    if(is_pulling_output(context))
+    {
+        make_room_for_pulled_output(context);
+        return;
+    }
+    flush_buffer_to_output(context, &context->output_buffer);
+}
+
+/**
+ * Move the output to a buffer big enough for the largest entry, so that small output buffers still work
+ * with wide output types. The high water mark stays where it was.
+ */
+static void fit_output_buffer_to_entry(bo_context* context, int max_entry_length)
+{
+    bo_buffer* output_buffer = &context->output_buffer;
+    bo_buffer larger_buffer = buffer_alloc(max_entry_length + OUTPUT_BUFFER_OVERHEAD_SIZE,
+                                           output_buffer->high_water - buffer_get_start(output_buffer),
+                                           context->buffer_alignment);
+    if(!buffer_is_initialized(&larger_buffer))
+    {
+        bo_notify_error(context, "Could not allocate memory for output");
+        return;
+    }
+    buffer_append_bytes(&larger_buffer, buffer_get_start(output_buffer), buffer_get_used(output_buffer));
+    if(!context->is_output_buffer_borrowed)
+    {
+        buffer_free(output_buffer);
+    }
+    *output_buffer = larger_buffer;
+    context->is_output_buffer_borrowed = false;
+}
+
+static void flush_work_buffer_binary(bo_context* context, bool is_complete_flush)
+{
+    bo_buffer* work_buffer = &context->work_buffer;
+    const int width = context->output.data_width;
+    if(width <= 1 || matches_endianness(context))
+    {
+        flush_buffer_to_output(context, work_buffer);
+        return;
+    }
+
+    int length = buffer_get_used(work_buffer);
+    if(is_complete_flush)
+    {
+        // Zero-fill the partial entry at the end, like the string printers do.
+        memset(buffer_get_position(work_buffer), 0, 16);
+        length = trim_length_to_object_boundary(length + width - 1, width);
+    }
+    else
+    {
+        length = trim_length_to_object_boundary(length, width);
+    }
+
+    if(length == 0)
+    {
+        return;
+    }
+
+    uint8_t* start = buffer_get_start(work_buffer);
+    swap_block(start, start, length, width);
+    flush_bytes_to_output(context, start, length);
+    buffer_consume(work_buffer, length);
+}
+
+static void flush_work_buffer(bo_context* context, bool is_complete_flush)
+{
+    LOG("Flush work buffer");
+    if(!buffer_is_initialized(&context->work_buffer) || buffer_is_empty(&context->work_buffer))
+    {
+        return;
+    }
+
+    if(context->output.data_type == TYPE_BINARY)
+    {
+        flush_work_buffer_binary(context, is_complete_flush);
+        return;
+    }
+
+    bo_buffer* work_buffer = &context->work_buffer;
+    bo_buffer* output_buffer = &context->output_buffer;
+
+    if(context->output.print_batch == NULL)
+    {
+        context->output.format = get_entry_format(context);
+        context->output.print_batch = get_batch_printer(context, &context->output.format);
+    }
+    if(is_error_condition(context))
+    {
+        return;
+    }
+    batch_printer print_batch = context->output.print_batch;
+    entry_format format = context->output.format;
+    format.has_printed_entry = context->output.has_printed_entry;
+    format.is_end_of_data = is_complete_flush;
+
+    // When pulling output, the overflow buffer grows to fit.
+    if(format.max_entry_length > buffer_get_end(output_buffer) - buffer_get_start(output_buffer) && !is_pulling_output(context))
+    {
+        fit_output_buffer_to_entry(context, format.max_entry_length);
+        if(is_error_condition(context))
+        {
+            return;
+        }
+    }
+
+    int bytes_per_entry = context->output.data_width;
+    int work_length = buffer_get_used(work_buffer);
+    if(is_complete_flush)
+    {
+        // Ensure that the partial read at the end gets zeroes instead of random garbage.
+        // WORK_BUFFER_OVERHEAD_SIZE makes sure this call doesn't run off the end of the buffer.
+        memset(buffer_get_position(work_buffer), 0, 16);
+    }
+    else
+    {
+        work_length = trim_length_to_object_boundary(work_length, bytes_per_entry);
+    }
+
+    uint8_t* src = buffer_get_start(work_buffer);
+    uint8_t* const end = src + work_length;
+    while(src < end)
+    {
+        int bytes_written = 0;
+        src += print_batch(src,
+                           end - src,
+                           buffer_get_position(output_buffer),
+                           buffer_get_remaining(output_buffer),
+                           &format,
+                           &bytes_written);
+        buffer_use_space(output_buffer, bytes_written);
+        context->output.has_printed_entry = format.has_printed_entry;
+
+        // The rest of the entry is still on its way, so leave it in the work buffer.
+        if(format.is_waiting_for_data)
+        {
+            break;
+        }
+
+        // Otherwise the batch only stops early when the output buffer is full.
+        if(src < end)
+        {
+            flush_output_buffer(context);
+            if(is_error_condition(context))
+            {
+                return;
+            }
+        }
+    }
+
+    if(buffer_is_high_water(output_buffer) && !is_pulling_output(context))
+    {
+        flush_output_buffer(context);
+    }
+    buffer_consume(work_buffer, is_complete_flush ? buffer_get_used(work_buffer) : src - buffer_get_start(work_buffer));
+}
+
+
+
+// ------------------
+// Binary Data Adders
+// ------------------
+
+/**
+ * Get the space left for data in the work buffer. The overhead past the end of the work buffer
+ * proper is left free for zero filling, even when a failed flush leaves the buffer full.
+ */
+static inline int get_work_buffer_space(bo_context* context)
+{
+    int space = buffer_get_remaining(&context->work_buffer) - WORK_BUFFER_OVERHEAD_SIZE;
+    return space > 0 ? space : 0;
+}
+
+static void add_bytes(bo_context* context, const uint8_t* ptr, int length)
+{
+    if(buffer_is_high_water(&context->work_buffer))
+    {
+        flush_work_buffer(context, false);
+    }
+
+    do
+    {
+        int copy_length = get_work_buffer_space(context);
+        if(copy_length > length)
+        {
+            copy_length = length;
+        }
+        buffer_append_bytes(&context->work_buffer, ptr, copy_length);
+        if(buffer_is_high_water(&context->work_buffer))
+        {
+    	    flush_work_buffer(context, false);
+        }
+        if(is_error_condition(context))
+	    {
+	    	return;
+	    }
+        length -= copy_length;
+        ptr += copy_length;
+    } while(length > 0);
+}
+
+static void add_partial_element_swapped(bo_context* context)
+{
+    const int width = context->input.data_width;
+    uint8_t bytes[16] = {0};
+    memcpy(bytes, context->input.partial_element, context->input.partial_element_length);
+    copy_swapped(buffer_get_position(&context->work_buffer), bytes, width);
+    buffer_use_space(&context->work_buffer, width);
+    context->input.partial_element_length = 0;
+}
+
+/**
+ * Add bytes from a stream of elements that need to be byte swapped.
+ *
+ * An element that is cut off at the end of the data is kept until the rest of it arrives
+ * in the next call. If this is the last data segment, it gets zero-filled and added instead.
+ */
+static void add_bytes_swapped(bo_context* context, const uint8_t* ptr, int length, const int width)
+{
+    bo_buffer* work_buffer = &context->work_buffer;
+    if(buffer_is_high_water(work_buffer))
+    {
+        flush_work_buffer(context, false);
+    }
+
+    if(context->input.partial_element_length > 0)
+    {
+        int fill_length = width - context->input.partial_element_length;
+        if(fill_length > length)
+        {
+            fill_length = length;
+        }
+        memcpy(context->input.partial_element + context->input.partial_element_length, ptr, fill_length);
+        context->input.partial_element_length += fill_length;
+        ptr += fill_length;
+        length -= fill_length;
+        if(context->input.partial_element_length == width)
+        {
+            add_partial_element_swapped(context);
+        }
+    }
+
+    const uint8_t* const whole_elements_end = ptr + trim_length_to_object_boundary(length, width);
+    while(ptr < whole_elements_end)
+    {
+        if(buffer_is_high_water(work_buffer))
+        {
+            flush_work_buffer(context, false);
+        }
+        if(is_error_condition(context))
+        {
+            return;
+        }
+        int copy_length = trim_length_to_object_boundary(get_work_buffer_space(context), width);
+        if(copy_length > whole_elements_end - ptr)
+        {
+            copy_length = whole_elements_end - ptr;
+        }
+        swap_block(buffer_get_position(work_buffer), ptr, copy_length, width);
+        buffer_use_space(work_buffer, copy_length);
+        ptr += copy_length;
+    }
+
+    int remainder = length % width;
+    if(remainder > 0)
+    {
+        memcpy(context->input.partial_element + context->input.partial_element_length, ptr, remainder);
+        context->input.partial_element_length += remainder;
+    }
+    if(context->input.partial_element_length > 0 && is_last_data_segment(context))
+    {
+        if(buffer_is_high_water(work_buffer))
+        {
+            flush_work_buffer(context, false);
+        }
+        add_partial_element_swapped(context);
+    }
+}
+
+static void add_int_16(bo_context* context, unsigned __int128 value)
+{
+    if(context->input.endianness != BO_NATIVE_INT_ENDIANNESS)
+    {
+        uint8_t buff[sizeof(value)];
+        copy_swapped(buff, (uint8_t*)&value, sizeof(value));
+        add_bytes(context, buff, sizeof(value));
+        return;
+    }
+    add_bytes(context, (uint8_t*)&value, sizeof(value));
+}
+
+static void add_int(bo_context* context, uint64_t src_value)
+{
+    switch(context->input.data_width)
+    {
+        case WIDTH_1:
+        {
+            uint8_t value = (uint8_t)src_value;
+            add_bytes(context, (uint8_t*)&value, sizeof(value));
+            return;
+        }
+        case WIDTH_2:
+        {
+            uint16_t value = (uint16_t)src_value;
+            if(context->input.endianness != BO_NATIVE_INT_ENDIANNESS)
+            {
+            	uint8_t buff[sizeof(value)];
+            	copy_swapped(buff, (uint8_t*)&value, sizeof(value));
+	            add_bytes(context, buff, sizeof(value));
+                return;
+            }
+            add_bytes(context, (uint8_t*)&value, sizeof(value));
+            return;
+        }
+        case WIDTH_4:
+        {
+            uint32_t value = (uint32_t)src_value;
+            if(context->input.endianness != BO_NATIVE_INT_ENDIANNESS)
+            {
+            	uint8_t buff[sizeof(value)];
+            	copy_swapped(buff, (uint8_t*)&value, sizeof(value));
+	            add_bytes(context, buff, sizeof(value));
+                return;
+            }
+            add_bytes(context, (uint8_t*)&value, sizeof(value));
+            return;
+        }
+        case WIDTH_8:
+        {
+            uint64_t value = (uint64_t)src_value;
+            if(context->input.endianness != BO_NATIVE_INT_ENDIANNESS)
+            {
+            	uint8_t buff[sizeof(value)];
+            	copy_swapped(buff, (uint8_t*)&value, sizeof(value));
+	            add_bytes(context, buff, sizeof(value));
+                return;
+            }
+            add_bytes(context, (uint8_t*)&value, sizeof(value));
+            return;
+        }
+        case WIDTH_16:
+            add_int_16(context, src_value);
+            return;
+        default:
+		    bo_notify_error(context, "$d: Invalid int width", context->input.data_width);
+		    return;
+    }
+}
+
+static void add_float(bo_context* context, double src_value)
+{
+    switch(context->input.data_width)
+    {
+        case WIDTH_4:
+        {
+            float value = (float)src_value;
+            if(context->input.endianness != BO_NATIVE_INT_ENDIANNESS)
+            {
+            	uint8_t buff[sizeof(value)];
+            	copy_swapped(buff, (uint8_t*)&value, sizeof(value));
+	            add_bytes(context, buff, sizeof(value));
+                return;
+            }
+            add_bytes(context, (uint8_t*)&value, sizeof(value));
+            return;
+        }
+        case WIDTH_8:
+        {
+            double value = (double)src_value;
+            if(context->input.endianness != BO_NATIVE_INT_ENDIANNESS)
+            {
+            	uint8_t buff[sizeof(value)];
+            	copy_swapped(buff, (uint8_t*)&value, sizeof(value));
+	            add_bytes(context, buff, sizeof(value));
+                return;
+            }
+            add_bytes(context, (uint8_t*)&value, sizeof(value));
+            return;
+        }
+        case WIDTH_2:
+        case WIDTH_16:
+            // The text goes straight to the 2 and 16 byte encoders so that it only gets rounded once.
+		    bo_notify_error(context, "%d: Invalid float width", context->input.data_width);
+		    return;
+        default:
+		    bo_notify_error(context, "%d: Invalid float width", context->input.data_width);
+		    return;
+    }
+}
+
+#if BO_HAS_QUADMATH
+static void add_float_16(bo_context* context, __float128 value)
+{
+    if(context->input.endianness != BO_NATIVE_INT_ENDIANNESS)
+    {
+        uint8_t buff[sizeof(value)];
+        copy_swapped(buff, (uint8_t*)&value, sizeof(value));
+        add_bytes(context, buff, sizeof(value));
+        return;
+    }
+    add_bytes(context, (uint8_t*)&value, sizeof(value));
+}
+#endif
+
+static void add_binary_bytes(bo_context* context, const uint8_t* ptr, int length)
+{
+    if(context->input.data_width > 1 && context->input.endianness != BO_NATIVE_INT_ENDIANNESS)
+    {
+        add_bytes_swapped(context, ptr, length, context->input.data_width);
+        return;
+    }
+    add_bytes(context, ptr, length);
+}
+
+static inline int get_input_swap_width(bo_context* context)
+{
+    const int width = context->input.data_width;
+    return width > 1 && context->input.endianness != BO_NATIVE_INT_ENDIANNESS ? width : 0;
+}
+
+static inline int get_output_swap_width(bo_context* context)
+{
+    const int width = context->output.data_width;
+    return width > 1 && !matches_endianness(context) ? width : 0;
+}
+
+/**
+ * Byte swap element aligned data into the output buffer, flushing it as it fills.
+ */
+static void flush_swapped_bytes_to_output(bo_context* context, const uint8_t* data, int length, int width)
+{
+    bo_buffer* output_buffer = &context->output_buffer;
+    while(length > 0)
+    {
+        int chunk_length = trim_length_to_object_boundary(buffer_get_remaining(output_buffer), width);
+        if(chunk_length == 0)
+        {
+            flush_output_buffer(context);
+            if(is_error_condition(context))
+            {
+                return;
+            }
+            continue;
+        }
+        if(chunk_length > length)
+        {
+            chunk_length = length;
+        }
+        swap_block(buffer_get_position(output_buffer), data, chunk_length, width);
+        buffer_use_space(output_buffer, chunk_length);
+        data += chunk_length;
+        length -= chunk_length;
+    }
+    if(!is_pulling_output(context))
+    {
+        flush_output_buffer(context);
+    }
+}
+
+/**
+ * Add binary data that is going straight to binary output.
+ *
+ * If the conversion is a no-op, the data is passed directly to the output callback rather than
+ * going through the work buffer. If it's a single byte swap, the data is swapped straight into the
+ * output buffer. The data itself is never modified.
+ * Partial elements at either end still go through the work buffer.
+ */
+static void add_bytes_passthrough(bo_context* context, const uint8_t* data, int length)
+{
+    const int input_swap_width = get_input_swap_width(context);
+    const int output_swap_width = get_output_swap_width(context);
+    if(input_swap_width > 0 && output_swap_width > 0 && input_swap_width != output_swap_width)
+    {
+        // Two different swaps can't be done in one pass.
+        add_binary_bytes(context, data, length);
+        return;
+    }
+
+    // Swapping on both input and output with the same width cancels out.
+    const int swap_width = input_swap_width == output_swap_width ? 0 : input_swap_width + output_swap_width;
+    const int element_width = input_swap_width > output_swap_width ? input_swap_width : output_swap_width;
+
+    flush_work_buffer(context, false);
+    if(!buffer_is_empty(&context->output_buffer) && !is_pulling_output(context))
+    {
+        flush_output_buffer(context);
+    }
+    if(is_error_condition(context))
+    {
+        return;
+    }
+
+    // Complete any element left over from last time, so that the rest of the data is element aligned.
+    int pending_length = buffer_get_used(&context->work_buffer) + context->input.partial_element_length;
+    if(pending_length > 0 && element_width > 0)
+    {
+        int fill_length = element_width - pending_length % element_width;
+        if(fill_length > length)
+        {
+            fill_length = length;
+        }
+        add_binary_bytes(context, data, fill_length);
+        flush_work_buffer(context, false);
+        if(is_error_condition(context))
+        {
+            return;
+        }
+        data += fill_length;
+        length -= fill_length;
+    }
+
+    const int direct_length = element_width > 0 ? trim_length_to_object_boundary(length, element_width) : length;
+    if(direct_length > 0)
+    {
+        if(swap_width > 0)
+        {
+            flush_swapped_bytes_to_output(context, data, direct_length, swap_width);
+        }
+        else
+        {
+            flush_bytes_to_output(context, data, direct_length);
+        }
+        if(is_error_condition(context))
+        {
+            return;
+        }
+    }
+
+    if(direct_length < length)
+    {
+        add_binary_bytes(context, data + direct_length, length - direct_length);
+    }
+}
+
+
+
+// -------------
+// Hex Byte Runs
+// -------------
+
+// Long runs of 1-byte hex values ("de ad be ef ...") are decoded straight into the work buffer,
+// rather than going through the parser one token at a time. The common layout of two digits and
+// one whitespace character per byte is decoded 16 bytes (48 characters) at a time. Anything else
+// is handled one token at a time, and anything that isn't a plain 1 or 2 digit token ends the run.
+
+#define HEX_TRIPLETS_PER_BLOCK 16
+
+static inline int get_hex_digit_value(uint8_t ch)
+{
+    if((uint8_t)(ch - '0') <= 9)
+    {
+        return ch - '0';
+    }
+    if((uint8_t)((ch | 0x20) - 'a') <= 5)
+    {
+        return (ch | 0x20) - 'a' + 10;
+    }
+    return -1;
+}
+
+static inline bool is_token_separator(uint8_t ch)
+{
+    return ch == ' ' || (uint8_t)(ch - '\t') <= '\r' - '\t';
+}
+
+static int decode_hex_triplets_scalar(const uint8_t* src, int count, uint8_t* dst)
+{
+    int i = 0;
+    for(; i < count; i++)
+    {
+        const int high = get_hex_digit_value(src[i * 3]);
+        const int low = get_hex_digit_value(src[i * 3 + 1]);
+        if(high < 0 || low < 0 || !is_token_separator(src[i * 3 + 2]))
+        {
+            break;
+        }
+        dst[i] = (uint8_t)((high << 4) | low);
+    }
+    return i;
+}
+
+#if BO_HAS_X86_SIMD
+// Gather the first (high) and second (low) digit of each triplet out of the three 16 byte
+// vectors that 16 triplets span. -1 selects nothing.
+#define HEX_TRIPLET_HIGH_0 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+#define HEX_TRIPLET_HIGH_1 -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1
+#define HEX_TRIPLET_HIGH_2 -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13
+#define HEX_TRIPLET_LOW_0  1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+#define HEX_TRIPLET_LOW_1  -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1
+#define HEX_TRIPLET_LOW_2  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14
+// Where the separators fall in each of the three vectors.
+#define HEX_TRIPLET_SEPARATORS_0 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0
+#define HEX_TRIPLET_SEPARATORS_1 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0
+#define HEX_TRIPLET_SEPARATORS_2 -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1
+
+/**
+ * Get the digit values of a vector of triplet characters.
+ *
+ * @return A mask of the characters that are valid: hex digits, or whitespace where a separator goes.
+ */
+BO_TARGET("ssse3")
+static inline __m128i classify_hex_triplets_ssse3(__m128i chars, __m128i separators, __m128i* values)
+{
+    const __m128i digit_value = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+    const __m128i letter_value = _mm_sub_epi8(_mm_or_si128(chars, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    const __m128i control_value = _mm_sub_epi8(chars, _mm_set1_epi8('\t'));
+    const __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digit_value, _mm_set1_epi8(9)), digit_value);
+    const __m128i is_letter = _mm_cmpeq_epi8(_mm_min_epu8(letter_value, _mm_set1_epi8(5)), letter_value);
+    const __m128i is_separator = _mm_or_si128(_mm_cmpeq_epi8(chars, _mm_set1_epi8(' ')),
+        _mm_cmpeq_epi8(_mm_min_epu8(control_value, _mm_set1_epi8('\r' - '\t')), control_value));
+    *values = _mm_or_si128(_mm_and_si128(digit_value, is_digit),
+                           _mm_and_si128(_mm_add_epi8(letter_value, _mm_set1_epi8(10)), is_letter));
+    return _mm_or_si128(_mm_and_si128(is_separator, separators),
+                        _mm_andnot_si128(separators, _mm_or_si128(is_digit, is_letter)));
+}
+
+BO_TARGET("avx2")
+static inline __m256i classify_hex_triplets_avx2(__m256i chars, __m256i separators, __m256i* values)
+{
+    const __m256i digit_value = _mm256_sub_epi8(chars, _mm256_set1_epi8('0'));
+    const __m256i letter_value = _mm256_sub_epi8(_mm256_or_si256(chars, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+    const __m256i control_value = _mm256_sub_epi8(chars, _mm256_set1_epi8('\t'));
+    const __m256i is_digit = _mm256_cmpeq_epi8(_mm256_min_epu8(digit_value, _mm256_set1_epi8(9)), digit_value);
+    const __m256i is_letter = _mm256_cmpeq_epi8(_mm256_min_epu8(letter_value, _mm256_set1_epi8(5)), letter_value);
+    const __m256i is_separator = _mm256_or_si256(_mm256_cmpeq_epi8(chars, _mm256_set1_epi8(' ')),
+        _mm256_cmpeq_epi8(_mm256_min_epu8(control_value, _mm256_set1_epi8('\r' - '\t')), control_value));
+    *values = _mm256_or_si256(_mm256_and_si256(digit_value, is_digit),
+                              _mm256_and_si256(_mm256_add_epi8(letter_value, _mm256_set1_epi8(10)), is_letter));
+    return _mm256_or_si256(_mm256_and_si256(is_separator, separators),
+                           _mm256_andnot_si256(separators, _mm256_or_si256(is_digit, is_letter)));
+}
+
+BO_TARGET("ssse3")
+static int decode_hex_triplets_ssse3(const uint8_t* src, int count, uint8_t* dst)
+{
+    const __m128i separators[] =
+    {
+        _mm_setr_epi8(HEX_TRIPLET_SEPARATORS_0),
+        _mm_setr_epi8(HEX_TRIPLET_SEPARATORS_1),
+        _mm_setr_epi8(HEX_TRIPLET_SEPARATORS_2),
+    };
+    const __m128i high_indices[] =
+    {
+        _mm_setr_epi8(HEX_TRIPLET_HIGH_0),
+        _mm_setr_epi8(HEX_TRIPLET_HIGH_1),
+        _mm_setr_epi8(HEX_TRIPLET_HIGH_2),
+    };
+    const __m128i low_indices[] =
+    {
+        _mm_setr_epi8(HEX_TRIPLET_LOW_0),
+        _mm_setr_epi8(HEX_TRIPLET_LOW_1),
+        _mm_setr_epi8(HEX_TRIPLET_LOW_2),
+    };
+    int i = 0;
+    for(; i + HEX_TRIPLETS_PER_BLOCK <= count; i += HEX_TRIPLETS_PER_BLOCK)
+    {
+        __m128i is_valid = _mm_set1_epi8(-1);
+        __m128i high = _mm_setzero_si128();
+        __m128i low = _mm_setzero_si128();
+        for(int j = 0; j < 3; j++)
+        {
+            __m128i values;
+            __m128i chars = _mm_loadu_si128((const __m128i*)(src + i * 3 + j * 16));
+            is_valid = _mm_and_si128(is_valid, classify_hex_triplets_ssse3(chars, separators[j], &values));
+            high = _mm_or_si128(high, _mm_shuffle_epi8(values, high_indices[j]));
+            low = _mm_or_si128(low, _mm_shuffle_epi8(values, low_indices[j]));
+        }
+        if(_mm_movemask_epi8(is_valid) != 0xffff)
+        {
+            break;
+        }
+        // Digit values are below 16, so shifting them up can't carry into the neighboring byte.
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(_mm_slli_epi16(high, 4), low));
+    }
+    return i + decode_hex_triplets_scalar(src + i * 3, count - i, dst + i);
+}
+
+BO_TARGET("avx2")
+static int decode_hex_triplets_avx2(const uint8_t* src, int count, uint8_t* dst)
+{
+    // Each 128-bit lane decodes its own block of 16 triplets.
+    const __m256i separators[] =
+    {
+        _mm256_setr_epi8(HEX_TRIPLET_SEPARATORS_0, HEX_TRIPLET_SEPARATORS_0),
+        _mm256_setr_epi8(HEX_TRIPLET_SEPARATORS_1, HEX_TRIPLET_SEPARATORS_1),
+        _mm256_setr_epi8(HEX_TRIPLET_SEPARATORS_2, HEX_TRIPLET_SEPARATORS_2),
+    };
+    const __m256i high_indices[] =
+    {
+        _mm256_setr_epi8(HEX_TRIPLET_HIGH_0, HEX_TRIPLET_HIGH_0),
+        _mm256_setr_epi8(HEX_TRIPLET_HIGH_1, HEX_TRIPLET_HIGH_1),
+        _mm256_setr_epi8(HEX_TRIPLET_HIGH_2, HEX_TRIPLET_HIGH_2),
+    };
+    const __m256i low_indices[] =
+    {
+        _mm256_setr_epi8(HEX_TRIPLET_LOW_0, HEX_TRIPLET_LOW_0),
+        _mm256_setr_epi8(HEX_TRIPLET_LOW_1, HEX_TRIPLET_LOW_1),
+        _mm256_setr_epi8(HEX_TRIPLET_LOW_2, HEX_TRIPLET_LOW_2),
+    };
+    const int block_length = HEX_TRIPLETS_PER_BLOCK * 3;
+    int i = 0;
+    for(; i + HEX_TRIPLETS_PER_BLOCK * 2 <= count; i += HEX_TRIPLETS_PER_BLOCK * 2)
+    {
+        __m256i is_valid = _mm256_set1_epi8(-1);
+        __m256i high = _mm256_setzero_si256();
+        __m256i low = _mm256_setzero_si256();
+        for(int j = 0; j < 3; j++)
+        {
+            const uint8_t* chunk = src + i * 3 + j * 16;
+            __m256i values;
+            __m256i chars = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)chunk)),
+                                                    _mm_loadu_si128((const __m128i*)(chunk + block_length)), 1);
+            is_valid = _mm256_and_si256(is_valid, classify_hex_triplets_avx2(chars, separators[j], &values));
+            high = _mm256_or_si256(high, _mm256_shuffle_epi8(values, high_indices[j]));
+            low = _mm256_or_si256(low, _mm256_shuffle_epi8(values, low_indices[j]));
+        }
+        if(_mm256_movemask_epi8(is_valid) != -1)
+        {
+            break;
+        }
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_or_si256(_mm256_slli_epi16(high, 4), low));
+    }
+    return i + decode_hex_triplets_ssse3(src + i * 3, count - i, dst + i);
+}
+#endif
+
+/**
+ * Decode triplets of two hex digits followed by a whitespace character, stopping at the first
+ * one that doesn't match. Whole blocks of triplets are decoded, plus part of the block where the
+ * mismatch is (if any).
+ *
+ * @param src The source characters.
+ * @param count The number of triplets available in the source.
+ * @param dst Where to store the decoded bytes.
+ * @return The number of triplets decoded.
+ */
+static int decode_hex_triplets(const uint8_t* src, int count, uint8_t* dst)
+{
+#if BO_HAS_X86_SIMD
+    if(cpu_has_avx2())
+    {
+        return decode_hex_triplets_avx2(src, count, dst);
+    }
+    if(cpu_has_ssse3())
+    {
+        return decode_hex_triplets_ssse3(src, count, dst);
+    }
+#endif
+    return decode_hex_triplets_scalar(src, count, dst);
+}
+
+/**
+ * Decode a run of 1 or 2 digit hex tokens separated by whitespace.
+ *
+ * @param src The start of a token.
+ * @param end The end of the source data.
+ * @param dst Where to store the decoded bytes.
+ * @param capacity The most bytes to decode.
+ * @param decoded_count Gets the number of bytes decoded.
+ * @return Where the run ended. This is the start of the first token that wasn't decoded, or end.
+ */
+static const uint8_t* decode_hex_byte_run(const uint8_t* src, const uint8_t* end, uint8_t* dst, int capacity, int* decoded_count)
+{
+    int count = 0;
+    while(count < capacity)
+    {
+        int triplet_count = (end - src) / 3;
+        if(triplet_count > capacity - count)
+        {
+            triplet_count = capacity - count;
+        }
+        const int triplets_decoded = decode_hex_triplets(src, triplet_count, dst + count);
+        src += triplets_decoded * 3;
+        count += triplets_decoded;
+
+        // Decode individual tokens until there's a chance of another whole block of triplets.
+        const int block_end = count + HEX_TRIPLETS_PER_BLOCK;
+        for(; count < capacity && count < block_end; count++)
+        {
+            while(src < end && is_token_separator(*src))
+            {
+                src++;
+            }
+            if(src == end)
+            {
+                *decoded_count = count;
+                return src;
+            }
+            const int high = get_hex_digit_value(src[0]);
+            const int low = src + 1 < end ? get_hex_digit_value(src[1]) : -1;
+            const int length = low < 0 ? 1 : 2;
+            // The token must also end here, rather than at the end of the data (where it might continue).
+            if(high < 0 || src + length >= end || !is_token_separator(src[length]))
+            {
+                *decoded_count = count;
+                return src;
+            }
+            dst[count] = (uint8_t)(low < 0 ? high : (high << 4) | low);
+            src += length + 1;
+        }
+    }
+    *decoded_count = count;
+    return src;
+}
+
+
+
+// ----------------
+// Parser Callbacks
+// ----------------
+
+void bo_on_bytes(bo_context* context, const uint8_t* data, int length)
+{
+    LOG("On bytes: %d", length);
+    if(context->output.data_type == TYPE_BINARY && context->input.data_type == TYPE_BINARY)
+    {
+        add_bytes_passthrough(context, data, length);
+        return;
+    }
+    add_binary_bytes(context, data, length);
+}
+
+void bo_on_string(bo_context* context, const uint8_t* string_start, const uint8_t* string_end)
+{
+    LOG("On string [%.*s]", (int)(string_end - string_start), string_start);
+    add_bytes(context, string_start, string_end - string_start);
+}
+
+typedef enum
+{
+    NUMBER_OK,
+    NUMBER_INVALID,
+    NUMBER_OUT_OF_RANGE,
+} number_parse_status;
+
+// Digits are parsed 8 at a time using SWAR (SIMD within a register): 8 characters are loaded into
+// a 64-bit word (first character in the low byte), validated together, and combined into one value.
+
+#define SWAR_ONES 0x0101010101010101ULL
+
+/**
+ * Load 1-8 digit characters into a word, left padded with '0' so that the value doesn't change.
+ */
+static inline uint64_t load_digit_chunk(const uint8_t* digits, int count)
+{
+    uint64_t chunk = SWAR_ONES * '0';
+    memcpy((uint8_t*)&chunk + 8 - count, digits, count);
+    if(BO_NATIVE_INT_ENDIANNESS == BO_ENDIAN_BIG)
+    {
+        chunk = __builtin_bswap64(chunk);
+    }
+    return chunk;
+}
+
+/**
+ * Get a mask with the high bit set in every byte that's within [low, high].
+ * Bytes of 0x80 and above never match.
+ */
+static inline uint64_t get_bytes_in_range(uint64_t chunk, uint8_t low, uint8_t high)
+{
+    const uint64_t seven_bits = chunk & (SWAR_ONES * 0x7f);
+    const uint64_t is_at_least_low = seven_bits + SWAR_ONES * (0x80 - low);
+    const uint64_t is_at_most_high = SWAR_ONES * (0x80 + high) - seven_bits;
+    return is_at_least_low & is_at_most_high & ~chunk & (SWAR_ONES * 0x80);
+}
+
+static inline bool is_digit_chunk(uint64_t chunk, int base)
+{
+    uint64_t is_digit;
+    switch(base)
+    {
+        case 2:
+            is_digit = get_bytes_in_range(chunk, '0', '1');
+            break;
+        case 8:
+            is_digit = get_bytes_in_range(chunk, '0', '7');
+            break;
+        case 10:
+            is_digit = get_bytes_in_range(chunk, '0', '9');
+            break;
+        default:
+            is_digit = get_bytes_in_range(chunk, '0', '9') |
+                       get_bytes_in_range(chunk, 'a', 'f') |
+                       get_bytes_in_range(chunk, 'A', 'F');
+            break;
+    }
+    return is_digit == SWAR_ONES * 0x80;
+}
+
+/**
+ * Combine 8 valid base 2, 8, or 16 digit characters into a value of 8 * bits_per_digit bits.
+ */
+static inline uint32_t get_power_of_2_chunk_value(uint64_t chunk, int bits_per_digit)
+{
+    // Letters have bit 6 set, and their low nybble is 9 less than their value.
+    uint64_t value = (chunk & (SWAR_ONES * 0x0f)) + ((chunk >> 6) & SWAR_ONES) * 9;
+    // Merge neighboring digits, then pairs, then quads. The first digit is the most significant.
+    value = ((value << bits_per_digit) | (value >> 8)) & 0x00ff00ff00ff00ffULL;
+    value = ((value << (bits_per_digit * 2)) | (value >> 16)) & 0x0000ffff0000ffffULL;
+    value = ((value << (bits_per_digit * 4)) | (value >> 32)) & 0xffffffffULL;
+    return (uint32_t)value;
+}
+
+/**
+ * Combine 8 valid decimal digit characters into their value.
+ */
+static inline uint32_t get_decimal_chunk_value(uint64_t chunk)
+{
+    const uint64_t mask = 0x000000ff000000ffULL;
+    const uint64_t multiplier_1 = 100 + (1000000ULL << 32);
+    const uint64_t multiplier_2 = 1 + (10000ULL << 32);
+    chunk -= SWAR_ONES * '0';
+    chunk = (chunk * 10) + (chunk >> 8);
+    chunk = (((chunk & mask) * multiplier_1) + (((chunk >> 16) & mask) * multiplier_2)) >> 32;
+    return (uint32_t)chunk;
+}
+
+static number_parse_status parse_power_of_2_digits(const uint8_t* digits, int length, int base, unsigned __int128* result)
+{
+    const int bits_per_digit = base == 16 ? 4 : base == 8 ? 3 : 1;
+    const int chunk_bits = bits_per_digit * 8;
+    unsigned __int128 value = 0;
+    // The first chunk takes the odd digits, so that every chunk after it is full.
+    for(int chunk_length = (length - 1) % 8 + 1; length > 0; digits += chunk_length, length -= chunk_length, chunk_length = 8)
+    {
+        uint64_t chunk = load_digit_chunk(digits, chunk_length);
+        if(!is_digit_chunk(chunk, base))
+        {
+            return NUMBER_INVALID;
+        }
+        if(value >> (128 - chunk_bits) != 0)
+        {
+            return NUMBER_OUT_OF_RANGE;
+        }
+        value = (value << chunk_bits) | get_power_of_2_chunk_value(chunk, bits_per_digit);
+    }
+    *result = value;
+    return NUMBER_OK;
+}
+
+static number_parse_status parse_decimal_digits(const uint8_t* digits, int length, unsigned __int128* result)
+{
+    unsigned __int128 value = 0;
+    for(int chunk_length = (length - 1) % 8 + 1; length > 0; digits += chunk_length, length -= chunk_length, chunk_length = 8)
+    {
+        uint64_t chunk = load_digit_chunk(digits, chunk_length);
+        if(!is_digit_chunk(chunk, 10))
+        {
+            return NUMBER_INVALID;
+        }
+        if(__builtin_mul_overflow(value, (unsigned __int128)100000000, &value) ||
+           __builtin_add_overflow(value, (unsigned __int128)get_decimal_chunk_value(chunk), &value))
+        {
+            return NUMBER_OUT_OF_RANGE;
+        }
+    }
+    *result = value;
+    return NUMBER_OK;
+}
+
+/**
+ * Parse an integer token: an optional sign, an optional 0x prefix in base 16, and then digits.
+ * The whole token must be valid, and the value must fit in bit_width bits as either a signed or
+ * an unsigned value. Negative values are stored as two's complement.
+ *
+ * @param str The token.
+ * @param length The token length.
+ * @param base The base (2, 8, 10, or 16).
+ * @param bit_width The width of the integer to store the value in.
+ * @param result Gets the value, if parsing succeeds.
+ * @return The parse status.
+ */
+static number_parse_status parse_integer(const uint8_t* str, int length, int base, int bit_width, unsigned __int128* result)
+{
+    const uint8_t* const end = str + length;
+    bool is_negative = false;
+    if(str < end && (*str == '-' || *str == '+'))
+    {
+        is_negative = *str == '-';
+        str++;
+    }
+    if(base == 16 && end - str > 2 && str[0] == '0' && (str[1] == 'x' || str[1] == 'X'))
+    {
+        str += 2;
+    }
+    if(str == end)
+    {
+        return NUMBER_INVALID;
+    }
+
+    unsigned __int128 magnitude;
+    number_parse_status status = base == 10 ? parse_decimal_digits(str, end - str, &magnitude)
+                                            : parse_power_of_2_digits(str, end - str, base, &magnitude);
+    if(status != NUMBER_OK)
+    {
+        return status;
+    }
+
+    const unsigned __int128 one = 1;
+    if(is_negative ? magnitude > one << (bit_width - 1)
+                   : bit_width < 128 && magnitude > (one << bit_width) - 1)
+    {
+        return NUMBER_OUT_OF_RANGE;
+    }
+    *result = is_negative ? 0 - magnitude : magnitude;
+    return NUMBER_OK;
+}
+
+static void notify_number_parse_error(bo_context* context, number_parse_status status, const uint8_t* string_value, int length)
+{
+    if(status == NUMBER_OUT_OF_RANGE)
+    {
+        bo_notify_error(context, "%.*s: Value doesn't fit in %d bytes", length, string_value, context->input.data_width);
+        return;
+    }
+    bo_notify_error(context, "%.*s: Not a valid number", length, string_value);
+}
+
+static void add_parsed_int(bo_context* context, const uint8_t* string_value, int length, int base)
+{
+    unsigned __int128 value;
+    number_parse_status status = parse_integer(string_value, length, base, context->input.data_width * 8, &value);
+    if(status != NUMBER_OK)
+    {
+        notify_number_parse_error(context, status, string_value, length);
+        return;
+    }
+    if(context->input.data_width == WIDTH_16)
+    {
+        add_int_16(context, value);
+        return;
+    }
+    add_int(context, (uint64_t)value);
+}
+
+// Decimal floats are converted using the Eisel-Lemire algorithm: the (up to 19 digit) significand
+// is multiplied by a 128-bit approximation of the power of ten's power of five, and the power of two
+// goes straight into the exponent. This is always enough to round correctly, except when digits had
+// to be dropped from the significand. In that case, if rounding both the truncated significand and
+// the next one up agree, that's the answer. Otherwise the libc parser decides.
+//
+// See "Number Parsing at a Gigabyte per Second" (Lemire, 2021) and "Fast Number Parsing Without
+// Fallback" (Mushtak & Lemire, 2023).
+
+#define MAX_SIGNIFICAND_DIGITS 19
+
+// Powers of ten that are exactly representable as doubles.
+static const double g_exact_powers_of_10[] =
+{
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+typedef struct
+{
+    int mantissa_bits;
+    int minimum_exponent;
+    int infinite_power;
+    int smallest_power_of_ten;
+    int largest_power_of_ten;
+    int min_round_to_even_power_of_ten;
+    int max_round_to_even_power_of_ten;
+} binary_float_format;
+
+static const binary_float_format g_binary_16_format = {10, -15, 0x1f, -26, 4, -22, 5};
+static const binary_float_format g_bfloat_16_format = {7, -127, 0xff, -60, 38, -24, 3};
+static const binary_float_format g_binary_32_format = {23, -127, 0xff, -64, 38, -17, 10};
+static const binary_float_format g_binary_64_format = {52, -1023, 0x7ff, -342, 308, -4, 23};
+
+typedef struct
+{
+    uint64_t significand;
+    int64_t exponent;
+    bool is_negative;
+    // Digits past the first MAX_SIGNIFICAND_DIGITS significant ones were dropped.
+    bool is_truncated;
+} decimal_float_string;
+
+static inline bool is_decimal_digit(uint8_t ch)
+{
+    return (uint8_t)(ch - '0') <= 9;
+}
+
+static inline const uint8_t* accumulate_decimal_digits(const uint8_t* pos, const uint8_t* end, uint64_t* significand)
+{
+    uint64_t value = *significand;
+    while(end - pos >= 8)
+    {
+        uint64_t chunk = load_digit_chunk(pos, 8);
+        if(!is_digit_chunk(chunk, 10))
+        {
+            break;
+        }
+        value = value * 100000000 + get_decimal_chunk_value(chunk);
+        pos += 8;
+    }
+    for(; pos < end && is_decimal_digit(*pos); pos++)
+    {
+        value = value * 10 + *pos - '0';
+    }
+    *significand = value;
+    return pos;
+}
+
+/**
+ * Take up to max_digits more significant digits into the significand.
+ *
+ * @return The number of digits consumed.
+ */
+static int take_significant_digits(const uint8_t* digits, const uint8_t* end, uint64_t* significand, int* digit_count)
+{
+    const uint8_t* pos = digits;
+    for(; pos < end && *digit_count < MAX_SIGNIFICAND_DIGITS; pos++)
+    {
+        *significand = *significand * 10 + *pos - '0';
+        // Leading zeros aren't significant.
+        *digit_count += *significand != 0;
+    }
+    return pos - digits;
+}
+
+/**
+ * Split a decimal float token ([sign] digits [. digits] [e [sign] digits]) into significand and exponent.
+ *
+ * @return false if the token isn't in this form (in which case it may still be something libc understands).
+ */
+static bool parse_decimal_float_string(const uint8_t* str, int length, decimal_float_string* result)
+{
+    const uint8_t* pos = str;
+    const uint8_t* const end = str + length;
+    result->is_negative = false;
+    if(pos < end && (*pos == '-' || *pos == '+'))
+    {
+        result->is_negative = *pos == '-';
+        pos++;
+    }
+
+    uint64_t significand = 0;
+    const uint8_t* const integer_start = pos;
+    pos = accumulate_decimal_digits(pos, end, &significand);
+    const uint8_t* const integer_end = pos;
+    const uint8_t* fraction_start = pos;
+    const uint8_t* fraction_end = pos;
+    if(pos < end && *pos == '.')
+    {
+        fraction_start = pos + 1;
+        pos = fraction_end = accumulate_decimal_digits(fraction_start, end, &significand);
+    }
+    if(integer_end == integer_start && fraction_end == fraction_start)
+    {
+        return false;
+    }
+
+    int64_t explicit_exponent = 0;
+    if(pos < end && (*pos == 'e' || *pos == 'E'))
+    {
+        pos++;
+        bool is_negative_exponent = false;
+        if(pos < end && (*pos == '-' || *pos == '+'))
+        {
+            is_negative_exponent = *pos == '-';
+            pos++;
+        }
+        if(pos == end || !is_decimal_digit(*pos))
+        {
+            return false;
+        }
+        for(; pos < end && is_decimal_digit(*pos); pos++)
+        {
+            // Anything past this is zero or infinity anyway.
+            if(explicit_exponent < 0x10000000)
+            {
+                explicit_exponent = explicit_exponent * 10 + *pos - '0';
+            }
+        }
+        if(is_negative_exponent)
+        {
+            explicit_exponent = -explicit_exponent;
+        }
+    }
+    if(pos != end)
+    {
+        return false;
+    }
+
+    result->significand = significand;
+    result->exponent = explicit_exponent - (fraction_end - fraction_start);
+    result->is_truncated = false;
+    if((integer_end - integer_start) + (fraction_end - fraction_start) <= MAX_SIGNIFICAND_DIGITS)
+    {
+        return true;
+    }
+
+    // The significand may have wrapped around, so start over with only as many digits as fit.
+    significand = 0;
+    int digit_count = 0;
+    int integer_taken = take_significant_digits(integer_start, integer_end, &significand, &digit_count);
+    if(integer_start + integer_taken < integer_end)
+    {
+        result->exponent = explicit_exponent + (integer_end - integer_start - integer_taken);
+    }
+    else
+    {
+        int fraction_taken = take_significant_digits(fraction_start, fraction_end, &significand, &digit_count);
+        result->exponent = explicit_exponent - fraction_taken;
+    }
+    result->significand = significand;
+    result->is_truncated = digit_count == MAX_SIGNIFICAND_DIGITS;
+    return true;
+}
+
+/**
+ * Get floor(log2(10^power)) + 63, without a loop or a table.
+ */
+static inline int get_binary_power_of_ten(int power)
+{
+    return (((152170 + 65536) * power) >> 16) + 63;
+}
+
+// Returned by decimal_to_binary_float() when it can't tell which way to round.
+#define BINARY_FLOAT_UNDECIDED (~0ULL)
+
+/**
+ * Convert significand * 10^power to the bits of a binary float (without the sign), rounded to nearest even.
+ * significand must be nonzero, and power must be within the format's range of powers of ten.
+ *
+ * @return The bits, or BINARY_FLOAT_UNDECIDED if the value might be halfway between two subnormals.
+ */
+static uint64_t decimal_to_binary_float(uint64_t significand, int power, const binary_float_format* format)
+{
+    const int leading_zeros = __builtin_clzll(significand);
+    significand <<= leading_zeros;
+
+    // Multiply by the power of five. Only the bits that could affect rounding need to be exact,
+    // and the lower half of the table entry only needs to be brought in if they might not be.
+    const int index = (power - POWER_OF_FIVE_128_SMALLEST_POWER) * 2;
+    unsigned __int128 product = (unsigned __int128)significand * g_power_of_five_128[index];
+    uint64_t high = (uint64_t)(product >> 64);
+    uint64_t low = (uint64_t)product;
+    const uint64_t precision_mask = ~0ULL >> (format->mantissa_bits + 3);
+    if((high & precision_mask) == precision_mask)
+    {
+        unsigned __int128 second_product = (unsigned __int128)significand * g_power_of_five_128[index + 1];
+        uint64_t second_high = (uint64_t)(second_product >> 64);
+        low += second_high;
+        high += second_high > low;
+    }
+
+    const int upper_bit = (int)(high >> 63);
+    const int shift = upper_bit + 64 - format->mantissa_bits - 3;
+    uint64_t mantissa = high >> shift;
+    int power2 = get_binary_power_of_ten(power) + upper_bit - leading_zeros - format->minimum_exponent;
+
+    if(power2 <= 0)
+    {
+        // Subnormal
+        if(-power2 + 1 >= 64)
+        {
+            return 0;
+        }
+        // The 2-byte formats have subnormals big enough to be exactly halfway between two of them,
+        // which the product is too coarse to tell apart from being just above or below.
+        const int round_bit = shift - power2 + 1;
+        if(round_bit < 64)
+        {
+            const uint64_t round_bits = high & ((2ULL << round_bit) - 1);
+            if(round_bits == 1ULL << round_bit || round_bits == (1ULL << round_bit) - 1)
+            {
+                return BINARY_FLOAT_UNDECIDED;
+            }
+        }
+        mantissa >>= -power2 + 1;
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+        // Rounding up may have made it normal.
+        power2 = mantissa < (1ULL << format->mantissa_bits) ? 0 : 1;
+        return ((uint64_t)power2 << format->mantissa_bits) | (mantissa & ((1ULL << format->mantissa_bits) - 1));
+    }
+
+    // Exactly halfway between two floats can only happen for a small range of powers, where the
+    // product is exact. In that case round down if that gives an even result.
+    if(low <= 1 && power >= format->min_round_to_even_power_of_ten && power <= format->max_round_to_even_power_of_ten &&
+       (mantissa & 3) == 1 && (mantissa << shift) == high)
+    {
+        mantissa &= ~1ULL;
+    }
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if(mantissa >= (2ULL << format->mantissa_bits))
+    {
+        mantissa = 1ULL << format->mantissa_bits;
+        power2++;
+    }
+    mantissa &= ~(1ULL << format->mantissa_bits);
+    if(power2 >= format->infinite_power)
+    {
+        return (uint64_t)format->infinite_power << format->mantissa_bits;
+    }
+    return ((uint64_t)power2 << format->mantissa_bits) | mantissa;
+}
+
+/**
+ * Convert a parsed decimal float string to the bits of a binary float.
+ *
+ * @return false if the libc parser needs to decide.
+ */
+static bool get_binary_float_bits(const decimal_float_string* decimal, const binary_float_format* format, uint64_t* bits)
+{
+    // The infinite power is all exponent bits set, so the sign comes right after it.
+    const int sign_shift = format->mantissa_bits + __builtin_popcount(format->infinite_power);
+    const uint64_t sign = (uint64_t)decimal->is_negative << sign_shift;
+    if(decimal->significand == 0 || decimal->exponent < format->smallest_power_of_ten)
+    {
+        *bits = sign;
+        return true;
+    }
+    if(decimal->exponent > format->largest_power_of_ten)
+    {
+        *bits = sign | (uint64_t)format->infinite_power << format->mantissa_bits;
+        return true;
+    }
+
+    const int power = (int)decimal->exponent;
+    uint64_t magnitude = decimal_to_binary_float(decimal->significand, power, format);
+    if(magnitude == BINARY_FLOAT_UNDECIDED)
+    {
+        return false;
+    }
+    if(decimal->is_truncated)
+    {
+        // The real value is somewhere between the truncated significand and the next one up.
+        if(decimal->significand == ~0ULL || decimal_to_binary_float(decimal->significand + 1, power, format) != magnitude)
+        {
+            return false;
+        }
+    }
+    *bits = sign | magnitude;
+    return true;
+}
+
+// The strto*() fallbacks need a null terminated copy of the number.
+#define NUMBER_STRING_BUFFER_SIZE 64
+
+/**
+ * Get a null terminated copy of a number string, using buffer if it fits.
+ *
+ * @return The copy, or NULL if memory couldn't be allocated. Free with free_terminated_number_string().
+ */
+static char* get_terminated_number_string(const uint8_t* str, int length, char* buffer)
 {
-    if(!context->on_output(context->user_data, (char*)buffer_get_start(buffer), buffer_get_used(buffer)))
+    char* string = length < NUMBER_STRING_BUFFER_SIZE ? buffer : malloc(length + 1);
+    if(string != NULL)
     {
-        mark_error_condition(context);
+        memcpy(string, str, length);
+        string[length] = 0;
     }
-    buffer_clear(buffer);
+    return string;
 }
 
-static void flush_output_buffer(bo_context* context)
+static inline void free_terminated_number_string(char* string, char* buffer)
 {
-    LOG("Flush output buffer");
-    flush_buffer_to_output(context, &context->output_buffer);
+    if(string != buffer)
+    {
+        free(string);
+    }
 }
 
-static void flush_work_buffer_binary(bo_context* context)
+static number_parse_status parse_float_64(const uint8_t* str, int length, double* result)
 {
-    flush_buffer_to_output(context, &context->work_buffer);
+    decimal_float_string decimal;
+    if(parse_decimal_float_string(str, length, &decimal))
+    {
+#if FLT_EVAL_METHOD == 0
+        // Both the significand and the power of ten are exact doubles, so one operation rounds correctly.
+        if(!decimal.is_truncated && decimal.significand <= (1ULL << 53) && decimal.exponent >= -22 && decimal.exponent <= 22)
+        {
+            double value = (double)decimal.significand;
+            value = decimal.exponent < 0 ? value / g_exact_powers_of_10[-decimal.exponent]
+                                         : value * g_exact_powers_of_10[decimal.exponent];
+            *result = decimal.is_negative ? -value : value;
+            return NUMBER_OK;
+        }
+#endif
+        uint64_t bits;
+        if(get_binary_float_bits(&decimal, &g_binary_64_format, &bits))
+        {
+            memcpy(result, &bits, sizeof(*result));
+            return NUMBER_OK;
+        }
+    }
+
+    // Hex floats, infinity, NaN, and the rare ambiguous case.
+    char buffer[NUMBER_STRING_BUFFER_SIZE];
+    char* string = get_terminated_number_string(str, length, buffer);
+    if(string == NULL)
+    {
+        return NUMBER_INVALID;
+    }
+    char* parse_end;
+    *result = strtod(string, &parse_end);
+    const bool is_valid = length > 0 && parse_end == string + length;
+    free_terminated_number_string(string, buffer);
+    return is_valid ? NUMBER_OK : NUMBER_INVALID;
 }
 
-static void flush_work_buffer(bo_context* context, bool is_complete_flush)
+static number_parse_status parse_float_32(const uint8_t* str, int length, float* result)
 {
-    LOG("Flush work buffer");
-    if(!buffer_is_initialized(&context->work_buffer) || buffer_is_empty(&context->work_buffer))
+    decimal_float_string decimal;
+    uint64_t bits;
+    if(parse_decimal_float_string(str, length, &decimal) && get_binary_float_bits(&decimal, &g_binary_32_format, &bits))
     {
-        return;
+        uint32_t bits_32 = (uint32_t)bits;
+        memcpy(result, &bits_32, sizeof(*result));
+        return NUMBER_OK;
     }
 
-    if(context->output.data_type == TYPE_BINARY)
+    char buffer[NUMBER_STRING_BUFFER_SIZE];
+    char* string = get_terminated_number_string(str, length, buffer);
+    if(string == NULL)
     {
-        flush_work_buffer_binary(context);
-        return;
+        return NUMBER_INVALID;
     }
+    char* parse_end;
+    *result = strtof(string, &parse_end);
+    const bool is_valid = length > 0 && parse_end == string + length;
+    free_terminated_number_string(string, buffer);
+    return is_valid ? NUMBER_OK : NUMBER_INVALID;
+}
 
-    string_printer string_print = get_string_printer(context);
-    if(is_error_condition(context))
+/**
+ * Parse a float with libc, rounded to odd: truncated to a double, with the lowest bit set if anything got
+ * cut off. Rounding that to a narrower format gives the same result as rounding the exact value, whereas
+ * a double rounded to nearest could land right on a halfway point that the real value was just off of.
+ */
+static number_parse_status parse_float_64_round_to_odd(const uint8_t* str, int length, double* result)
+{
+    char buffer[NUMBER_STRING_BUFFER_SIZE];
+    char* string = get_terminated_number_string(str, length, buffer);
+    if(string == NULL)
     {
-        return;
+        return NUMBER_INVALID;
     }
+    char* parse_end;
+    const int rounding_mode = fegetround();
+    fesetround(FE_DOWNWARD);
+    double lower = strtod(string, &parse_end);
+    fesetround(FE_UPWARD);
+    double upper = strtod(string, &parse_end);
+    fesetround(rounding_mode);
+    const bool is_valid = length > 0 && parse_end == string + length;
+    free_terminated_number_string(string, buffer);
 
-    bo_buffer* work_buffer = &context->work_buffer;
-    bo_buffer* output_buffer = &context->output_buffer;
-
-    int bytes_per_entry = context->output.data_width;
-    int work_length = buffer_get_used(work_buffer);
-    if(is_complete_flush)
+    *result = lower;
+    if(lower < upper)
     {
-        // Ensure that the partial read at the end gets zeroes instead of random garbage.
-        // WORK_BUFFER_OVERHEAD_SIZE makes sure this call doesn't run off the end of the buffer.
-        memset(buffer_get_position(work_buffer), 0, 16);
+        double truncated = signbit(upper) ? upper : lower;
+        uint64_t bits;
+        memcpy(&bits, &truncated, sizeof(bits));
+        bits |= 1;
+        memcpy(result, &bits, sizeof(*result));
     }
-    else
+    return is_valid ? NUMBER_OK : NUMBER_INVALID;
+}
+
+/**
+ * Parse a 2-byte float directly to its own format, so that it only gets rounded once.
+ */
+static number_parse_status parse_float_2(const uint8_t* str, int length, const binary_float_format* format, uint16_t* result)
+{
+    decimal_float_string decimal;
+    uint64_t bits;
+    if(parse_decimal_float_string(str, length, &decimal) && get_binary_float_bits(&decimal, format, &bits))
     {
-        work_length = trim_length_to_object_boundary(work_length, bytes_per_entry);
+        *result = (uint16_t)bits;
+        return NUMBER_OK;
     }
 
-    const bool has_prefix = is_nonempty_string(context->output.prefix);
-    const bool has_suffix = is_nonempty_string(context->output.suffix);
-    uint8_t* const start = buffer_get_start(work_buffer);
-    uint8_t* const end = start + work_length;
+    double value;
+    number_parse_status status = parse_float_64_round_to_odd(str, length, &value);
+    if(status == NUMBER_OK)
+    {
+        *result = (uint16_t)encode_float(value, format->mantissa_bits, __builtin_popcount(format->infinite_power));
+    }
+    return status;
+}
 
-    for(uint8_t* src = start; src < end;)
+/**
+ * Check if a float string parses to a particular value.
+ *
+ * @param mantissa_bits The number of explicitly stored mantissa bits, which identifies the format.
+ * @param bits The float's bits, right aligned.
+ */
+static bool is_float_string(const uint8_t* str, int length, int mantissa_bits, uint64_t bits)
+{
+    switch(mantissa_bits)
     {
-        if(has_prefix)
+        case 52:
+        {
+            double value;
+            uint64_t value_bits;
+            if(parse_float_64(str, length, &value) != NUMBER_OK)
+            {
+                return false;
+            }
+            memcpy(&value_bits, &value, sizeof(value_bits));
+            return value_bits == bits;
+        }
+        case 23:
         {
-            buffer_append_string(output_buffer, context->output.prefix);
+            float value;
+            uint32_t value_bits;
+            if(parse_float_32(str, length, &value) != NUMBER_OK)
+            {
+                return false;
+            }
+            memcpy(&value_bits, &value, sizeof(value_bits));
+            return value_bits == bits;
         }
-
-        int output_width = context->output.text_width;
-        int bytes_read = string_print(src, buffer_get_position(output_buffer), &output_width);
-        if(output_width < 0)
+        default:
         {
-            bo_notify_error(context, "Error writing data");
-            return;
+            uint16_t value_bits;
+            return parse_float_2(str, length, mantissa_bits == 7 ? &g_bfloat_16_format : &g_binary_16_format, &value_bits) == NUMBER_OK &&
+                   value_bits == bits;
         }
-        buffer_use_space(output_buffer, output_width);
+    }
+}
 
-        if(has_suffix)
+static void add_parsed_float(bo_context* context, const uint8_t* string_value, int length)
+{
+    number_parse_status status;
+    switch(context->input.data_width)
+    {
+        case WIDTH_2:
         {
-            bool is_last_entry = src + bytes_per_entry >= end;
-            if(!is_last_entry)
+            uint16_t bits;
+            status = parse_float_2(string_value, length,
+                                   context->input.data_type == TYPE_BFLOAT ? &g_bfloat_16_format : &g_binary_16_format,
+                                   &bits);
+            if(status == NUMBER_OK)
             {
-                buffer_append_string(output_buffer, context->output.suffix);
+                add_int(context, bits);
             }
+            break;
         }
-
-        if(buffer_is_high_water(output_buffer))
+        case WIDTH_4:
         {
-            flush_output_buffer(context);
-            if(is_error_condition(context))
+            float value;
+            status = parse_float_32(string_value, length, &value);
+            if(status == NUMBER_OK)
+            {
+                add_float(context, value);
+            }
+            break;
+        }
+        case WIDTH_16:
+        {
+#if BO_HAS_QUADMATH
+            char buffer[NUMBER_STRING_BUFFER_SIZE];
+            char* string = get_terminated_number_string(string_value, length, buffer);
+            if(string == NULL)
             {
+                bo_notify_error(context, "Could not allocate memory for number");
                 return;
             }
+            char* parse_end;
+            __float128 value = strtoflt128(string, &parse_end);
+            status = parse_end == string + length ? NUMBER_OK : NUMBER_INVALID;
+            free_terminated_number_string(string, buffer);
+            if(status == NUMBER_OK)
+            {
+                add_float_16(context, value);
+            }
+            break;
+#else
+            bo_notify_error(context, "Float width 16 is not supported on this platform");
+            return;
+#endif
+        }
+        default:
+        {
+            double value;
+            status = parse_float_64(string_value, length, &value);
+            if(status == NUMBER_OK)
+            {
+                add_float(context, value);
+            }
+            break;
         }
-        src += bytes_read;
     }
-    buffer_clear(work_buffer);
+    if(status != NUMBER_OK)
+    {
+        notify_number_parse_error(context, status, string_value, length);
+    }
 }
 
+static inline const decimal_layout* get_decimal_layout(int data_width)
+{
+    switch(data_width)
+    {
+        case 4: return &g_decimal_32_layout;
+        case 8: return &g_decimal_64_layout;
+        default: return &g_decimal_128_layout;
+    }
+}
 
+typedef struct
+{
+    decoded_decimal value;
+    // The first digit that didn't fit in the coefficient, and whether any after it were nonzero.
+    int round_digit;
+    bool is_sticky;
+} decimal_accumulator;
 
-// ------------------
-// Binary Data Adders
-// ------------------
-
-static void add_bytes(bo_context* context, const uint8_t* ptr, int length)
+static inline void drop_decimal_digits(decimal_accumulator* acc, int count)
 {
-    if(buffer_is_high_water(&context->work_buffer))
+    for(; count > 0 && (acc->value.coefficient != 0 || acc->round_digit != 0); count--)
     {
-        flush_work_buffer(context, false);
+        acc->is_sticky |= acc->round_digit != 0;
+        acc->round_digit = (int)(acc->value.coefficient % 10);
+        acc->value.coefficient /= 10;
+        acc->value.exponent++;
     }
+    acc->value.exponent += count;
+}
 
-    do
-    {
-        int copy_length = buffer_get_remaining(&context->work_buffer);
-        if(copy_length > length)
-        {
-            copy_length = length;
-        }
-        buffer_append_bytes(&context->work_buffer, ptr, copy_length);
-        if(buffer_is_high_water(&context->work_buffer))
-        {
-    	    flush_work_buffer(context, false);
-        }
-        if(is_error_condition(context))
-	    {
-	    	return;
-	    }
-        length -= copy_length;
-        ptr += copy_length;
-    } while(length > 0);
+/**
+ * Get the character at str, or 0 if str is past the end of the string.
+ */
+static inline int peek_char(const uint8_t* str, const uint8_t* end)
+{
+    return str < end ? *str : 0;
 }
 
-static void add_bytes_swapped(bo_context* context, const uint8_t* ptr, int length, const int width)
+/**
+ * Parse a decimal string into a value that fits the layout, following the same rules as strtod():
+ * an optional sign, digits with an optional decimal point, an optional exponent, and then stop at
+ * the first invalid character. Inexact values are rounded half to even, keeping the quantum
+ * (1.50 stays 150e-2) wherever the format allows.
+ */
+static decoded_decimal parse_decimal(const uint8_t* str, const uint8_t* end, const decimal_layout* layout)
 {
-    if(buffer_is_high_water(&context->work_buffer))
+    decimal_accumulator acc = {.round_digit = -1};
+    if(peek_char(str, end) == '-' || peek_char(str, end) == '+')
     {
-        flush_work_buffer(context, false);
+        acc.value.is_negative = peek_char(str, end) == '-';
+        str++;
+    }
+    if((peek_char(str + 0, end) | 0x20) == 'i' && (peek_char(str + 1, end) | 0x20) == 'n' && (peek_char(str + 2, end) | 0x20) == 'f')
+    {
+        acc.value.is_infinity = true;
+        return acc.value;
+    }
+    if((peek_char(str + 0, end) | 0x20) == 'n' && (peek_char(str + 1, end) | 0x20) == 'a' && (peek_char(str + 2, end) | 0x20) == 'n')
+    {
+        acc.value.is_nan = true;
+        return acc.value;
     }
 
-    const int remainder = length % width;
-    const uint8_t* early_end = ptr + length - remainder;
-    while(ptr < early_end)
+    const unsigned __int128 coefficient_limit = get_power_of_10_128(layout->precision);
+    bool is_fraction = false;
+    for(;; str++)
     {
-        copy_swapped(context->work_buffer.pos, ptr, width);
-        buffer_use_space(&context->work_buffer, width);
-        if(buffer_is_high_water(&context->work_buffer))
+        if(peek_char(str, end) == '.' && !is_fraction)
         {
-            flush_work_buffer(context, false);
+            is_fraction = true;
+            continue;
         }
-        if(is_error_condition(context))
+        if(peek_char(str, end) < '0' || peek_char(str, end) > '9')
         {
-            return;
+            break;
+        }
+        const int digit = peek_char(str, end) - '0';
+        if(acc.value.coefficient * 10 < coefficient_limit)
+        {
+            acc.value.coefficient = acc.value.coefficient * 10 + digit;
+            acc.value.exponent -= is_fraction;
+            continue;
+        }
+        if(acc.round_digit < 0)
+        {
+            acc.round_digit = digit;
+        }
+        else
+        {
+            acc.is_sticky |= digit != 0;
         }
-        ptr += width;
+        acc.value.exponent += !is_fraction;
     }
-
-    if(remainder > 0)
+    if(acc.round_digit < 0)
     {
-        uint8_t bytes[width];
-        memset(bytes, 0, sizeof(bytes));
-        memcpy(bytes, ptr, remainder);
-        copy_swapped(context->work_buffer.pos, bytes, width);
-        buffer_use_space(&context->work_buffer, width);
+        acc.round_digit = 0;
     }
-}
 
-static void add_int(bo_context* context, uint64_t src_value)
-{
-    switch(context->input.data_width)
+    if((peek_char(str, end) | 0x20) == 'e')
     {
-        case WIDTH_1:
-        {
-            uint8_t value = (uint8_t)src_value;
-            add_bytes(context, (uint8_t*)&value, sizeof(value));
-            return;
-        }
-        case WIDTH_2:
+        const uint8_t* exponent_str = str + 1;
+        bool is_negative_exponent = peek_char(exponent_str, end) == '-';
+        if(peek_char(exponent_str, end) == '-' || peek_char(exponent_str, end) == '+')
         {
-            uint16_t value = (uint16_t)src_value;
-            if(context->input.endianness != BO_NATIVE_INT_ENDIANNESS)
-            {
-            	uint8_t buff[sizeof(value)];
-            	copy_swapped(buff, (uint8_t*)&value, sizeof(value));
-	            add_bytes(context, buff, sizeof(value));
-                return;
-            }
-            add_bytes(context, (uint8_t*)&value, sizeof(value));
-            return;
+            exponent_str++;
         }
-        case WIDTH_4:
+        int exponent = 0;
+        for(; peek_char(exponent_str, end) >= '0' && peek_char(exponent_str, end) <= '9'; exponent_str++)
         {
-            uint32_t value = (uint32_t)src_value;
-            if(context->input.endianness != BO_NATIVE_INT_ENDIANNESS)
+            // Anything past this is out of range for every format anyway.
+            if(exponent < 100000)
             {
-            	uint8_t buff[sizeof(value)];
-            	copy_swapped(buff, (uint8_t*)&value, sizeof(value));
-	            add_bytes(context, buff, sizeof(value));
-                return;
+                exponent = exponent * 10 + peek_char(exponent_str, end) - '0';
             }
-            add_bytes(context, (uint8_t*)&value, sizeof(value));
-            return;
         }
-        case WIDTH_8:
+        acc.value.exponent += is_negative_exponent ? -exponent : exponent;
+    }
+
+    const int min_exponent = -layout->bias;
+    const int max_exponent = get_decimal_max_exponent(layout);
+    if(acc.value.exponent < min_exponent)
+    {
+        drop_decimal_digits(&acc, min_exponent - acc.value.exponent);
+    }
+    if(acc.round_digit > 5 || (acc.round_digit == 5 && (acc.is_sticky || (acc.value.coefficient & 1))))
+    {
+        acc.value.coefficient++;
+        if(acc.value.coefficient == coefficient_limit)
         {
-            uint64_t value = (uint64_t)src_value;
-            if(context->input.endianness != BO_NATIVE_INT_ENDIANNESS)
-            {
-            	uint8_t buff[sizeof(value)];
-            	copy_swapped(buff, (uint8_t*)&value, sizeof(value));
-	            add_bytes(context, buff, sizeof(value));
-                return;
-            }
-            add_bytes(context, (uint8_t*)&value, sizeof(value));
-            return;
+            acc.value.coefficient /= 10;
+            acc.value.exponent++;
         }
-        case WIDTH_16:
-		    bo_notify_error(context, "TODO: Int width 16 not implemented yet");
-		    return;
-        default:
-		    bo_notify_error(context, "$d: Invalid int width", context->input.data_width);
-		    return;
     }
-}
-
-static void add_float(bo_context* context, double src_value)
-{
-    switch(context->input.data_width)
+    if(acc.value.exponent > max_exponent)
     {
-        case WIDTH_2:
-		    bo_notify_error(context, "TODO: Float width 2 not implemented yet");
-		    return;
-        case WIDTH_4:
+        // Pad with zeros to bring the exponent into range, or saturate to infinity if that would
+        // need too many digits. A zero coefficient is just clamped.
+        for(; acc.value.exponent > max_exponent && acc.value.coefficient * 10 < coefficient_limit; acc.value.exponent--)
         {
-            float value = (float)src_value;
-            if(context->input.endianness != BO_NATIVE_INT_ENDIANNESS)
-            {
-            	uint8_t buff[sizeof(value)];
-            	copy_swapped(buff, (uint8_t*)&value, sizeof(value));
-	            add_bytes(context, buff, sizeof(value));
-                return;
-            }
-            add_bytes(context, (uint8_t*)&value, sizeof(value));
-            return;
+            acc.value.coefficient *= 10;
         }
-        case WIDTH_8:
+        if(acc.value.coefficient == 0)
         {
-            double value = (double)src_value;
-            if(context->input.endianness != BO_NATIVE_INT_ENDIANNESS)
-            {
-            	uint8_t buff[sizeof(value)];
-            	copy_swapped(buff, (uint8_t*)&value, sizeof(value));
-	            add_bytes(context, buff, sizeof(value));
-                return;
-            }
-            add_bytes(context, (uint8_t*)&value, sizeof(value));
-            return;
+            acc.value.exponent = max_exponent;
         }
-        case WIDTH_16:
-		    bo_notify_error(context, "TODO: Float width 16 not implemented yet");
-		    return;
-        default:
-		    bo_notify_error(context, "%d: Invalid float width", context->input.data_width);
-		    return;
+        acc.value.is_infinity = acc.value.exponent > max_exponent;
     }
+    return acc.value;
 }
 
-
-
-// ----------------
-// Parser Callbacks
-// ----------------
-
-void bo_on_bytes(bo_context* context, uint8_t* data, int length)
+static void add_parsed_decimal(bo_context* context, const uint8_t* string_value, int length)
 {
-    LOG("On bytes: %d", length);
-    if(context->input.data_width > 1 && context->input.endianness != BO_NATIVE_INT_ENDIANNESS)
+    const decimal_layout* layout = get_decimal_layout(context->input.data_width);
+    const decoded_decimal value = parse_decimal(string_value, string_value + length, layout);
+    const unsigned __int128 bits = encode_decimal(&value, layout);
+    if(context->input.data_width == WIDTH_16)
     {
-        add_bytes_swapped(context, data, length, context->input.data_width);
+        add_int_16(context, bits);
         return;
-    }
-    add_bytes(context, data, length);    
-}
-
-void bo_on_string(bo_context* context, const uint8_t* string_start, const uint8_t* string_end)
-{
-    LOG("On string [%s]", string_start);
-    add_bytes(context, string_start, string_end - string_start);
+    }
+    add_int(context, (uint64_t)bits);
 }
 
-void bo_on_number(bo_context* context, const uint8_t* string_value)
+void bo_on_number(bo_context* context, const uint8_t* string_value, int length)
 {
-    LOG("On number [%s]", string_value);
-    if(!check_can_input_numbers(context, string_value))
+    LOG("On number [%.*s]", length, string_value);
+    if(!check_can_input_numbers(context, string_value, length))
     {
         return;
     }
@@ -784,33 +4488,87 @@ void bo_on_number(bo_context* context, const uint8_t* string_value)
     switch(context->input.data_type)
     {
         case TYPE_FLOAT:
-            add_float(context, strtod((char*)string_value, NULL));
+        case TYPE_BFLOAT:
+            add_parsed_float(context, string_value, length);
             return;
         case TYPE_DECIMAL:
-            bo_notify_error(context, "TODO: Unimplemented decimal type: %s", string_value);
+            add_parsed_decimal(context, string_value, length);
             return;
         case TYPE_INT:
-            add_int(context, strtoul((char*)string_value, NULL, 10));
+            add_parsed_int(context, string_value, length, 10);
             return;
         case TYPE_HEX:
-            add_int(context, strtoul((char*)string_value, NULL, 16));
+            add_parsed_int(context, string_value, length, 16);
             return;
         case TYPE_OCTAL:
-            add_int(context, strtoul((char*)string_value, NULL, 8));
+            add_parsed_int(context, string_value, length, 8);
             return;
         case TYPE_BOOLEAN:
-            add_int(context, strtoul((char*)string_value, NULL, 2));
+            add_parsed_int(context, string_value, length, 2);
             return;
         default:
-            bo_notify_error(context, "Unknown type %d for value [%s]", context->input.data_type, string_value);
+            bo_notify_error(context, "Unknown type %d for value [%.*s]", context->input.data_type, length, string_value);
             return;
     }
 }
 
-void bo_on_preset(bo_context* context, const uint8_t* string_value)
+/**
+ * Add as much of a run of numbers as can be decoded in bulk, straight into the work buffer.
+ * Currently this is only done for 1-byte hex values.
+ *
+ * @param context The context.
+ * @param start The start of the first token in the run.
+ * @param end The end of the source data.
+ * @return Where the run ended (the first token that still needs to go through bo_on_number(), or end).
+ *         Returns start if no numbers were added.
+ */
+const uint8_t* bo_on_number_run(bo_context* context, const uint8_t* start, const uint8_t* end)
+{
+    if(context->input.data_type != TYPE_HEX || context->input.data_width != WIDTH_1)
+    {
+        return start;
+    }
+
+    bo_buffer* work_buffer = &context->work_buffer;
+    if(buffer_is_high_water(work_buffer))
+    {
+        flush_work_buffer(context, false);
+        if(is_error_condition(context))
+        {
+            return start;
+        }
+    }
+
+    // Flush at the same points that adding the values one at a time would, since the output
+    // type in effect at the time of the flush is what they get printed as.
+    const uint8_t* pos = start;
+    for(;;)
+    {
+        const int capacity = buffer_get_remaining_to_high_water(work_buffer);
+        int decoded_count = 0;
+        pos = decode_hex_byte_run(pos, end, buffer_get_position(work_buffer), capacity, &decoded_count);
+        buffer_use_space(work_buffer, decoded_count);
+        if(buffer_is_high_water(work_buffer))
+        {
+            flush_work_buffer(context, false);
+            if(is_error_condition(context))
+            {
+                return pos;
+            }
+        }
+        if(decoded_count < capacity)
+        {
+            break;
+        }
+    }
+    LOG("On number run: %d bytes", (int)(pos - start));
+    return pos;
+}
+
+void bo_on_preset(bo_context* context, const uint8_t* string_value, int length)
 {
-    LOG("Set preset [%s]", string_value);
-    if(*string_value == 0)
+    LOG("Set preset [%.*s]", length, string_value);
+    if(length < 1)
     {
         bo_notify_error(context, "Missing preset value");
         return;
@@ -837,7 +4595,7 @@ void bo_on_preset(bo_context* context, const uint8_t* string_value)
             }
             break;
         default:
-            bo_notify_error(context, "%s: Unknown prefix-suffix preset", string_value);
+            bo_notify_error(context, "%.*s: Unknown prefix-suffix preset", length, string_value);
             return;
     }
 }
@@ -845,8 +4603,9 @@ void bo_on_preset(bo_context* context, const uint8_t* string_value)
 void bo_on_prefix(bo_context* context, const uint8_t* prefix)
 {
     LOG("Set prefix [%s]", prefix);
-    free((void*)context->output.prefix);
+    free_output_string(context, context->output.prefix);
     context->output.prefix = strdup((char*)prefix);
+    context->output.print_batch = NULL;
     if(context->output.prefix == NULL)
     {
         bo_notify_error(context, "Could not clone string [%s]: %s", prefix, strerror(errno));
@@ -856,8 +4615,9 @@ void bo_on_prefix(bo_context* context, const uint8_t* prefix)
 void bo_on_suffix(bo_context* context, const uint8_t* suffix)
 {
     LOG("Set suffix [%s]", suffix);
-    free((void*)context->output.suffix);
+    free_output_string(context, context->output.suffix);
     context->output.suffix = strdup((char*)suffix);
+    context->output.print_batch = NULL;
     if(context->output.suffix == NULL)
     {
         bo_notify_error(context, "Could not clone string [%s]: %s", suffix, strerror(errno));
@@ -879,6 +4639,7 @@ void bo_on_output_type(bo_context* context, bo_data_type data_type, int data_wid
     context->output.data_width = data_width;
     context->output.endianness = endianness;
     context->output.text_width = print_width;
+    context->output.print_batch = NULL;
 }
 
 
@@ -892,29 +4653,119 @@ const char* bo_version()
     return BO_VERSION;
 }
 
+static bool is_power_of_2(int value)
+{
+    return value > 0 && (value & (value - 1)) == 0;
+}
+
+/**
+ * Fill in defaults for any options set to 0, and check that the results are valid.
+ *
+ * @return An error message, or NULL if the options are valid.
+ */
+static const char* resolve_context_options(bo_context_options* options)
+{
+    if(options->work_buffer_size == 0)
+    {
+        options->work_buffer_size = WORK_BUFFER_SIZE;
+    }
+    if(options->work_buffer_high_water == 0)
+    {
+        options->work_buffer_high_water = options->work_buffer_size;
+    }
+    if(options->output_buffer_size == 0)
+    {
+        options->output_buffer_size = OUTPUT_BUFFER_SIZE;
+    }
+    if(options->output_buffer_high_water == 0)
+    {
+        options->output_buffer_high_water = options->output_buffer_size;
+    }
+
+    if(options->work_buffer_size < MIN_WORK_BUFFER_SIZE)
+    {
+        return "Work buffer size must be at least 16";
+    }
+    if(options->work_buffer_high_water < MIN_WORK_BUFFER_SIZE || options->work_buffer_high_water > options->work_buffer_size)
+    {
+        return "Work buffer high water must be between 16 and the work buffer size";
+    }
+    if(options->output_buffer_size < 0)
+    {
+        return "Output buffer size must be positive";
+    }
+    if(options->output_buffer_high_water < 0 || options->output_buffer_high_water > options->output_buffer_size)
+    {
+        return "Output buffer high water must be between 0 and the output buffer size";
+    }
+    if(options->buffer_alignment != 0 && !is_power_of_2(options->buffer_alignment))
+    {
+        return "Buffer alignment must be a power of 2";
+    }
+    return NULL;
+}
+
 void* bo_new_context(void* user_data, output_callback on_output, error_callback on_error)
+{
+    return bo_new_context_with_options(user_data, on_output, on_error, NULL);
+}
+
+void* bo_new_context_with_options(void* user_data,
+                                  output_callback on_output,
+                                  error_callback on_error,
+                                  const bo_context_options* options)
 {
     LOG("New callback context");
+    bo_context_options resolved_options = {0};
+    if(options != NULL)
+    {
+        resolved_options = *options;
+    }
+    const char* error_message = resolve_context_options(&resolved_options);
+    if(error_message != NULL)
+    {
+        on_error(user_data, error_message);
+        return NULL;
+    }
+
     bo_context context =
     {
         .src_buffer = {0},
-        .work_buffer = buffer_alloc(WORK_BUFFER_SIZE, WORK_BUFFER_OVERHEAD_SIZE),
-        .output_buffer = buffer_alloc(WORK_BUFFER_SIZE * 10, OUTPUT_BUFFER_OVERHEAD_SIZE),
+        .carry_buffer = {0},
+        .work_buffer = buffer_alloc(resolved_options.work_buffer_size + WORK_BUFFER_OVERHEAD_SIZE,
+                                    resolved_options.work_buffer_high_water,
+                                    resolved_options.buffer_alignment),
+        .output_buffer = buffer_alloc(resolved_options.output_buffer_size + OUTPUT_BUFFER_OVERHEAD_SIZE,
+                                      resolved_options.output_buffer_high_water,
+                                      resolved_options.buffer_alignment),
+        .is_output_buffer_borrowed = false,
+        .buffer_alignment = resolved_options.buffer_alignment,
         .input =
         {
             .data_type = TYPE_NONE,
             .data_width = 0,
             .endianness = BO_ENDIAN_NONE,
+            .partial_element_length = 0,
         },
         .output =
         {
             .data_type = TYPE_NONE,
             .data_width = 0,
-            .text_width = 0,
+            .text_width = PRINT_WIDTH_UNSPECIFIED,
             .prefix = NULL,
             .suffix = NULL,
             .endianness = BO_ENDIAN_NONE,
+            .has_printed_entry = false,
+            .float_2_cache = NULL,
+            .float_2_cache_type = TYPE_NONE,
+            .print_batch = NULL,
+        },
+        .token_scan =
+        {
+            .block = NULL,
+            .whitespace = 0,
         },
+        .program = NULL,
         .on_error = on_error,
         .on_output = on_output,
         .user_data = user_data,
@@ -926,23 +4777,508 @@ void* bo_new_context(void* user_data, output_callback on_output, error_callback
         .is_spanning_string = false,
     };
 
+    if(context.work_buffer.start == NULL || context.output_buffer.start == NULL)
+    {
+        buffer_free(&context.work_buffer);
+        buffer_free(&context.output_buffer);
+        on_error(user_data, "Could not allocate buffers");
+        return NULL;
+    }
+
     bo_context* heap_context = (bo_context*)malloc(sizeof(context));
     *heap_context = context;
     return heap_context;
 }
 
+/**
+ * Free everything that the context allocated while processing, and the prefix and suffix it owns.
+ */
+static void free_context_state(bo_context* context)
+{
+    buffer_free(&context->carry_buffer);
+    free_output_string(context, context->output.prefix);
+    free_output_string(context, context->output.suffix);
+    free(context->output.float_2_cache);
+}
+
+static void destroy_context(bo_context* context)
+{
+    free_context_state(context);
+    buffer_free(&context->work_buffer);
+    buffer_free(&context->output_buffer);
+    free((void*)context);
+}
+
+/**
+ * Convert everything that has been input so far, including any partial element.
+ */
+static void flush_all_input(bo_context* context)
+{
+    if(context->input.partial_element_length > 0)
+    {
+        add_partial_element_swapped(context);
+    }
+    flush_work_buffer(context, true);
+}
+
 bool bo_flush_and_destroy_context(void* void_context)
 {
     LOG("Destroy context");
     bo_context* context = (bo_context*)void_context;
     clear_error_condition(context);
-    flush_work_buffer(context, true);
+    flush_all_input(context);
     flush_output_buffer(context);
     bool is_successful = !is_error_condition(context);
+    destroy_context(context);
+    return is_successful;
+}
+
+static bool append_to_carry_buffer(bo_context* context, const char* data, int length)
+{
+    bo_buffer* carry_buffer = &context->carry_buffer;
+    if(length == 0)
+    {
+        return true;
+    }
+    if(!buffer_is_initialized(carry_buffer))
+    {
+        *carry_buffer = buffer_alloc(CARRY_BUFFER_SIZE, CARRY_BUFFER_SIZE, 0);
+        if(!buffer_is_initialized(carry_buffer))
+        {
+            bo_notify_error(context, "Could not allocate memory for carry buffer");
+            return false;
+        }
+    }
+    while(buffer_get_remaining(carry_buffer) < length)
+    {
+        if(!buffer_grow(carry_buffer))
+        {
+            bo_notify_error(context, "Could not allocate memory for carry buffer");
+            return false;
+        }
+    }
+    buffer_append_bytes(carry_buffer, (const uint8_t*)data, length);
+    return true;
+}
+
+/**
+ * Finish the incomplete token in the carry buffer, topping it up from the start of the new data.
+ *
+ * Once the parser gets past everything that was carried over, the rest is left for processing
+ * directly from the new data, so only the bytes needed to complete the token get copied.
+ *
+ * @return The number of bytes of data consumed, or -1 if an error occurred.
+ */
+static int process_carried_input(bo_context* context,
+                                 const char* data,
+                                 int data_length,
+                                 bo_data_segment_type data_segment_type)
+{
+    bo_buffer* carry_buffer = &context->carry_buffer;
+    int consumed = 0;
+    int slice_length = CARRY_BUFFER_SIZE;
+    for(;;)
+    {
+        const int carried_length = buffer_get_used(carry_buffer);
+        int length = data_length - consumed;
+        if(length > slice_length)
+        {
+            length = slice_length;
+        }
+        if(!append_to_carry_buffer(context, data + consumed, length))
+        {
+            return -1;
+        }
+        consumed += length;
+
+        bool is_last_slice = consumed == data_length;
+        const char* start = (const char*)buffer_get_start(carry_buffer);
+        const char* processed_to = bo_process_const(context,
+                                                    start,
+                                                    buffer_get_used(carry_buffer),
+                                                    is_last_slice ? data_segment_type : DATA_SEGMENT_STREAM);
+        if(processed_to == NULL)
+        {
+            return -1;
+        }
+        int processed_length = processed_to - start;
+        if(processed_length >= carried_length)
+        {
+            // Everything from here on is still in the data, so carry on from there.
+            consumed -= buffer_get_used(carry_buffer) - processed_length;
+            buffer_clear(carry_buffer);
+            return consumed;
+        }
+        buffer_consume(carry_buffer, processed_length);
+        if(is_last_slice)
+        {
+            // Still incomplete. Wait for the next chunk.
+            return consumed;
+        }
+        if(processed_length == 0)
+        {
+            // A token spans the whole slice.
+            slice_length *= 2;
+        }
+    }
+}
+
+bool bo_process_stream(void* void_context,
+                       const char* data,
+                       int data_length,
+                       bo_data_segment_type data_segment_type)
+{
+    LOG("Process stream %d bytes", data_length);
+    bo_context* context = (bo_context*)void_context;
+    int consumed = 0;
+    if(!buffer_is_empty(&context->carry_buffer))
+    {
+        consumed = process_carried_input(context, data, data_length, data_segment_type);
+        if(consumed < 0)
+        {
+            return false;
+        }
+        if(!buffer_is_empty(&context->carry_buffer))
+        {
+            return true;
+        }
+    }
+    if(consumed == data_length)
+    {
+        if(data_segment_type == DATA_SEGMENT_LAST && context->is_spanning_string)
+        {
+            bo_notify_error(context, "Unterminated string");
+            return false;
+        }
+        return true;
+    }
+
+    const char* processed_to = bo_process_const(context, data + consumed, data_length - consumed, data_segment_type);
+    if(processed_to == NULL)
+    {
+        return false;
+    }
+    return append_to_carry_buffer(context, processed_to, data + data_length - processed_to);
+}
+
+bool bo_process_into(void* void_context,
+                     const char* input,
+                     int input_length,
+                     bo_data_segment_type data_segment_type,
+                     char* output,
+                     int output_capacity,
+                     int* consumed,
+                     int* produced)
+{
+    LOG("Process into %d bytes", output_capacity);
+    bo_context* context = (bo_context*)void_context;
+    *consumed = 0;
+    *produced = 0;
+
+    // Output left over from the last call goes first.
+    bo_buffer* own_buffer = &context->output_buffer;
+    int leftover_length = buffer_get_used(own_buffer);
+    if(leftover_length > output_capacity)
+    {
+        leftover_length = output_capacity;
+    }
+    memcpy(output, buffer_get_start(own_buffer), leftover_length);
+    buffer_consume(own_buffer, leftover_length);
+    if(!buffer_is_empty(own_buffer))
+    {
+        *produced = output_capacity;
+        return true;
+    }
+
+    uint8_t* caller_start = (uint8_t*)output + leftover_length;
+    bo_buffer caller_buffer =
+    {
+        .start = caller_start,
+        .pos = caller_start,
+        .end = (uint8_t*)output + output_capacity,
+        .high_water = (uint8_t*)output + output_capacity,
+    };
+    context->pull.own_buffer = context->output_buffer;
+    context->pull.is_overflowing = false;
+    context->pull.is_active = true;
+    context->output_buffer = caller_buffer;
+
+    // Feed the input in slices, so that processing stops soon after the caller's buffer fills.
+    int offset = 0;
+    int slice_length = PULL_INPUT_SLICE_SIZE;
+    bool is_successful = true;
+    while(offset < input_length && !context->pull.is_overflowing)
+    {
+        int length = input_length - offset;
+        if(length > slice_length)
+        {
+            length = slice_length;
+        }
+        bool is_last_slice = offset + length == input_length;
+        const char* processed_to = bo_process_const(context,
+                                                    input + offset,
+                                                    length,
+                                                    is_last_slice ? data_segment_type : DATA_SEGMENT_STREAM);
+        if(processed_to == NULL || is_error_condition(context))
+        {
+            is_successful = false;
+            break;
+        }
+        int processed_length = processed_to - (input + offset);
+        if(processed_length == 0)
+        {
+            if(is_last_slice)
+            {
+                // The rest is an incomplete token, which the caller must pass in again with more data.
+                break;
+            }
+            // A token spans the whole slice.
+            slice_length *= 2;
+            continue;
+        }
+        offset += processed_length;
+        slice_length = PULL_INPUT_SLICE_SIZE;
+    }
+    *consumed = offset;
+
+    if(is_successful && data_segment_type == DATA_SEGMENT_LAST && offset == input_length && !context->pull.is_overflowing)
+    {
+        flush_all_input(context);
+        is_successful = !is_error_condition(context);
+    }
+
+    if(context->pull.is_overflowing)
+    {
+        // Top up the caller's buffer from the overflow.
+        caller_buffer = context->pull.caller_buffer;
+        bo_buffer* overflow_buffer = &context->output_buffer;
+        int top_up_length = buffer_get_remaining(&caller_buffer);
+        if(top_up_length > buffer_get_used(overflow_buffer))
+        {
+            top_up_length = buffer_get_used(overflow_buffer);
+        }
+        buffer_append_bytes(&caller_buffer, buffer_get_start(overflow_buffer), top_up_length);
+        buffer_consume(overflow_buffer, top_up_length);
+    }
+    else
+    {
+        caller_buffer = context->output_buffer;
+        context->output_buffer = context->pull.own_buffer;
+    }
+    context->pull.is_active = false;
+
+    *produced = buffer_get_position(&caller_buffer) - (uint8_t*)output;
+    return is_successful;
+}
+
+// Compiling runs the commands through a context whose user data is one of these, so that any output
+// can be reported as an error to the caller.
+typedef struct
+{
+    void* user_data;
+    error_callback on_error;
+} compile_callbacks;
+
+static void on_compile_error(void* user_data, const char* message)
+{
+    compile_callbacks* callbacks = (compile_callbacks*)user_data;
+    callbacks->on_error(callbacks->user_data, message);
+}
+
+static bool on_compile_output(void* user_data, char* data, int length)
+{
+    (void)data;
+    (void)length;
+    on_compile_error(user_data, "Commands to compile must not contain data");
+    return false;
+}
+
+void* bo_compile(const char* commands, int commands_length, void* user_data, error_callback on_error)
+{
+    LOG("Compile [%.*s]", commands_length, commands);
+    compile_callbacks callbacks =
+    {
+        .user_data = user_data,
+        .on_error = on_error,
+    };
+    bo_context* context = (bo_context*)bo_new_context(&callbacks, on_compile_output, on_compile_error);
+    if(context == NULL)
+    {
+        return NULL;
+    }
+
+    if(bo_process_const(context, commands, commands_length, DATA_SEGMENT_LAST) == NULL || is_error_condition(context))
+    {
+        destroy_context(context);
+        return NULL;
+    }
+    if(!buffer_is_empty(&context->work_buffer) ||
+       !buffer_is_empty(&context->output_buffer) ||
+       context->input.partial_element_length > 0)
+    {
+        bo_notify_error(context, "Commands to compile must not contain data");
+        destroy_context(context);
+        return NULL;
+    }
+
+    // Resolve the output format now, so that running the program doesn't have to.
+    if(context->output.data_type != TYPE_NONE && context->output.data_type != TYPE_BINARY)
+    {
+        context->output.format = get_entry_format(context);
+        context->output.print_batch = get_batch_printer(context, &context->output.format);
+        if(is_error_condition(context))
+        {
+            destroy_context(context);
+            return NULL;
+        }
+        // Programs can be run from many threads at once, so their cache must be read-only.
+        if(context->output.format.float_2_cache != NULL)
+        {
+            fill_float_2_cache(context->output.format.float_2_cache, context->output.data_type);
+        }
+    }
+
+    bo_program* program = (bo_program*)malloc(sizeof(*program));
+    if(program == NULL)
+    {
+        bo_notify_error(context, "Could not allocate program");
+        destroy_context(context);
+        return NULL;
+    }
+
+    // The program takes over the prefix, suffix, and float_2_cache. Everything else goes.
+    buffer_free(&context->carry_buffer);
     buffer_free(&context->work_buffer);
     buffer_free(&context->output_buffer);
-    free((void*)context->output.prefix);
-    free((void*)context->output.suffix);
+    program->context = *context;
     free((void*)context);
+
+    bo_context* initial_context = &program->context;
+    initial_context->src_buffer = (bo_buffer){0};
+    initial_context->carry_buffer = (bo_buffer){0};
+    initial_context->work_buffer = (bo_buffer){0};
+    initial_context->output_buffer = (bo_buffer){0};
+    initial_context->token_scan.block = NULL;
+    initial_context->token_scan.whitespace = 0;
+    initial_context->on_error = NULL;
+    initial_context->on_output = NULL;
+    initial_context->user_data = NULL;
+    initial_context->data_segment_type = DATA_SEGMENT_STREAM;
+    initial_context->is_at_end_of_input = false;
+    initial_context->parse_should_continue = false;
+    return program;
+}
+
+void bo_destroy_program(void* void_program)
+{
+    LOG("Destroy program");
+    bo_program* program = (bo_program*)void_program;
+    if(program == NULL)
+    {
+        return;
+    }
+    free((void*)program->context.output.prefix);
+    free((void*)program->context.output.suffix);
+    free(program->context.output.float_2_cache);
+    free(program);
+}
+
+/**
+ * Run a program in a context that lives on the stack.
+ *
+ * @param is_continuation If true, the output continues on from an earlier run, so it starts with the suffix.
+ */
+static bool run_program(const bo_program* program,
+                        const char* data,
+                        int data_length,
+                        bool is_continuation,
+                        void* user_data,
+                        output_callback on_output,
+                        error_callback on_error)
+{
+    uint8_t work_memory[WORK_BUFFER_SIZE + WORK_BUFFER_OVERHEAD_SIZE];
+    uint8_t output_memory[OUTPUT_BUFFER_SIZE + OUTPUT_BUFFER_OVERHEAD_SIZE];
+
+    bo_context context = program->context;
+    context.work_buffer = buffer_wrap(work_memory, sizeof(work_memory), WORK_BUFFER_SIZE);
+    context.output_buffer = buffer_wrap(output_memory, sizeof(output_memory), OUTPUT_BUFFER_SIZE);
+    context.is_output_buffer_borrowed = true;
+    // The program's cache stays with its resolved printer. If the data changes the output type,
+    // this context fills its own.
+    context.output.float_2_cache = NULL;
+    context.output.float_2_cache_type = TYPE_NONE;
+    context.output.has_printed_entry = is_continuation;
+    context.program = program;
+    context.on_error = on_error;
+    context.on_output = on_output;
+    context.user_data = user_data;
+
+    bool is_successful = bo_process_const(&context, data, data_length, DATA_SEGMENT_LAST) != NULL &&
+                         !is_error_condition(&context);
+    clear_error_condition(&context);
+    flush_all_input(&context);
+    flush_output_buffer(&context);
+    is_successful = is_successful && !is_error_condition(&context);
+    free_context_state(&context);
+    if(!context.is_output_buffer_borrowed)
+    {
+        buffer_free(&context.output_buffer);
+    }
     return is_successful;
 }
+
+bool bo_run_program(const void* program,
+                    const char* data,
+                    int data_length,
+                    void* user_data,
+                    output_callback on_output,
+                    error_callback on_error)
+{
+    LOG("Run program on %d bytes", data_length);
+    return run_program((const bo_program*)program, data, data_length, false, user_data, on_output, on_error);
+}
+
+bool bo_run_program_continuation(const void* program,
+                                 const char* data,
+                                 int data_length,
+                                 void* user_data,
+                                 output_callback on_output,
+                                 error_callback on_error)
+{
+    LOG("Run program continuation on %d bytes", data_length);
+    return run_program((const bo_program*)program, data, data_length, true, user_data, on_output, on_error);
+}
+
+int bo_get_program_split_alignment(const void* void_program)
+{
+    const bo_program* program = (const bo_program*)void_program;
+    const bo_context* context = &program->context;
+    if(context->input.data_type != TYPE_BINARY)
+    {
+        // Text input can't be split without knowing where its tokens end.
+        return 0;
+    }
+    switch(context->output.data_type)
+    {
+        case TYPE_NONE:
+        case TYPE_STRING:
+            // String output depends on the UTF-8 sequences around it.
+            return 0;
+        default:
+        {
+            const int input_width = context->input.data_width;
+            const int output_width = context->output.data_width;
+            return input_width > output_width ? input_width : output_width;
+        }
+    }
+}
+
+bool bo_is_program_passthrough(const void* void_program)
+{
+    const bo_program* program = (const bo_program*)void_program;
+    bo_context* context = (bo_context*)&program->context;
+    return context->input.data_type == TYPE_BINARY &&
+           context->output.data_type == TYPE_BINARY &&
+           get_input_swap_width(context) == 0 &&
+           get_output_swap_width(context) == 0;
+}
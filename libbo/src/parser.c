@@ -24,6 +24,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include "bo_internal.h"
+#include "bo_simd.h"
 #include "character_flags.h"
 
 
@@ -40,6 +41,7 @@ static const char* g_data_type_name[] =
     [TYPE_OCTAL]   = "octal",
     [TYPE_BOOLEAN] = "boolean",
     [TYPE_FLOAT]   = "float",
+    [TYPE_BFLOAT]  = "bfloat",
     [TYPE_DECIMAL] = "decimal",
     [TYPE_STRING]  = "string",
 };
@@ -53,24 +55,45 @@ static int g_min_data_widths[] =
     [TYPE_OCTAL]   = 1,
     [TYPE_BOOLEAN] = 1,
     [TYPE_FLOAT]   = 2,
+    [TYPE_BFLOAT]  = 2,
     [TYPE_DECIMAL] = 4,
     [TYPE_STRING]  = 1,
 };
 
+static int g_max_data_widths[] =
+{
+    [TYPE_NONE]    = 0,
+    [TYPE_BINARY]  = 16,
+    [TYPE_INT]     = 16,
+    [TYPE_HEX]     = 16,
+    [TYPE_OCTAL]   = 16,
+    [TYPE_BOOLEAN] = 16,
+    [TYPE_FLOAT]   = 16,
+    [TYPE_BFLOAT]  = 2,
+    [TYPE_DECIMAL] = 16,
+    [TYPE_STRING]  = 1,
+};
+
 static inline bool should_continue_parsing(bo_context* context)
 {
     return context->parse_should_continue;
 }
 
-static inline void stop_parsing_at(bo_context* context, uint8_t* position)
+static inline void set_position(bo_context* context, const uint8_t* position)
+{
+    // The source buffer is never written to, so dropping const here is safe.
+    buffer_set_position(&context->src_buffer, (uint8_t*)position);
+}
+
+static inline void stop_parsing_at(bo_context* context, const uint8_t* position)
 {
-    context->src_buffer.pos = position;
+    set_position(context, position);
     stop_parsing(context);
 }
 
 static bool verify_data_width(bo_context* context, bo_data_type data_type, int width)
 {
-    if(width < g_min_data_widths[data_type])
+    if(width < g_min_data_widths[data_type] || width > g_max_data_widths[data_type])
     {
         bo_notify_error(context, "Width %d cannot be used with data type %s", width, g_data_type_name[data_type]);
         return false;
@@ -113,16 +136,21 @@ static inline bool is_last_data_segment(bo_context* context)
     return context->data_segment_type == DATA_SEGMENT_LAST;
 }
 
-static inline void null_terminate_string(uint8_t* ptr)
+static int get_decimal_value(const uint8_t* token, int token_length, int offset)
 {
-    *ptr = 0;
+    int value = 0;
+    for(; offset < token_length && is_decimal_character(token[offset]); offset++)
+    {
+        value = value * 10 + token[offset] - '0';
+    }
+    return value;
 }
 
-static bo_data_type extract_data_type(bo_context* context, uint8_t* token, int offset)
+static bo_data_type extract_data_type(bo_context* context, const uint8_t* token, int token_length, int offset)
 {
-    if(token + offset >= buffer_get_end(&context->src_buffer))
+    if(offset >= token_length)
     {
-        bo_notify_error(context, "%s: offset %d: Missing data type", token, offset);
+        bo_notify_error(context, "%.*s: offset %d: Missing data type", token_length, token, offset);
         return TYPE_NONE;
     }
     switch(token[offset])
@@ -139,35 +167,37 @@ static bo_data_type extract_data_type(bo_context* context, uint8_t* token, int o
             return TYPE_BOOLEAN;
         case 'f':
             return TYPE_FLOAT;
+        case 'F':
+            return TYPE_BFLOAT;
         case 'd':
             return TYPE_DECIMAL;
         case 's':
             return TYPE_STRING;
         default:
-            bo_notify_error(context, "%s: offset %d: %c is not a valid data type", token, offset, token[offset]);
+            bo_notify_error(context, "%.*s: offset %d: %c is not a valid data type", token_length, token, offset, token[offset]);
             return TYPE_NONE;
     }
 }
 
-static int extract_data_width(bo_context* context, uint8_t* token, int offset)
+static int extract_data_width(bo_context* context, const uint8_t* token, int token_length, int offset)
 {
-    if(token + offset >= buffer_get_end(&context->src_buffer))
+    if(offset >= token_length)
     {
-        bo_notify_error(context, "%s: offset %d: Missing data width", token, offset);
+        bo_notify_error(context, "%.*s: offset %d: Missing data width", token_length, token, offset);
         return 0;
     }
     switch(token[offset])
     {
         case '1':
-            switch(token[offset + 1])
+            switch(offset + 1 < token_length ? token[offset + 1] : 0)
             {
                 case '6':
                     return 16;
                 case '0': case '1': case '2': case '3': case '4': case '5':
                 case '7': case '8': case '9':
                 {
-                    unsigned int width = strtoul((char*)token + offset, NULL, 16);
-                    bo_notify_error(context, "%s: offset %d: %d is not a valid data width", token, offset, width);
+                    int width = get_decimal_value(token, token_length, offset);
+                    bo_notify_error(context, "%.*s: offset %d: %d is not a valid data width", token_length, token, offset, width);
                     return 0;
                 }
                 default:
@@ -181,21 +211,21 @@ static int extract_data_width(bo_context* context, uint8_t* token, int offset)
             return 8;
         case '0': case '3': case '5': case '6': case '7': case '9':
         {
-            unsigned int width = strtoul((char*)token + offset, NULL, 10);
-            bo_notify_error(context, "%s: offset %d: %d is not a valid data width", token, offset, width);
+            int width = get_decimal_value(token, token_length, offset);
+            bo_notify_error(context, "%.*s: offset %d: %d is not a valid data width", token_length, token, offset, width);
             return 0;
         }
         default:
-            bo_notify_error(context, "%s: offset %d: Not a valid data width", token, offset);
+            bo_notify_error(context, "%.*s: offset %d: Not a valid data width", token_length, token, offset);
             return 0;
     }
 }
 
-static bo_endianness extract_endianness(bo_context* context, uint8_t* token, int offset)
+static bo_endianness extract_endianness(bo_context* context, const uint8_t* token, int token_length, int offset)
 {
-    if(token + offset >= buffer_get_end(&context->src_buffer))
+    if(offset >= token_length)
     {
-        bo_notify_error(context, "%s: offset %d: Missing endianness", token, offset);
+        bo_notify_error(context, "%.*s: offset %d: Missing endianness", token_length, token, offset);
         return BO_ENDIAN_NONE;
     }
 
@@ -206,37 +236,208 @@ static bo_endianness extract_endianness(bo_context* context, uint8_t* token, int
         case 'l':
             return BO_ENDIAN_LITTLE;
         default:
-            bo_notify_error(context, "%s: offset %d: %c is not a valid endianness", token, offset, token[offset]);
+            bo_notify_error(context, "%.*s: offset %d: %c is not a valid endianness", token_length, token, offset, token[offset]);
             return BO_ENDIAN_NONE;
     }
 }
 
 
 
+// --------------
+// Token Scanning
+// --------------
+
+// The source is scanned in 64-byte blocks (counted from the start of the source buffer), each
+// classified into a bitmap with one bit per whitespace byte. Finding a token boundary is then a
+// shift and a count of trailing zeros on the bitmap of the current block, which stays cached in
+// the context until the scan moves on to another block.
+//
+// Bytes are classified using the nibble lookup tables in character_flags.h, which are generated
+// from the same flags that is_whitespace_character() uses.
+//
+// The source is never modified, so a cached bitmap stays valid for as long as the source buffer
+// does.
+
+#define TOKEN_SCAN_BLOCK_SIZE 64
+
+static inline uint64_t get_whitespace_bitmap_scalar(const uint8_t* block)
+{
+    uint64_t bitmap = 0;
+    for(int i = 0; i < TOKEN_SCAN_BLOCK_SIZE; i++)
+    {
+        bitmap |= (uint64_t)(is_whitespace_character(block[i]) ? 1 : 0) << i;
+    }
+    return bitmap;
+}
+
+#if BO_HAS_X86_SIMD
+BO_TARGET("ssse3")
+static uint64_t get_whitespace_bitmap_ssse3(const uint8_t* block)
+{
+    const __m128i low_nibbles = _mm_loadu_si128((const __m128i*)g_whitespace_low_nibbles);
+    const __m128i high_nibbles = _mm_loadu_si128((const __m128i*)g_whitespace_high_nibbles);
+    const __m128i nybble_mask = _mm_set1_epi8(0x0f);
+    uint64_t bitmap = 0;
+    for(int i = 0; i < TOKEN_SCAN_BLOCK_SIZE; i += 16)
+    {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(block + i));
+        __m128i low = _mm_shuffle_epi8(low_nibbles, _mm_and_si128(bytes, nybble_mask));
+        __m128i high = _mm_shuffle_epi8(high_nibbles, _mm_and_si128(_mm_srli_epi16(bytes, 4), nybble_mask));
+        __m128i is_not_whitespace = _mm_cmpeq_epi8(_mm_and_si128(low, high), _mm_setzero_si128());
+        bitmap |= (uint64_t)(_mm_movemask_epi8(is_not_whitespace) ^ 0xffff) << i;
+    }
+    return bitmap;
+}
+
+BO_TARGET("avx2")
+static uint64_t get_whitespace_bitmap_avx2(const uint8_t* block)
+{
+    const __m256i low_nibbles = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)g_whitespace_low_nibbles));
+    const __m256i high_nibbles = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)g_whitespace_high_nibbles));
+    const __m256i nybble_mask = _mm256_set1_epi8(0x0f);
+    uint64_t bitmap = 0;
+    for(int i = 0; i < TOKEN_SCAN_BLOCK_SIZE; i += 32)
+    {
+        __m256i bytes = _mm256_loadu_si256((const __m256i*)(block + i));
+        __m256i low = _mm256_shuffle_epi8(low_nibbles, _mm256_and_si256(bytes, nybble_mask));
+        __m256i high = _mm256_shuffle_epi8(high_nibbles, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nybble_mask));
+        __m256i is_not_whitespace = _mm256_cmpeq_epi8(_mm256_and_si256(low, high), _mm256_setzero_si256());
+        bitmap |= (uint64_t)~(uint32_t)_mm256_movemask_epi8(is_not_whitespace) << i;
+    }
+    return bitmap;
+}
+#endif
+
+static uint64_t get_whitespace_bitmap(const uint8_t* block)
+{
+#if BO_HAS_X86_SIMD
+    if(cpu_has_avx2())
+    {
+        return get_whitespace_bitmap_avx2(block);
+    }
+    if(cpu_has_ssse3())
+    {
+        return get_whitespace_bitmap_ssse3(block);
+    }
+#endif
+    return get_whitespace_bitmap_scalar(block);
+}
+
+static inline void reset_token_scan(bo_context* context)
+{
+    context->token_scan.block = NULL;
+}
+
+/**
+ * Get ptr's offset into the cached block. This wraps around to a huge value if ptr is before
+ * the block, so anything outside of it (or no cached block at all) fails a single range check.
+ */
+static inline uintptr_t get_token_scan_offset(bo_context* context, const uint8_t* ptr)
+{
+    return (uintptr_t)ptr - (uintptr_t)context->token_scan.block;
+}
+
+/**
+ * Classify the block that ptr is in, and make it the cached block.
+ *
+ * @param context The context.
+ * @param ptr A position in the source buffer.
+ * @return false if the block runs past the end of the source buffer (and must be scanned byte by byte).
+ */
+static bool load_token_scan_block(bo_context* context, const uint8_t* ptr)
+{
+    const uint8_t* start = buffer_get_start(&context->src_buffer);
+    const uint8_t* block = start + ((ptr - start) & ~(TOKEN_SCAN_BLOCK_SIZE - 1));
+    if(block + TOKEN_SCAN_BLOCK_SIZE > buffer_get_end(&context->src_buffer))
+    {
+        return false;
+    }
+    context->token_scan.block = block;
+    context->token_scan.whitespace = get_whitespace_bitmap(block);
+    return true;
+}
+
+/**
+ * Find the first whitespace character at or after ptr.
+ *
+ * @param context The context.
+ * @param ptr Where to start looking.
+ * @return Pointer to the first whitespace character, or the end of the source buffer if there is none.
+ */
+static inline const uint8_t* find_whitespace(bo_context* context, const uint8_t* ptr)
+{
+    for(;;)
+    {
+        if(get_token_scan_offset(context, ptr) >= TOKEN_SCAN_BLOCK_SIZE && !load_token_scan_block(context, ptr))
+        {
+            break;
+        }
+        // Bits shifted in from past the end of the block are 0, so they never count as a match.
+        uint64_t bits = context->token_scan.whitespace >> get_token_scan_offset(context, ptr);
+        if(bits != 0)
+        {
+            return ptr + __builtin_ctzll(bits);
+        }
+        ptr = context->token_scan.block + TOKEN_SCAN_BLOCK_SIZE;
+    }
+    const uint8_t* const end = buffer_get_end(&context->src_buffer);
+    while(ptr < end && !is_whitespace_character(*ptr))
+    {
+        ptr++;
+    }
+    return ptr;
+}
+
+/**
+ * Skip over a run of whitespace starting at ptr.
+ *
+ * @param context The context.
+ * @param ptr Where to start looking.
+ * @return Pointer to the first non-whitespace character, or the end of the source buffer if there is none.
+ */
+static inline const uint8_t* skip_whitespace(bo_context* context, const uint8_t* ptr)
+{
+    for(;;)
+    {
+        if(get_token_scan_offset(context, ptr) >= TOKEN_SCAN_BLOCK_SIZE && !load_token_scan_block(context, ptr))
+        {
+            break;
+        }
+        uint64_t bits = ~context->token_scan.whitespace >> get_token_scan_offset(context, ptr);
+        if(bits != 0)
+        {
+            return ptr + __builtin_ctzll(bits);
+        }
+        ptr = context->token_scan.block + TOKEN_SCAN_BLOCK_SIZE;
+    }
+    const uint8_t* const end = buffer_get_end(&context->src_buffer);
+    while(ptr < end && is_whitespace_character(*ptr))
+    {
+        ptr++;
+    }
+    return ptr;
+}
+
+
+
 // ---------------
 // General Parsing
 // ---------------
 
 /**
- * Terminate the token pointed to by the src buffer.
- * THIS FUNCTION MODIFIES MEMORY!
+ * Find the end of the token pointed to by the src buffer.
  *
- * Reads until the first whitespace and replaces the whitespace with null termination.
- * If no whitespace is encountered, and we're mid stream, ends parsing.
+ * Reads until the first whitespace. If no whitespace is encountered, and we're mid stream, ends parsing.
  *
  * @param context The context.
  * @return Pointer to one past the end of the token.
  */
-static uint8_t* terminate_token(bo_context* context)
+static const uint8_t* find_token_end(bo_context* context)
 {
-    uint8_t* ptr = buffer_get_position(&context->src_buffer);
-    for(; ptr < buffer_get_end(&context->src_buffer); ptr++)
+    const uint8_t* ptr = find_whitespace(context, buffer_get_position(&context->src_buffer));
+    if(ptr < buffer_get_end(&context->src_buffer))
     {
-        if(is_whitespace_character(*ptr))
-        {
-            null_terminate_string(ptr);
-            return ptr;
-        }
+        return ptr;
     }
     context->is_at_end_of_input = true;
     if(context->data_segment_type == DATA_SEGMENT_STREAM)
@@ -246,9 +447,9 @@ static uint8_t* terminate_token(bo_context* context)
     return ptr;
 }
 
-static inline uint8_t* handle_end_of_data(bo_context* context,
-                                          uint8_t* interruption_point,
-                                          const char* error_message)
+static inline const uint8_t* handle_end_of_data(bo_context* context,
+                                                const uint8_t* interruption_point,
+                                                const char* error_message)
 {
     if(is_last_data_segment(context))
     {
@@ -260,138 +461,289 @@ static inline uint8_t* handle_end_of_data(bo_context* context,
     return interruption_point;
 }
 
+static inline int get_hex_digit_value(int ch)
+{
+    return ch <= '9' ? ch - '0' : (ch | 0x20) - 'a' + 10;
+}
+
+static inline int encode_utf8(unsigned int codepoint, uint8_t* bytes)
+{
+    if(codepoint <= 0x7f)
+    {
+        bytes[0] = (uint8_t)codepoint;
+        return 1;
+    }
+    if(codepoint <= 0x7ff)
+    {
+        bytes[0] = (uint8_t)((codepoint >> 6) | 0xc0);
+        bytes[1] = (uint8_t)((codepoint & 0x3f) | 0x80);
+        return 2;
+    }
+    bytes[0] = (uint8_t)((codepoint >> 12) | 0xe0);
+    bytes[1] = (uint8_t)(((codepoint >> 6) & 0x3f) | 0x80);
+    bytes[2] = (uint8_t)((codepoint & 0x3f) | 0x80);
+    return 3;
+}
+
 /**
- * Parse a string. The input string must begin and end with double quotes (").
- * THIS FUNCTION MODIFIES MEMORY!
- *
- * The string may contain escape sequences, which will be converted to the values they represent.
- * Upon successful completion, the memory at pointer string will contain an unescaped, unquoted,
- * null terminated string.
+ * Decode the escape sequence starting at escape_pos (which points to the backslash).
  *
  * @param context The context.
- * @param string The string to parse.
- * @return A pointer to the end of the string, or NULL if an error occurred.
+ * @param escape_pos The start of the escape sequence.
+ * @param end The end of the source data.
+ * @param bytes Gets the decoded bytes (up to 3).
+ * @param escape_end Gets a pointer to one past the end of the escape sequence.
+ * @return The number of decoded bytes, or -1 if parsing stopped (because the escape sequence is
+ *         invalid, or it might continue in the next data segment).
  */
-static uint8_t* parse_string(bo_context* context, int offset)
+static int parse_escape_sequence(bo_context* context,
+                                 const uint8_t* escape_pos,
+                                 const uint8_t* end,
+                                 uint8_t* bytes,
+                                 const uint8_t** escape_end)
 {
-    uint8_t* string = buffer_get_position(&context->src_buffer) + offset;
-    uint8_t* write_pos = string;
-    uint8_t* read_pos = string;
-    uint8_t* read_end = buffer_get_end(&context->src_buffer);
+    const uint8_t* pos = escape_pos + 1;
+    if(pos >= end)
+    {
+        handle_end_of_data(context, escape_pos, "Unterminated escape sequence");
+        return -1;
+    }
 
-    for(; read_pos < read_end; read_pos++)
+    *escape_end = pos + 1;
+    switch(*pos)
     {
-        switch(*read_pos)
+        case 'r': bytes[0] = '\r'; return 1;
+        case 'n': bytes[0] = '\n'; return 1;
+        case 't': bytes[0] = '\t'; return 1;
+        case '\\': bytes[0] = '\\'; return 1;
+        case '\"': bytes[0] = '\"'; return 1;
+        case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7':
         {
-            case '"':
-                null_terminate_string(write_pos);
-                buffer_set_position(&context->src_buffer, read_pos);
-                return write_pos;
-            case '\\':
+            // Up to 3 digits
+            const uint8_t* digits_end = pos + 3;
+            unsigned int value = 0;
+            for(; pos < digits_end && pos < end && is_octal_character(*pos); pos++)
             {
-                uint8_t* escape_pos = read_pos;
-                int remaining_bytes = read_end - read_pos;
-                if(remaining_bytes < 1)
-                {
-                    return handle_end_of_data(context, escape_pos, "Unterminated escape sequence");
-                }
-
-                read_pos++;
-                switch(*read_pos)
+                value = value * 8 + *pos - '0';
+            }
+            if(pos < digits_end && pos == end)
+            {
+                handle_end_of_data(context, escape_pos, "Unterminated escape sequence");
+                return -1;
+            }
+            bytes[0] = (uint8_t)value;
+            *escape_end = pos;
+            return 1;
+        }
+        case 'x':
+        {
+            // 1 or 2 digits
+            pos++;
+            if(pos >= end)
+            {
+                handle_end_of_data(context, escape_pos, "Unterminated hex escape sequence");
+                return -1;
+            }
+            if(!is_hex_character(*pos))
+            {
+                bo_notify_error(context, "Invalid hex escape sequence");
+                return -1;
+            }
+            unsigned int value = get_hex_digit_value(*pos++);
+            if(pos >= end)
+            {
+                handle_end_of_data(context, escape_pos, "Unterminated hex escape sequence");
+                return -1;
+            }
+            if(is_hex_character(*pos))
+            {
+                value = value * 16 + get_hex_digit_value(*pos++);
+            }
+            bytes[0] = (uint8_t)value;
+            *escape_end = pos;
+            return 1;
+        }
+        case 'u':
+        {
+            // Exactly 4 digits
+            if(end - pos < 5)
+            {
+                handle_end_of_data(context, escape_pos, "Unterminated unicode escape sequence");
+                return -1;
+            }
+            unsigned int codepoint = 0;
+            for(int i = 1; i <= 4; i++)
+            {
+                if(!is_hex_character(pos[i]))
                 {
-                    case 'r': *write_pos++ = '\r'; break;
-                    case 'n': *write_pos++ = '\n'; break;
-                    case 't': *write_pos++ = '\t'; break;
-                    case '\\': *write_pos++ = '\\'; break;
-                    case '\"': *write_pos++ = '\"'; break;
-                    case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7':
-                    {
-                        uint8_t number_buffer[4] = {*read_pos, 0, 0, 0};
-                        read_pos++;
-                        if(is_octal_character(*read_pos))
-                        {
-                            number_buffer[1] = *read_pos;
-                            read_pos++;
-                        }
-                        if(is_octal_character(*read_pos))
-                        {
-                            number_buffer[2] = *read_pos;
-                            read_pos++;
-                        }
-                        *write_pos++ = (uint8_t)strtoul((char*)number_buffer, NULL, 8);
-                        read_pos--;
-                        break;
-                    }
-                    case 'x':
-                    {
-                        if(remaining_bytes < 2)
-                        {
-                            return handle_end_of_data(context, escape_pos, "Unterminated hex escape sequence");
-                        }
-                        read_pos++;
-                        if(!is_hex_character(*read_pos))
-                        {
-                            bo_notify_error(context, "Invalid hex escape sequence");
-                            return NULL;
-                        }
-                        uint8_t number_buffer[3] = {*read_pos, 0, 0};
-                        read_pos += 1;
-                        if(is_hex_character(*read_pos))
-                        {
-                            number_buffer[1] = *read_pos;
-                            read_pos += 1;
-                        }
-                        *write_pos++ = (uint8_t)strtoul((char*)number_buffer, NULL, 16);
-                        read_pos--;
-                        break;
-                    }
-                    case 'u':
-                    {
-                        if(remaining_bytes < 5)
-                        {
-                            return handle_end_of_data(context, escape_pos, "Unterminated unicode escape sequence");
-                        }
-                        if(!is_hex_character(read_pos[1])
-                        || !is_hex_character(read_pos[2])
-                        || !is_hex_character(read_pos[3])
-                        || !is_hex_character(read_pos[4]))
-                        {
-                            bo_notify_error(context, "Invalid unicode escape sequence");
-                            return NULL;
-                        }
-                        uint8_t number_buffer[5] = {read_pos[1], read_pos[2], read_pos[3], read_pos[4], 0};
-                        read_pos += 4;
-                        unsigned int codepoint = strtoul((char*)number_buffer, NULL, 16);
-                        if(codepoint <= 0x7f)
-                        {
-                            *write_pos++ = (uint8_t)codepoint;
-                        }
-                        else if(codepoint <= 0x7ff)
-                        {
-                            *write_pos++ = (uint8_t)((codepoint >> 6) | 0xc0);
-                            *write_pos++ = (uint8_t)((codepoint & 0x3f) | 0x80);
-                        }
-                        else
-                        {
-                            *write_pos++ = (uint8_t)((codepoint >> 12) | 0xe0);
-                            *write_pos++ = (uint8_t)(((codepoint >> 6) & 0x3f) | 0x80);
-                            *write_pos++ = (uint8_t)((codepoint & 0x3f) | 0x80);
-                        }
-                        break;
-                    }
-                    default:
-                        bo_notify_error(context, "Invalid escape sequence");
-                        return NULL;
+                    bo_notify_error(context, "Invalid unicode escape sequence");
+                    return -1;
                 }
-                break;
+                codepoint = codepoint * 16 + get_hex_digit_value(pos[i]);
             }
-            default:
-                *write_pos++ = *read_pos;
-                break;
+            *escape_end = pos + 5;
+            return encode_utf8(codepoint, bytes);
+        }
+        default:
+            bo_notify_error(context, "Invalid escape sequence");
+            return -1;
+    }
+}
+
+// Strings are scanned for the next quote or backslash a vector at a time. Everything before it
+// is a plain run that gets copied as a block.
+
+static inline const uint8_t* find_string_delimiter_scalar(const uint8_t* ptr, const uint8_t* end)
+{
+    while(ptr < end && *ptr != '"' && *ptr != '\\')
+    {
+        ptr++;
+    }
+    return ptr;
+}
+
+#if BO_HAS_X86_SIMD
+BO_TARGET("ssse3")
+static const uint8_t* find_string_delimiter_ssse3(const uint8_t* ptr, const uint8_t* end)
+{
+    const __m128i quotes = _mm_set1_epi8('"');
+    const __m128i backslashes = _mm_set1_epi8('\\');
+    for(; end - ptr >= 16; ptr += 16)
+    {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)ptr);
+        __m128i is_delimiter = _mm_or_si128(_mm_cmpeq_epi8(bytes, quotes), _mm_cmpeq_epi8(bytes, backslashes));
+        int bits = _mm_movemask_epi8(is_delimiter);
+        if(bits != 0)
+        {
+            return ptr + __builtin_ctz(bits);
+        }
+    }
+    return find_string_delimiter_scalar(ptr, end);
+}
+
+BO_TARGET("avx2")
+static const uint8_t* find_string_delimiter_avx2(const uint8_t* ptr, const uint8_t* end)
+{
+    const __m256i quotes = _mm256_set1_epi8('"');
+    const __m256i backslashes = _mm256_set1_epi8('\\');
+    // Two vectors per iteration, since runs are usually long.
+    for(; end - ptr >= 64; ptr += 64)
+    {
+        __m256i bytes_0 = _mm256_loadu_si256((const __m256i*)ptr);
+        __m256i bytes_1 = _mm256_loadu_si256((const __m256i*)(ptr + 32));
+        __m256i is_delimiter_0 = _mm256_or_si256(_mm256_cmpeq_epi8(bytes_0, quotes), _mm256_cmpeq_epi8(bytes_0, backslashes));
+        __m256i is_delimiter_1 = _mm256_or_si256(_mm256_cmpeq_epi8(bytes_1, quotes), _mm256_cmpeq_epi8(bytes_1, backslashes));
+        uint64_t bits = (uint32_t)_mm256_movemask_epi8(is_delimiter_0)
+                      | (uint64_t)(uint32_t)_mm256_movemask_epi8(is_delimiter_1) << 32;
+        if(bits != 0)
+        {
+            return ptr + __builtin_ctzll(bits);
+        }
+    }
+    for(; end - ptr >= 32; ptr += 32)
+    {
+        __m256i bytes = _mm256_loadu_si256((const __m256i*)ptr);
+        __m256i is_delimiter = _mm256_or_si256(_mm256_cmpeq_epi8(bytes, quotes), _mm256_cmpeq_epi8(bytes, backslashes));
+        uint32_t bits = _mm256_movemask_epi8(is_delimiter);
+        if(bits != 0)
+        {
+            return ptr + __builtin_ctz(bits);
+        }
+    }
+    return find_string_delimiter_scalar(ptr, end);
+}
+#endif
+
+/**
+ * Find the first quote or backslash at or after ptr.
+ *
+ * @param ptr Where to start looking.
+ * @param end The end of the data.
+ * @return Pointer to the first quote or backslash, or end if there is none.
+ */
+static const uint8_t* find_string_delimiter(const uint8_t* ptr, const uint8_t* end)
+{
+#if BO_HAS_X86_SIMD
+    if(cpu_has_avx2())
+    {
+        return find_string_delimiter_avx2(ptr, end);
+    }
+    if(cpu_has_ssse3())
+    {
+        return find_string_delimiter_ssse3(ptr, end);
+    }
+#endif
+    return find_string_delimiter_scalar(ptr, end);
+}
+
+/**
+ * Send unescaped string bytes to their destination.
+ */
+static void add_string_bytes(bo_context* context, bo_buffer* destination, const uint8_t* bytes, int length)
+{
+    if(destination == NULL)
+    {
+        if(length > 0)
+        {
+            bo_on_string(context, bytes, bytes + length);
         }
+        return;
     }
+    while(buffer_get_remaining(destination) < length)
+    {
+        if(!buffer_grow(destination))
+        {
+            bo_notify_error(context, "Could not allocate memory for string");
+            return;
+        }
+    }
+    buffer_append_bytes(destination, bytes, length);
+}
 
-    return handle_end_of_data(context, read_pos, "Unterminated string");
+/**
+ * Parse a string. The input string must begin and end with double quotes (").
+ *
+ * The string may contain escape sequences, which will be converted to the values they represent.
+ * The source is not modified. Instead, the unescaped contents are appended to destination, or
+ * if destination is NULL, passed to bo_on_string() piece by piece (runs of plain characters
+ * straight from the source, and the decoded value of each escape sequence).
+ *
+ * Upon successful completion, the src buffer position is on the closing quote. If the string
+ * continues into the next data segment, parsing stops where the next segment must resume from.
+ *
+ * @param context The context.
+ * @param offset Offset from the src buffer position to the first character inside the quotes.
+ * @param destination Where to put the unescaped string, or NULL to add it to the work buffer.
+ */
+static void parse_string(bo_context* context, int offset, bo_buffer* destination)
+{
+    const uint8_t* read_pos = buffer_get_position(&context->src_buffer) + offset;
+    const uint8_t* const read_end = buffer_get_end(&context->src_buffer);
+
+    for(;;)
+    {
+        const uint8_t* run_start = read_pos;
+        read_pos = find_string_delimiter(read_pos, read_end);
+        add_string_bytes(context, destination, run_start, read_pos - run_start);
+        if(is_error_condition(context)) return;
+
+        if(read_pos >= read_end)
+        {
+            handle_end_of_data(context, read_pos, "Unterminated string");
+            return;
+        }
+        if(*read_pos == '"')
+        {
+            set_position(context, read_pos);
+            return;
+        }
+
+        uint8_t bytes[3];
+        int length = parse_escape_sequence(context, read_pos, read_end, bytes, &read_pos);
+        if(length < 0) return;
+        add_string_bytes(context, destination, bytes, length);
+        if(is_error_condition(context)) return;
+    }
 }
 
 
@@ -402,79 +754,94 @@ static uint8_t* parse_string(bo_context* context, int offset)
 
 static void on_unknown_token(bo_context* context)
 {
-    uint8_t* token = buffer_get_position(&context->src_buffer);
-    terminate_token(context);
-    if(!is_at_end_of_input(context))
-    {
-        bo_notify_error(context, "%s: Unknown token", token);
-    }
-
-    int length = buffer_get_end(&context->src_buffer) - token;
-    uint8_t* token_copy = malloc(length + 1);
-    memcpy(token_copy, token, length);
-    null_terminate_string(token_copy + length);
-    bo_notify_error(context, "%s: Unknown token", token_copy);
-    free(token_copy);
+    const uint8_t* token = buffer_get_position(&context->src_buffer);
+    const uint8_t* end = find_token_end(context);
+    if(!should_continue_parsing(context)) return;
+    bo_notify_error(context, "%.*s: Unknown token", (int)(end - token), token);
 }
 
 static void on_string(bo_context* context, int offset)
 {
-    uint8_t* string_start = buffer_get_position(&context->src_buffer) + offset;
-    uint8_t* string_end = parse_string(context, offset);
+    parse_string(context, offset, NULL);
     if(is_error_condition(context)) return;
-    if(string_end > string_start)
-    {
-        bo_on_string(context, string_start, string_end);
-    }
     if(!should_continue_parsing(context))
     {
         context->is_spanning_string = true;
     }
 }
 
-static uint8_t* prefix_suffix_process_common(bo_context* context)
+#define PREFIX_SUFFIX_INITIAL_SIZE 32
+
+/**
+ * Parse the string of a prefix or suffix command.
+ *
+ * @param context The context.
+ * @return A null terminated copy of the unescaped string (to be freed with buffer_free()), or an
+ *         uninitialized buffer if parsing stopped.
+ */
+static bo_buffer parse_prefix_suffix_string(bo_context* context)
 {
-    uint8_t* token = buffer_get_position(&context->src_buffer);
+    const uint8_t* token = buffer_get_position(&context->src_buffer);
+    bo_buffer string = {0};
+    if(token + 1 >= buffer_get_end(&context->src_buffer))
+    {
+        handle_end_of_data(context, token, "Missing prefix/suffix string");
+        return string;
+    }
     if(token[1] != '"')
     {
-        terminate_token(context);
-        bo_notify_error(context, "%s: Not a string", token + 1);
-        return NULL;
+        const uint8_t* end = find_token_end(context);
+        bo_notify_error(context, "%.*s: Not a string", (int)(end - token - 1), token + 1);
+        return string;
     }
 
-    int offset = 2;
-    uint8_t* string = buffer_get_position(&context->src_buffer) + offset;
-    parse_string(context, offset);
+    string = buffer_alloc(PREFIX_SUFFIX_INITIAL_SIZE, PREFIX_SUFFIX_INITIAL_SIZE, 0);
+    if(!buffer_is_initialized(&string))
+    {
+        bo_notify_error(context, "Could not allocate memory for string");
+        return string;
+    }
+    parse_string(context, 2, &string);
+    const uint8_t terminator = 0;
+    if(should_continue_parsing(context))
+    {
+        add_string_bytes(context, &string, &terminator, 1);
+    }
     if(!should_continue_parsing(context))
     {
-        buffer_set_position(&context->src_buffer, token);
+        // Try again from the start of the command once the rest of the string arrives.
+        stop_parsing_at(context, token);
+        buffer_free(&string);
     }
     return string;
 }
 
 static void on_prefix(bo_context* context)
 {
-    uint8_t* string = prefix_suffix_process_common(context);
+    bo_buffer string = parse_prefix_suffix_string(context);
     if(!should_continue_parsing(context)) return;
-    bo_on_prefix(context, string);
+    bo_on_prefix(context, buffer_get_start(&string));
+    buffer_free(&string);
 }
 
 static void on_suffix(bo_context* context)
 {
-    uint8_t* string = prefix_suffix_process_common(context);
+    bo_buffer string = parse_prefix_suffix_string(context);
     if(!should_continue_parsing(context)) return;
-    bo_on_suffix(context, string);
+    bo_on_suffix(context, buffer_get_start(&string));
+    buffer_free(&string);
 }
 
 static void on_input_type(bo_context* context)
 {
-    uint8_t* end = terminate_token(context);
+    const uint8_t* end = find_token_end(context);
     if(!should_continue_parsing(context)) return;
 
-    uint8_t* token = buffer_get_position(&context->src_buffer);
+    const uint8_t* token = buffer_get_position(&context->src_buffer);
+    const int token_length = end - token;
     int offset = 1;
 
-    bo_data_type data_type = extract_data_type(context, token, offset);
+    bo_data_type data_type = extract_data_type(context, token, token_length, offset);
     if(!should_continue_parsing(context)) return;
     offset += 1;
 
@@ -483,13 +850,13 @@ static void on_input_type(bo_context* context)
 
     if(data_type != TYPE_STRING)
     {
-        data_width = extract_data_width(context, token, offset);
+        data_width = extract_data_width(context, token, token_length, offset);
         if(!should_continue_parsing(context)) return;
         offset += data_width > 8 ? 2 : 1;
 
         if(data_width > 1)
         {
-            endianness = extract_endianness(context, token, offset);
+            endianness = extract_endianness(context, token, token_length, offset);
             if(!should_continue_parsing(context)) return;
         }
     }
@@ -498,46 +865,46 @@ static void on_input_type(bo_context* context)
 
     bo_on_input_type(context, data_type, data_width, endianness);
     if(!should_continue_parsing(context)) return;
-    buffer_set_position(&context->src_buffer, end);
+    set_position(context, end);
 }
 
 static void on_output_type(bo_context* context)
 {
-    uint8_t* end = terminate_token(context);
+    const uint8_t* end = find_token_end(context);
     if(!should_continue_parsing(context)) return;
-    uint8_t* token = buffer_get_position(&context->src_buffer);
-    int token_length = end - token;
+    const uint8_t* token = buffer_get_position(&context->src_buffer);
+    const int token_length = end - token;
     int offset = 1;
 
-    bo_data_type data_type = extract_data_type(context, token, offset);
+    bo_data_type data_type = extract_data_type(context, token, token_length, offset);
     if(!should_continue_parsing(context)) return;
     offset += 1;
 
     int data_width = 1;
-    int print_width = 1;
+    int print_width = PRINT_WIDTH_UNSPECIFIED;
     bo_endianness endianness = BO_ENDIAN_NONE;
 
     if(data_type != TYPE_STRING)
     {
-        data_width = extract_data_width(context, token, offset);
+        data_width = extract_data_width(context, token, token_length, offset);
         if(!should_continue_parsing(context)) return;
         offset += data_width > 8 ? 2 : 1;
 
         if(data_width > 1 || data_type == TYPE_BOOLEAN || token_length > offset)
         {
-            endianness = extract_endianness(context, token, offset);
+            endianness = extract_endianness(context, token, token_length, offset);
             if(!should_continue_parsing(context)) return;
             offset += 1;
 
-            if(data_type != TYPE_BINARY && token + offset < end)
+            if(data_type != TYPE_BINARY && offset < token_length)
             {
                 if(!is_decimal_character(token[offset]))
                 {
-                    bo_notify_error(context, "%s: offset %d: Not a valid print width", token, offset);
+                    bo_notify_error(context, "%.*s: offset %d: Not a valid print width", token_length, token, offset);
                     return;
                 }
 
-                print_width = strtoul((char*)token + offset, NULL, 10);
+                print_width = get_decimal_value(token, token_length, offset);
             }
         }
     }
@@ -546,29 +913,38 @@ static void on_output_type(bo_context* context)
 
     bo_on_output_type(context, data_type, data_width, endianness, print_width);
     if(!should_continue_parsing(context)) return;
-    buffer_set_position(&context->src_buffer, end);
+    set_position(context, end);
 }
 
 static void on_preset(bo_context* context)
 {
-    uint8_t* end = terminate_token(context);
+    const uint8_t* end = find_token_end(context);
     if(!should_continue_parsing(context)) return;
 
-    uint8_t* token = buffer_get_position(&context->src_buffer);
-    bo_on_preset(context, token + 1);
+    const uint8_t* token = buffer_get_position(&context->src_buffer);
+    bo_on_preset(context, token + 1, end - token - 1);
     if(!should_continue_parsing(context)) return;
-    buffer_set_position(&context->src_buffer, end);
+    set_position(context, end);
 }
 
 static void on_number(bo_context* context)
 {
-    uint8_t* end = terminate_token(context);
+    const uint8_t* run_start = buffer_get_position(&context->src_buffer);
+    const uint8_t* run_end = bo_on_number_run(context, run_start, buffer_get_end(&context->src_buffer));
+    if(run_end > run_start)
+    {
+        // Land on the last character of the run, since the loop steps past it.
+        set_position(context, run_end - 1);
+        return;
+    }
+
+    const uint8_t* end = find_token_end(context);
     if(!should_continue_parsing(context)) return;
 
-    uint8_t* token = buffer_get_position(&context->src_buffer);
-    bo_on_number(context, token);
+    const uint8_t* token = buffer_get_position(&context->src_buffer);
+    bo_on_number(context, token, end - token);
     if(!should_continue_parsing(context)) return;
-    buffer_set_position(&context->src_buffer, end);
+    set_position(context, end);
 }
 
 
@@ -577,15 +953,9 @@ static void on_number(bo_context* context)
 // Parse API
 // ---------
 
-char* bo_process(void* void_context, char* data, int data_length, bo_data_segment_type data_segment_type)
+const char* bo_process_const(void* void_context, const char* data, int data_length, bo_data_segment_type data_segment_type)
 {
-    if(BO_ENABLE_LOGGING)
-    {
-        char ch = data[data_length];
-        data[data_length] = 0;
-        LOG("bo_process [%s]", data);
-        data[data_length] = ch;
-    }
+    LOG("bo_process [%.*s]", data_length, data);
 
     if(data_length < 1)
     {
@@ -593,14 +963,17 @@ char* bo_process(void* void_context, char* data, int data_length, bo_data_segmen
         return data;
     }
 
+    // The source buffer is only ever read from.
     bo_context* context = (bo_context*)void_context;
     context->src_buffer.start = context->src_buffer.pos = (uint8_t*)data;
     context->src_buffer.end = context->src_buffer.start + data_length;
+    reset_token_scan(context);
 
     if(context->input.data_type == TYPE_BINARY)
     {
+        context->data_segment_type = data_segment_type;
         bo_on_bytes(context, context->src_buffer.start, data_length);
-        return (char*)buffer_get_end(&context->src_buffer);
+        return (const char*)buffer_get_end(&context->src_buffer);
     }
 
     context->data_segment_type = data_segment_type;
@@ -612,6 +985,11 @@ char* bo_process(void* void_context, char* data, int data_length, bo_data_segmen
     {
         context->is_spanning_string = false;
         on_string(context, 0);
+        if(!should_continue_parsing(context))
+        {
+            return is_error_condition(context) ? NULL : (const char*)buffer_get_position(&context->src_buffer);
+        }
+        // Step past the closing quote.
         context->src_buffer.pos++;
     }
 
@@ -620,10 +998,10 @@ char* bo_process(void* void_context, char* data, int data_length, bo_data_segmen
     {
         switch(*context->src_buffer.pos)
         {
-            case '\n':
+            case ' ': case '\t': case '\n': case '\v': case '\f': case '\r':
                 // TODO: Line count
-                break;
-            case ' ': case '\t': case '\r':
+                // Land on the last whitespace character, since the loop steps past it.
+                set_position(context, skip_whitespace(context, context->src_buffer.pos + 1) - 1);
                 break;
             case '"':
                 on_string(context, 1);
@@ -667,5 +1045,10 @@ char* bo_process(void* void_context, char* data, int data_length, bo_data_segmen
     {
         return NULL;
     }
-    return (char*)buffer_get_position(&context->src_buffer);
+    return (const char*)buffer_get_position(&context->src_buffer);
+}
+
+char* bo_process(void* context, char* data, int data_length, bo_data_segment_type data_segment_type)
+{
+    return (char*)bo_process_const(context, data, data_length, data_segment_type);
 }
@@ -0,0 +1,72 @@
+#include "test_helpers.h"
+
+TEST(BO_Binary, input_2_be)
+{
+    assert_binary_conversion("oh2l4 Ps iB2b", "\x01\x02\x03\x04", 4, 4, "0102 0304");
+    assert_binary_conversion("oh2l4 Ps iB2b", "\x01\x02\x03\x04", 4, 1, "0102 0304");
+    assert_binary_conversion("oh2l4 Ps iB2b", "\x01\x02\x03", 3, 3, "0102 0300");
+}
+
+TEST(BO_Binary, input_4_be_spanning)
+{
+    assert_binary_conversion("oh4l8 Ps iB4b", "\x01\x02\x03\x04\x05\x06\x07\x08", 8, 3, "01020304 05060708");
+}
+
+TEST(BO_Binary, input_8_be)
+{
+    assert_binary_conversion("oh8l16 Ps iB8b", "\x01\x02\x03\x04\x05\x06\x07\x08", 8, 5, "0102030405060708");
+}
+
+TEST(BO_Binary, input_2_be_long)
+{
+    char data[4000];
+    std::string expected;
+    for(int i = 0; i < (int)sizeof(data); i += 2)
+    {
+        data[i] = 0x12;
+        data[i + 1] = 0x34;
+        expected += i == 0 ? "1234" : " 1234";
+    }
+    assert_binary_conversion("oh2l4 Ps iB2b", data, sizeof(data), 999, expected.c_str());
+}
+
+TEST(BO_Binary, output_swapped)
+{
+    assert_conversion("oB2b ih2l 4142 4344", "ABCD");
+    assert_conversion("oB2l ih2l 4142 4344", "BADC");
+    assert_conversion("oB4b ih4l 41424344", "ABCD");
+    assert_conversion("oB8b ih8l 4142434445464748", "ABCDEFGH");
+}
+
+TEST(BO_Binary, round_trip)
+{
+    assert_binary_conversion("oB2b iB2b", "ABCD", 4, 3, "ABCD");
+    assert_binary_conversion("oB2l iB2b", "ABCD", 4, 3, "BADC");
+    assert_binary_conversion("oB4l iB4b", "ABCDEFGH", 8, 5, "DCBAHGFE");
+}
+
+TEST(BO_Binary, passthrough)
+{
+    assert_binary_conversion("oB1 iB1", "hello", 5, 2, "hello");
+    assert_binary_conversion("oB2l iB2l", "ABCDE", 5, 5, "ABCDE");
+    assert_binary_conversion("oB4l iB2b", "ABCDEFGH", 8, 3, "BADCFEHG");
+    assert_binary_conversion("oB4b iB2b", "ABCDEFGH", 8, 3, "CDABGHEF");
+}
+
+TEST(BO_Binary, passthrough_swapped_long)
+{
+    char data[4000];
+    std::string expected;
+    for(int i = 0; i < (int)sizeof(data); i += 8)
+    {
+        for(int j = 0; j < 8; j++)
+        {
+            data[i + j] = 'a' + (i / 8 + j) % 26;
+        }
+        for(int j = 7; j >= 0; j--)
+        {
+            expected += data[i + j];
+        }
+    }
+    assert_binary_conversion("oB8b iB1", data, sizeof(data), 7, expected.c_str());
+}
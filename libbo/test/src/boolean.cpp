@@ -7,3 +7,18 @@ TEST(BO_Boolean, boolean)
     assert_conversion("ob2b1 ib2l 1011", "0000101100000000");
     assert_conversion("ob2l1 ib2b 1011", "0000000011010000");
 }
+
+TEST(BO_Boolean, padding)
+{
+    assert_conversion("ob1b20 ib1 101", "00000000000000000101");
+    assert_conversion("ob1l20 ib1 101", "00000000000010100000");
+}
+
+TEST(BO_Boolean, widths)
+{
+    assert_binary_conversion("ob1b Ps iB1", "\x01\x80", 2, 2, "00000001 10000000");
+    assert_binary_conversion("ob1l Ps iB1", "\x01\x80", 2, 2, "10000000 00000001");
+    assert_binary_conversion("ob4b iB1", "\x81\x42\x24\x18", 4, 4, "10000001010000100010010000011000");
+    assert_binary_conversion("ob16l iB1", "\x01\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x80", 16, 16,
+        "10000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000001");
+}
@@ -61,3 +61,68 @@ TEST(BO_Config, preset)
     assert_conversion("Pc", "");
     assert_conversion("Ps", "");
 }
+
+TEST(BO_Config, context_options)
+{
+    std::string input = "oh2b4 Ps ih2b";
+    std::string expected;
+    for(int i = 0; i < 500; i++)
+    {
+        input += " 1234";
+        expected += i == 0 ? "1234" : " 1234";
+    }
+
+    bo_context_options options = {};
+    assert_conversion_with_options(NULL, input.c_str(), expected.c_str());
+    assert_conversion_with_options(&options, input.c_str(), expected.c_str());
+
+    options.work_buffer_size = 16;
+    options.output_buffer_size = 8;
+    assert_conversion_with_options(&options, input.c_str(), expected.c_str());
+
+    options.work_buffer_size = 1 << 20;
+    options.work_buffer_high_water = 1000;
+    options.output_buffer_size = 1 << 22;
+    options.output_buffer_high_water = 100;
+    options.buffer_alignment = 64;
+    assert_conversion_with_options(&options, input.c_str(), expected.c_str());
+}
+
+TEST(BO_Config, tiny_buffers_with_wide_entries)
+{
+    bo_context_options options = {};
+    options.work_buffer_size = 16;
+    options.output_buffer_size = 8;
+    assert_conversion_with_options(&options, "of8l20 if8l Ps 1e22 -0.5",
+        "10000000000000000000000.00000000000000000000 -0.50000000000000000000");
+    assert_conversion_with_options(&options, "of8l20 if8l Ps 1 1e300",
+        "1.00000000000000000000 1000000000000000052504760255204420248704468581108159154915854115511802457988908195786371375080447864043704443832883878176942523235360430575644792184786706982848387200926575803737830233794788090059368953234970799945081119038967640880074652742780142494579258788820056842838115669472196386865459400540160.00000000000000000000");
+}
+
+TEST(BO_Config, program_with_entries_larger_than_its_buffer)
+{
+    std::string prefix(20000, 'x');
+    std::string commands = "oh1l2 ih1l p\"" + prefix + "\"";
+    void* program = compile_program(commands.c_str());
+    assert_program_conversion(program, "12 34", 5, (prefix + "12" + prefix + "34").c_str());
+    bo_destroy_program(program);
+}
+
+TEST(BO_Config, invalid_context_options)
+{
+    bo_context_options options = {};
+    options.work_buffer_size = 15;
+    assert_invalid_options(&options);
+
+    options = {};
+    options.work_buffer_high_water = 2000;
+    assert_invalid_options(&options);
+
+    options = {};
+    options.output_buffer_size = -1;
+    assert_invalid_options(&options);
+
+    options = {};
+    options.buffer_alignment = 48;
+    assert_invalid_options(&options);
+}
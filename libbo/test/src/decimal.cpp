@@ -0,0 +1,26 @@
+#include "test_helpers.h"
+
+TEST(BO_Decimal, decimal32)
+{
+    assert_conversion("od4l id4l Ps 1.50 -0.00 123e5 1e-7 1234567e90 1e97", "1.50 -0.00 1.23e+7 1e-7 1.234567e+96 inf");
+    assert_conversion("oh4b8 Ps id4b 1.5 9999999.5 1e-102", "3200000f 330f4240 00000000");
+}
+
+TEST(BO_Decimal, decimal64)
+{
+    assert_conversion("od8b id8b Ps 19.99 0.000001 0.0000001 1e384 9999999999999999.5", "19.99 0.000001 1e-7 1.000000000000000e+384 1.000000000000000e+16");
+    assert_conversion("oh1l2 Ps id8l 1.5 id8b 1.5", "0f 00 00 00 00 00 a0 31 31 a0 00 00 00 00 00 0f");
+}
+
+TEST(BO_Decimal, decimal128)
+{
+    assert_conversion("od16l id16l Ps 3.1415926535897932384626433832795028841 -1e-6176 1e6145",
+        "3.141592653589793238462643383279503 -1e-6176 inf");
+    assert_conversion("oh16b32 Ps id16b 1.5", "303e000000000000000000000000000f");
+}
+
+TEST(BO_Decimal, fixed)
+{
+    assert_conversion("od16b2 id16b Ps 2.345 2.355 -0.005 1e3", "2.34 2.36 -0.00 1000.00");
+    assert_conversion("od8l0 id8l Ps 0.5 1.5 2.5 0.51", "0 2 2 1");
+}
@@ -15,6 +15,11 @@ TEST(BO_Errors, bad_dst_width)
     assert_failed_conversion(3, "oh9l10 ii1l");
 }
 
+TEST(BO_Errors, bad_bfloat_width)
+{
+    assert_failed_conversion(3, "oF4l iF2l 1");
+}
+
 TEST(BO_Errors, no_input_or_output_config)
 {
     assert_failed_conversion(1000, "1 2 3 4");
@@ -29,3 +34,35 @@ TEST(BO_Errors, no_output_config)
 {
     assert_failed_conversion(1000, "ii1l 1 2 3 4");
 }
+
+TEST(BO_Errors, int_out_of_range)
+{
+    assert_failed_conversion(1000, "oh1l ii1l 256");
+    assert_failed_conversion(1000, "oh1l ii1l -129");
+    assert_failed_conversion(1000, "oh1l ih2l 10000");
+    assert_failed_conversion(1000, "oh1l ii16l 340282366920938463463374607431768211456");
+}
+
+TEST(BO_Errors, invalid_number)
+{
+    assert_failed_conversion(1000, "oh1l ii1l 12x");
+    assert_failed_conversion(1000, "oh1l io1l 8");
+    assert_failed_conversion(1000, "oh1l ib1l 2");
+    assert_failed_conversion(1000, "oh1l if8l 1.5.2");
+}
+
+TEST(BO_Errors, failed_output)
+{
+    // Once the output fails, the work buffer stays full while more data keeps coming in.
+    bo_context_options options = {};
+    options.work_buffer_size = 64;
+    options.output_buffer_size = 64;
+    char data[1001];
+    for(int i = 0; i < (int)sizeof(data); i++)
+    {
+        data[i] = (char)i;
+    }
+    assert_failed_output(&options, "oh1l2 Ps iB1", data, sizeof(data), sizeof(data));
+    assert_failed_output(&options, "oh1l2 Ps iB1", data, sizeof(data), 100);
+    assert_failed_output(&options, "oh2l4 Ps iB2b", data, sizeof(data), 77);
+}
@@ -4,3 +4,63 @@ TEST(BO_Float, float32)
 {
     assert_conversion("of4l3 if4l Ps 1.1 8.5 305.125 2", "1.100 8.500 305.125 2.000");
 }
+
+TEST(BO_Float, float32_shortest)
+{
+    assert_conversion("of4l if4l Ps 1.1 8.5 305.125 2 -0.3 0", "1.1 8.5 305.125 2 -0.3 0");
+    assert_conversion("of4l if4l Ps 3.4028235e38 1e-45 0.000001 0.0000001", "3.4028235e+38 1e-45 0.000001 1e-7");
+}
+
+TEST(BO_Float, float64_shortest)
+{
+    assert_conversion("of8b if8b Ps 0.1 74.125 1e21 123456789012345678 5e-324", "0.1 74.125 1e+21 123456789012345680 5e-324");
+}
+
+TEST(BO_Float, shortest_when_grisu_is_unsure)
+{
+    assert_conversion("of8b ih8b Ps 055410f940ee4435 58e6a434d4df9d0a", "5.397733729656338e-283 1.827057275456638e+120");
+    assert_conversion("of4b ih4b Ps 4e7eb8be 4c4deb3a", "1068380000 53980390");
+    assert_conversion("of2b ih2b Ps 72a2 7000", "13580 8190");
+}
+
+TEST(BO_Float, float64_fixed)
+{
+    assert_conversion("of8l2 if8l Ps 0.125 0.375 -0.001 1e20", "0.12 0.38 -0.00 100000000000000000000.00");
+    assert_conversion("of8l0 if8l Ps 2.5 3.5", "2 4");
+    assert_conversion("of8l20 if8l Ps 1e22", "10000000000000000000000.00000000000000000000");
+}
+
+TEST(BO_Float, float16)
+{
+    assert_conversion("of2l if2l Ps 0.1 1.5 65504 -2 6e-8 1e5", "0.1 1.5 65500 -2 6e-8 inf");
+    assert_conversion("of2b3 if2b Ps 0.1 1.5", "0.100 1.500");
+    assert_conversion("oh1l2 Ps if2b 1.5 if2l 1.5", "3e 00 00 3e");
+}
+
+TEST(BO_Float, float16_rounds_once)
+{
+    // Just past halfway, but rounding to a double first lands right on it.
+    assert_conversion("oh2b Ps if2b 1.00048828125000000000001", "3c01");
+    assert_conversion("oh2b Ps if2b 1.00048828125 -1.00048828125000000000001 1.00146484375", "3c00 bc01 3c02");
+    assert_conversion("oh2b Ps if2b 2.98023223876953125e-8 2.980232238769531250000001e-8 8.94069671630859375e-8", "0 1 2");
+    assert_conversion("oh2b Ps if2b 0x1.0020000001p0", "3c01");
+}
+
+TEST(BO_Float, bfloat16)
+{
+    assert_conversion("oF2l iF2l Ps 0.1 1.5 -3e38 1e-40", "0.1 1.5 -3e+38 1e-40");
+    assert_conversion("oh1l2 Ps iF2b 1.5 3.14159", "3f c0 40 49");
+}
+
+TEST(BO_Float, bfloat16_rounds_once)
+{
+    assert_conversion("oh2b Ps iF2b 1.00390625000000000000001", "3f81");
+    assert_conversion("oh2b Ps iF2b 1.00390625 1.01171875", "3f80 3f82");
+}
+
+TEST(BO_Float, float128)
+{
+    assert_conversion("of16l if16l Ps 0.1 -2.5 3.14159265358979323846264338327950288 1e4932",
+        "0.1 -2.5 3.1415926535897932384626433832795028 1e+4932");
+    assert_conversion("of16b5 if16b Ps 0.1 -2.5", "0.10000 -2.50000");
+}
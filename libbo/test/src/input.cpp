@@ -40,6 +40,17 @@ TEST(BO_Input, int_1_2_8_be)
     assert_conversion("oh8b16 s\" \" ii8b 1000000000000000000 2000000000000000000", "0de0b6b3a7640000 1bc16d674ec80000");
 }
 
+TEST(BO_Input, int_1_2_16_le_be)
+{
+    assert_conversion("oh1l2 s\" \" ii16l 18446744073709551617 -2", "01 00 00 00 00 00 00 00 01 00 00 00 00 00 00 00 fe ff ff ff ff ff ff ff ff ff ff ff ff ff ff ff");
+    assert_conversion("oh1l2 s\" \" ii16b 18446744073709551617", "00 00 00 00 00 00 00 01 00 00 00 00 00 00 00 01");
+}
+
+TEST(BO_Input, hex_16_16_16_le)
+{
+    assert_conversion("oh16l s\" \" ih16l 0x0123456789abcdef0011223344556677 -1", "123456789abcdef0011223344556677 ffffffffffffffffffffffffffffffff");
+}
+
 TEST(BO_Input, octal_1_2_1_le)
 {
     assert_conversion("oh1l2 s\" \" io1l 17 44", "0f 24");
@@ -104,3 +115,56 @@ TEST(BO_Input, negative_boolean_le)
 {
     assert_conversion("oh1l2 s\" \" ib8l -10", "fe ff ff ff ff ff ff ff");
 }
+
+TEST(BO_Input, whitespace_runs)
+{
+    // Runs and tokens that straddle the 64-byte blocks that whitespace gets classified in.
+    assert_conversion("oh1l2 s\" \" ih1l 01\t\t02\r\n03 \v\f 04                                                                  05"
+                      "                                                            0000000000000000000000000000000000000000000000000000000000000006 07",
+                      "01 02 03 04 05 06 07");
+}
+
+TEST(BO_Input, int_limits)
+{
+    assert_conversion("oh1l2 s\" \" ii1l 255 -128 0", "ff 80 00");
+    assert_conversion("oh8b16 s\" \" ii8b 18446744073709551615 -9223372036854775808", "ffffffffffffffff 8000000000000000");
+    assert_conversion("oh8b16 s\" \" ih8b 0XFEDCBA9876543210 00000000000000000001", "fedcba9876543210 0000000000000001");
+}
+
+TEST(BO_Input, float_rounding)
+{
+    assert_conversion("oh4b8 s\" \" if4b 1.00000005960464477539062499 1.000000059604644775390625 16777217 1e-46",
+        "3f800000 3f800000 4b800000 00000000");
+    assert_conversion("oh8b16 s\" \" if8b 9007199254740993 2.4703282292062328e-324 123456789012345678901234567890",
+        "4340000000000000 0000000000000001 45f8ee90ff6c373e");
+}
+
+TEST(BO_Input, hex_byte_run)
+{
+    // Long runs get decoded in bulk, so mix in everything that has to break out of the fast layout.
+    std::string input = "oh1l2 s\" \" ih1l";
+    std::string expected;
+    const char* const separators[] = {" ", " ", " ", "\n", "  ", "\t", "\r\n"};
+    char token[10];
+    for(int i = 0; i < 1000; i++)
+    {
+        int value = (i * 37) & 0xff;
+        const char* format = i % 97 == 0 ? "%X" : i % 89 == 0 ? "0x%02x" : i % 83 == 0 ? "%x" : "%02x";
+        snprintf(token, sizeof(token), format, value);
+        input += i % 13 == 0 ? separators[(i / 13) % 7] : " ";
+        input += token;
+        snprintf(token, sizeof(token), i == 0 ? "%02x" : " %02x", value);
+        expected += token;
+        if(i % 250 == 249)
+        {
+            input += " \"ab\" ii2l 2 ih1";
+            expected += " 61 62 02 00";
+        }
+    }
+    assert_conversion(input.c_str(), expected.c_str());
+
+    bo_context_options options = {};
+    options.work_buffer_size = 64;
+    options.work_buffer_high_water = 40;
+    assert_conversion_with_options(&options, input.c_str(), expected.c_str());
+}
@@ -84,3 +84,80 @@ TEST(BO_Output, string)
 {
     assert_conversion("oB1l \"This is a string\"", "This is a string");
 }
+
+TEST(BO_Output, int_1_1_le)
+{
+    assert_conversion("oi1l Ps ih1 00 7f 80 ff", "0 127 -128 -1");
+}
+
+TEST(BO_Output, int_4_4_6_le)
+{
+    assert_conversion("oi4l6 Ps ii4l 0 42 -42 123456789 -2147483648", "000000 000042 -00042 123456789 -2147483648");
+}
+
+TEST(BO_Output, int_8_8_be)
+{
+    assert_conversion("oi8b Ps ii8b 9223372036854775807 -9223372036854775808", "9223372036854775807 -9223372036854775808");
+}
+
+TEST(BO_Output, int_16_16_le)
+{
+    assert_conversion("oi16l Ps ii16l 0 -1 9223372036854775808 18446744073709551616 170141183460469231731687303715884105727 -170141183460469231731687303715884105728",
+        "0 -1 9223372036854775808 18446744073709551616 170141183460469231731687303715884105727 -170141183460469231731687303715884105728");
+}
+
+TEST(BO_Output, int_16_16_be_width)
+{
+    assert_conversion("oi16b45 Ps ii16b -10000000000000000000000000000000000000", "-00000010000000000000000000000000000000000000");
+}
+
+TEST(BO_Output, hex_16_16)
+{
+    assert_conversion("oh16b Ps ih16b 0 abc 10000000000000000 ffffffffffffffffffffffffffffffff", "0 abc 10000000000000000 ffffffffffffffffffffffffffffffff");
+    assert_conversion("oh16l40 Ps ih16l 123456789abcdef0123456789abcdef", "000000000123456789abcdef0123456789abcdef");
+}
+
+TEST(BO_Output, octal_16_16)
+{
+    assert_conversion("oo16l Ps io16l 0 777 2000000000000000000000 3777777777777777777777777777777777777777777",
+        "0 777 2000000000000000000000 3777777777777777777777777777777777777777777");
+}
+
+TEST(BO_Output, hex_8_8_le)
+{
+    assert_conversion("oh8l Ps ih8l 0 abc ffffffffffffffff", "0 abc ffffffffffffffff");
+}
+
+TEST(BO_Output, octal_2_2_4_be)
+{
+    assert_conversion("oo2b4 Ps io2b 0 7 177777", "0000 0007 177777");
+}
+
+TEST(BO_Output, hex_1_1_prefix_suffix_short_values)
+{
+    assert_conversion("oh1 p\"<\" s\">\" ih1 0 5 f 10 ff", "<0><5><f><10><ff");
+}
+
+TEST(BO_Output, hex_1_1_suffix_across_flushes)
+{
+    std::string input = "oh1l2 Ps ih1";
+    std::string expected;
+    for(int i = 0; i < 2000; i++)
+    {
+        input += " ab";
+        expected += i == 0 ? "ab" : " ab";
+    }
+    assert_conversion(input.c_str(), expected.c_str());
+}
+
+TEST(BO_Output, int_2_2_prefix_suffix_across_flushes)
+{
+    std::string input = "oi2l Pc ii2l";
+    std::string expected;
+    for(int i = 0; i < 1200; i++)
+    {
+        input += " -1234";
+        expected += i == 0 ? "-1234" : ", -1234";
+    }
+    assert_conversion(input.c_str(), expected.c_str());
+}
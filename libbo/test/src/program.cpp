@@ -0,0 +1,123 @@
+#include "test_helpers.h"
+#include <thread>
+#include <vector>
+
+TEST(BO_Program, binary)
+{
+    void* program = compile_program("oh2l4 Pc iB2b");
+    ASSERT_TRUE(program != NULL);
+    assert_program_conversion(program, "\x01\x02\x03\x04", 4, "0x0102, 0x0304");
+    assert_program_conversion(program, "\xab\xcd", 2, "0xabcd");
+    bo_destroy_program(program);
+}
+
+TEST(BO_Program, text)
+{
+    void* program = compile_program("oi2l Pc ii2l");
+    ASSERT_TRUE(program != NULL);
+    assert_program_conversion(program, "1000 -1000 20", 13, "1000, -1000, 20");
+    assert_program_conversion(program, "5", 1, "5");
+    bo_destroy_program(program);
+}
+
+TEST(BO_Program, commands_in_data_only_affect_one_run)
+{
+    void* program = compile_program("oh1l2 Ps ih1");
+    ASSERT_TRUE(program != NULL);
+    assert_program_conversion(program, "p\"x\" 01 02", 10, "x01 x02");
+    assert_program_conversion(program, "01 02", 5, "01 02");
+    assert_program_conversion(program, "of2l if2l 1.5", 13, "1.5");
+    assert_program_conversion(program, "01 02", 5, "01 02");
+    bo_destroy_program(program);
+}
+
+TEST(BO_Program, threads)
+{
+    void* program = compile_program("of2l Pc if2l");
+    ASSERT_TRUE(program != NULL);
+    std::vector<std::thread> threads;
+    for(int i = 0; i < 4; i++)
+    {
+        threads.emplace_back([program]
+        {
+            for(int run = 0; run < 100; run++)
+            {
+                assert_program_conversion(program, "1.5 -0.1 65504", 14, "1.5, -0.1, 65500");
+            }
+        });
+    }
+    for(auto& thread: threads)
+    {
+        thread.join();
+    }
+    bo_destroy_program(program);
+}
+
+TEST(BO_Program, split)
+{
+    void* program = compile_program("oh2l4 Pc iB2b");
+    ASSERT_TRUE(program != NULL);
+    ASSERT_EQ(2, bo_get_program_split_alignment(program));
+    assert_split_program_conversion(program, "\x01\x02\x03\x04\x05\x06\x07", 7, 2, "0x0102, 0x0304, 0x0506, 0x0700");
+    assert_split_program_conversion(program, "\x01\x02\x03\x04\x05\x06\x07", 7, 4, "0x0102, 0x0304, 0x0506, 0x0700");
+    bo_destroy_program(program);
+
+    program = compile_program("oi4l Ps iB1");
+    ASSERT_TRUE(program != NULL);
+    ASSERT_EQ(4, bo_get_program_split_alignment(program));
+    assert_split_program_conversion(program, "\x01\x00\x00\x00\x02\x00\x00\x00", 8, 4, "1 2");
+    bo_destroy_program(program);
+}
+
+TEST(BO_Program, unsplittable)
+{
+    void* program = compile_program("oh1l2 Ps ih1");
+    ASSERT_TRUE(program != NULL);
+    ASSERT_EQ(0, bo_get_program_split_alignment(program));
+    bo_destroy_program(program);
+
+    program = compile_program("os iB1");
+    ASSERT_TRUE(program != NULL);
+    ASSERT_EQ(0, bo_get_program_split_alignment(program));
+    bo_destroy_program(program);
+}
+
+TEST(BO_Program, passthrough)
+{
+    void* program = compile_program("oB1 iB1");
+    ASSERT_TRUE(program != NULL);
+    ASSERT_TRUE(bo_is_program_passthrough(program));
+    bo_destroy_program(program);
+
+    // Binary output has no prefix or suffix.
+    program = compile_program("oB1 Pc iB1");
+    ASSERT_TRUE(program != NULL);
+    ASSERT_TRUE(bo_is_program_passthrough(program));
+    bo_destroy_program(program);
+}
+
+TEST(BO_Program, not_passthrough)
+{
+    void* program = compile_program("oh1 iB1");
+    ASSERT_TRUE(program != NULL);
+    ASSERT_FALSE(bo_is_program_passthrough(program));
+    bo_destroy_program(program);
+
+    program = compile_program("oB1 ih1");
+    ASSERT_TRUE(program != NULL);
+    ASSERT_FALSE(bo_is_program_passthrough(program));
+    bo_destroy_program(program);
+
+    // One side or the other gets swapped, whatever the native byte order is.
+    program = compile_program("oB4l iB4b");
+    ASSERT_TRUE(program != NULL);
+    ASSERT_FALSE(bo_is_program_passthrough(program));
+    bo_destroy_program(program);
+}
+
+TEST(BO_Program, failed_compile)
+{
+    assert_failed_compile("oh1l2 ih1 01");
+    assert_failed_compile("oh1l2 iB1 q");
+    assert_failed_compile("oz1l2");
+}
@@ -0,0 +1,34 @@
+#include "test_helpers.h"
+
+TEST(BO_Pull, simple)
+{
+    assert_pull_conversion("oh1l2 Ps ih1 01 02 03 0a", 1000, 1000, "01 02 03 0a");
+    assert_pull_conversion("oi2l Pc ii2l 1000 -1000 20", 1000, 1000, "1000, -1000, 20");
+}
+
+TEST(BO_Pull, small_output_buffer)
+{
+    assert_pull_conversion("oh1l2 Ps ih1 01 02 03 0a", 1000, 1, "01 02 03 0a");
+    assert_pull_conversion("oh1l2 Ps ih1 01 02 03 0a", 1000, 5, "01 02 03 0a");
+    assert_pull_conversion("of8l Pc if8l 1.5 2.25 1e100", 1000, 3, "1.5, 2.25, 1e+100");
+    assert_pull_conversion("of2l Pc if2l 1.5 -0.1 65504", 1000, 3, "1.5, -0.1, 65500");
+}
+
+TEST(BO_Pull, small_input_chunks)
+{
+    assert_pull_conversion("oh1l2 Ps ih1 01 02 03 0a", 4, 1000, "01 02 03 0a");
+    assert_pull_conversion("oh1l2 Ps ih1 01 02 03 0a", 1, 3, "01 02 03 0a");
+}
+
+TEST(BO_Pull, long)
+{
+    std::string input = "oi2l Pc ii2l";
+    std::string expected;
+    for(int i = 0; i < 3000; i++)
+    {
+        input += " -1234";
+        expected += i == 0 ? "-1234" : ", -1234";
+    }
+    assert_pull_conversion(input.c_str(), 7000, 100, expected.c_str());
+    assert_pull_conversion(input.c_str(), 100000, 100000, expected.c_str());
+}
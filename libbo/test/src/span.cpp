@@ -83,3 +83,25 @@ TEST(BO_Span, string_continuation)
     assert_spanning_continuation("oB1 \"abcd\"", 10, 10, "abcd");
     assert_spanning_continuation("oB1 \"abcd\" \"ab\"", 15, 15, "abcdab");
 }
+
+TEST(BO_Span, string_escape_continuation)
+{
+    assert_spanning_continuation("oB1 \"a\\x41b\"",  6,  6, "aAb");
+    assert_spanning_continuation("oB1 \"a\\x41b\"",  7,  6, "aAb");
+    assert_spanning_continuation("oB1 \"a\\x41b\"",  8,  6, "aAb");
+    assert_spanning_continuation("oB1 \"a\\x41b\"",  9,  6, "aAb");
+    assert_spanning_continuation("oB1 \"a\\x41b\"", 10, 10, "aAb");
+    assert_spanning_continuation("oB1 \"\\u00e9\"",  8,  5, "\xc3\xa9");
+    assert_spanning_continuation("oB1 \"\\u00e9\"", 10,  5, "\xc3\xa9");
+    assert_spanning_continuation("oB1 \"\\u00e9\"", 11, 11, "\xc3\xa9");
+}
+
+TEST(BO_Span, stream)
+{
+    const char* input = "ih1 oh1l2 Pc p\"<\" 12 ab \"a\\x41\\u00e9\" ii2l 1000 -2 ";
+    const char* expected = "<12, <ab, <61, <41, <c3, <a9, <e8, <03, <fe, <ff";
+    for(int chunk_size = 1; chunk_size <= (int)strlen(input); chunk_size++)
+    {
+        assert_stream_conversion(input, chunk_size, expected);
+    }
+}
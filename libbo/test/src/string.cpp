@@ -5,3 +5,49 @@ TEST(BO_String, string)
     assert_conversion("os ih1 \"Testing\" 11 02 \"ß\" 5", "Testing\\x11\\x2ß\\x5");
     assert_conversion("os is \"\\101\\x42\\u263a\"", "AB☺");
 }
+
+TEST(BO_String, escapes)
+{
+    assert_conversion("os ih1 07 08 09 0a 0b 0c 0d 5c 22 3f 00 1f 7f 80 ff", "\\a\\b\\t\\n\\v\\f\\r\\\\\\\"\\?\\x0\\x1f\\x7f\\x80\\xff");
+    assert_conversion("os is \"A long run of plain text that spans blocks\" ih1 0a", "A long run of plain text that spans blocks\\n");
+}
+
+TEST(BO_String, prefix_suffix)
+{
+    assert_conversion("os p\"<\" s\">\" is \"ab\\u263a?\"", "<a><b><☺><\\?");
+}
+
+TEST(BO_String, truncated_utf8)
+{
+    assert_conversion("os ih1 41 e2 98", "A\\xe2\\x98");
+}
+
+TEST(BO_String, utf8_across_flushes)
+{
+    // Move a UTF-8 sequence across the point where the work buffer gets flushed.
+    for(int lead_offset = 1590; lead_offset < 1610; lead_offset++)
+    {
+        std::string input = "os ih1";
+        std::string expected;
+        for(int i = 0; i < lead_offset; i++)
+        {
+            input += " 41";
+            expected += "A";
+        }
+        input += " e2 98 ba 42";
+        expected += "☺B";
+        assert_conversion(input.c_str(), expected.c_str());
+    }
+}
+
+TEST(BO_String, escapes_across_blocks)
+{
+    // Move an escape sequence and the closing quote across the points where the scan switches blocks.
+    for(int escape_offset = 0; escape_offset < 140; escape_offset++)
+    {
+        std::string plain(escape_offset, 'a');
+        std::string input = "oB1 \"" + plain + "\\x42" + plain + "\" \"" + plain + "\"";
+        std::string expected = plain + "B" + plain + plain;
+        assert_conversion(input.c_str(), expected.c_str());
+    }
+}
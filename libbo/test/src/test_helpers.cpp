@@ -72,20 +72,26 @@ static bool check_processed_all_data(void* context, char* data, int data_length,
 	return result == data + data_length;
 }
 
+// The input is passed as is (usually a string literal in read-only memory), so any attempt to
+// modify it crashes the test.
+static bool check_processed_all_const_data(void* context, const char* data, int data_length, bo_data_segment_type data_segment_type)
+{
+	const char* result = bo_process_const(context, data, data_length, data_segment_type);
+	return result == data + data_length;
+}
+
 void assert_conversion(const char* input, const char* expected_output)
 {
 	reset_errors();
 	char buffer[10000];
 	test_context test_context = new_test_context(buffer);
-	char* input_copy = strdup(input);
 	void* context = bo_new_context(&test_context, on_output, on_error);
-	bool process_success = check_processed_all_data(context, input_copy, strlen(input_copy), DATA_SEGMENT_LAST);
+	bool process_success = check_processed_all_const_data(context, input, strlen(input), DATA_SEGMENT_LAST);
 	bool flush_success = bo_flush_and_destroy_context(context);
 	ASSERT_TRUE(process_success);
 	ASSERT_TRUE(flush_success);
 	ASSERT_FALSE(has_errors());
 	ASSERT_STREQ(expected_output, buffer);
-	free((void*)input_copy);
 }
 
 void assert_spanning_conversion(const char* input, int split_point, int expected_offset, const char* expected_output)
@@ -129,17 +135,191 @@ void assert_spanning_continuation(const char* input, int split_point, int expect
 	free((void*)input_copy);
 }
 
+void assert_stream_conversion(const char* input, int chunk_size, const char* expected_output)
+{
+	reset_errors();
+	char buffer[10000];
+	test_context test_context = new_test_context(buffer);
+	const int input_length = strlen(input);
+	void* context = bo_new_context(&test_context, on_output, on_error);
+	bool process_success = true;
+	for(int offset = 0; offset < input_length; offset += chunk_size)
+	{
+		// Each chunk gets its own exactly sized copy, so that reading past it gets caught.
+		int length = input_length - offset < chunk_size ? input_length - offset : chunk_size;
+		char* chunk = (char*)malloc(length);
+		memcpy(chunk, input + offset, length);
+		process_success = process_success && bo_process_stream(context, chunk, length, DATA_SEGMENT_STREAM);
+		free((void*)chunk);
+	}
+	process_success = process_success && bo_process_stream(context, input, 0, DATA_SEGMENT_LAST);
+	bool flush_success = bo_flush_and_destroy_context(context);
+	ASSERT_TRUE(process_success);
+	ASSERT_TRUE(flush_success);
+	ASSERT_FALSE(has_errors());
+	ASSERT_STREQ(expected_output, buffer);
+}
+
 void assert_failed_conversion(int buffer_length, const char* input)
 {
 	reset_errors();
 	char buffer[10000];
 	test_context test_context = new_test_context(buffer);
-	char* input_copy = strdup(input);
 	void* context = bo_new_context(&test_context, on_output, on_error);
-	bool process_success = check_processed_all_data(context, input_copy, strlen(input_copy), DATA_SEGMENT_LAST);
+	bool process_success = check_processed_all_const_data(context, input, strlen(input), DATA_SEGMENT_LAST);
 	bool flush_success = bo_flush_and_destroy_context(context);
 	bool is_successful = process_success && flush_success;
 	ASSERT_FALSE(is_successful);
 	ASSERT_TRUE(has_errors());
-	free((void*)input_copy);
+}
+
+void assert_binary_conversion(const char* commands, const char* data, int data_length, int chunk_size, const char* expected_output)
+{
+	reset_errors();
+	char buffer[10000];
+	test_context test_context = new_test_context(buffer);
+	char* commands_copy = strdup(commands);
+	char* data_copy = (char*)malloc(data_length);
+	memcpy(data_copy, data, data_length);
+	void* context = bo_new_context(&test_context, on_output, on_error);
+	bool process_success = check_processed_all_data(context, commands_copy, strlen(commands_copy), DATA_SEGMENT_LAST);
+	for(int offset = 0; offset < data_length; offset += chunk_size)
+	{
+		int length = data_length - offset < chunk_size ? data_length - offset : chunk_size;
+		bo_data_segment_type segment_type = offset + length >= data_length ? DATA_SEGMENT_LAST : DATA_SEGMENT_STREAM;
+		process_success = process_success && bo_process(context, data_copy + offset, length, segment_type) != NULL;
+	}
+	bool flush_success = bo_flush_and_destroy_context(context);
+	ASSERT_TRUE(process_success);
+	ASSERT_TRUE(flush_success);
+	ASSERT_FALSE(has_errors());
+	ASSERT_STREQ(expected_output, buffer);
+	free((void*)commands_copy);
+	free((void*)data_copy);
+}
+
+void assert_conversion_with_options(const bo_context_options* options, const char* input, const char* expected_output)
+{
+	reset_errors();
+	char buffer[10000];
+	test_context test_context = new_test_context(buffer);
+	void* context = bo_new_context_with_options(&test_context, on_output, on_error, options);
+	ASSERT_TRUE(context != NULL);
+	bool process_success = check_processed_all_const_data(context, input, strlen(input), DATA_SEGMENT_LAST);
+	bool flush_success = bo_flush_and_destroy_context(context);
+	ASSERT_TRUE(process_success);
+	ASSERT_TRUE(flush_success);
+	ASSERT_FALSE(has_errors());
+	ASSERT_STREQ(expected_output, buffer);
+}
+
+void assert_invalid_options(const bo_context_options* options)
+{
+	reset_errors();
+	char buffer[10000];
+	test_context test_context = new_test_context(buffer);
+	void* context = bo_new_context_with_options(&test_context, on_output, on_error, options);
+	ASSERT_TRUE(context == NULL);
+	ASSERT_TRUE(has_errors());
+}
+
+static bool on_failing_output(void* user_data, char* data, int length)
+{
+	int* remaining_success_count = (int*)user_data;
+	return (*remaining_success_count)-- > 0;
+}
+
+void assert_failed_output(const bo_context_options* options, const char* commands, const char* data, int data_length, int chunk_size)
+{
+	reset_errors();
+	// Let the first output through, then fail every one after.
+	int remaining_success_count = 1;
+	char* commands_copy = strdup(commands);
+	char* data_copy = (char*)malloc(data_length);
+	memcpy(data_copy, data, data_length);
+	void* context = bo_new_context_with_options(&remaining_success_count, on_failing_output, on_error, options);
+	ASSERT_TRUE(context != NULL);
+	bool process_success = bo_process(context, commands_copy, strlen(commands_copy), DATA_SEGMENT_LAST) != NULL;
+	// Keep adding data after the output has failed.
+	for(int offset = 0; offset < data_length; offset += chunk_size)
+	{
+		int length = data_length - offset < chunk_size ? data_length - offset : chunk_size;
+		bo_data_segment_type segment_type = offset + length >= data_length ? DATA_SEGMENT_LAST : DATA_SEGMENT_STREAM;
+		process_success = bo_process(context, data_copy + offset, length, segment_type) != NULL && process_success;
+	}
+	bool flush_success = bo_flush_and_destroy_context(context);
+	ASSERT_FALSE(process_success && flush_success);
+	free((void*)commands_copy);
+	free((void*)data_copy);
+}
+
+void assert_pull_conversion(const char* input, int chunk_size, int output_capacity, const char* expected_output)
+{
+	reset_errors();
+	std::string output;
+	const int input_length = strlen(input);
+	char* output_buffer = (char*)malloc(output_capacity);
+	void* context = bo_new_context(NULL, NULL, on_error);
+	int offset = 0;
+	int available = 0;
+	bool is_finished = false;
+	while(!is_finished)
+	{
+		// Each call, another chunk of input arrives.
+		available = input_length - available < chunk_size ? input_length : available + chunk_size;
+		bo_data_segment_type segment_type = available == input_length ? DATA_SEGMENT_LAST : DATA_SEGMENT_STREAM;
+		int consumed = 0;
+		int produced = 0;
+		bool process_success = bo_process_into(context, input + offset, available - offset, segment_type,
+		                                       output_buffer, output_capacity, &consumed, &produced);
+		ASSERT_TRUE(process_success);
+		ASSERT_TRUE(produced <= output_capacity);
+		output.append(output_buffer, produced);
+		offset += consumed;
+		is_finished = offset == input_length && produced < output_capacity;
+	}
+	bool flush_success = bo_flush_and_destroy_context(context);
+	ASSERT_TRUE(flush_success);
+	ASSERT_FALSE(has_errors());
+	ASSERT_STREQ(expected_output, output.c_str());
+	free((void*)output_buffer);
+}
+
+void* compile_program(const char* commands)
+{
+	reset_errors();
+	return bo_compile(commands, strlen(commands), NULL, on_error);
+}
+
+void assert_program_conversion(const void* program, const char* data, int data_length, const char* expected_output)
+{
+	char buffer[100000];
+	test_context test_context = new_test_context(buffer);
+	bool run_success = bo_run_program(program, data, data_length, &test_context, on_output, on_error);
+	ASSERT_TRUE(run_success);
+	ASSERT_FALSE(has_errors());
+	ASSERT_STREQ(expected_output, buffer);
+}
+
+void assert_failed_compile(const char* commands)
+{
+	void* program = compile_program(commands);
+	ASSERT_TRUE(program == NULL);
+	ASSERT_TRUE(has_errors());
+}
+
+void assert_split_program_conversion(const void* program, const char* data, int data_length, int part_length, const char* expected_output)
+{
+	char buffer[10000];
+	test_context test_context = new_test_context(buffer);
+	for(int offset = 0; offset < data_length; offset += part_length)
+	{
+		int length = data_length - offset < part_length ? data_length - offset : part_length;
+		bool run_success = offset == 0
+			? bo_run_program(program, data + offset, length, &test_context, on_output, on_error)
+			: bo_run_program_continuation(program, data + offset, length, &test_context, on_output, on_error);
+		ASSERT_TRUE(run_success);
+	}
+	ASSERT_FALSE(has_errors());
+	ASSERT_STREQ(expected_output, buffer);
 }
@@ -9,4 +9,24 @@ void assert_spanning_conversion(const char* input, int split_point, int expected
 
 void assert_spanning_continuation(const char* input, int split_point, int expected_offset, const char* expected_output);
 
+void assert_stream_conversion(const char* input, int chunk_size, const char* expected_output);
+
 void assert_failed_conversion(int buffer_length, const char* input);
+
+void assert_binary_conversion(const char* commands, const char* data, int data_length, int chunk_size, const char* expected_output);
+
+void assert_conversion_with_options(const bo_context_options* options, const char* input, const char* expected_output);
+
+void assert_invalid_options(const bo_context_options* options);
+
+void assert_failed_output(const bo_context_options* options, const char* commands, const char* data, int data_length, int chunk_size);
+
+void assert_pull_conversion(const char* input, int chunk_size, int output_capacity, const char* expected_output);
+
+void* compile_program(const char* commands);
+
+void assert_program_conversion(const void* program, const char* data, int data_length, const char* expected_output);
+
+void assert_split_program_conversion(const void* program, const char* data, int data_length, int part_length, const char* expected_output);
+
+void assert_failed_compile(const char* commands);